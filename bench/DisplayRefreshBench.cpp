@@ -0,0 +1,68 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// CPU time per device reply spent in DisplayWidget. "every reply" forces the LCDs and the CC/CV labels
+// to be touched on each reply (what the widget did before frame-capped refresh), "steady state" feeds
+// unchanged values, "coalesced" feeds changing values but refreshes once per 8 replies (one frame at the
+// fastest poll rate and a 25 fps cap). Run with QT_QPA_PLATFORM=offscreen on a headless machine.
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <cstdio>
+
+#include "widgets/DisplayWidget.h"
+
+template<typename Fn>
+static double microsecondsPerUpdate(int count, Fn fn) {
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; ++i) {
+        fn(i);
+    }
+    return double(timer.nsecsElapsed()) / 1e3 / count;
+}
+
+int main(int argc, char *argv[]) {
+    QApplication application(argc, argv);
+    DisplayWidget display(nullptr);
+    display.show();
+
+    const int count = 20000;
+    double everyReply = microsecondsPerUpdate(count, [&] (int i) {
+        display.displayVoltage(12.00 + (i & 1) * 0.01);
+        display.displayCurrent(0.500 + (i & 1) * 0.001);
+        (i & 1) ? display.constantCurrent() : display.constantVoltage();
+        display.refresh();
+    });
+
+    double steadyState = microsecondsPerUpdate(count, [&] (int) {
+        display.displayVoltage(12.00);
+        display.displayCurrent(0.500);
+        display.constantVoltage();
+        display.refresh();
+    });
+
+    double coalesced = microsecondsPerUpdate(count, [&] (int i) {
+        display.displayVoltage(12.00 + (i & 1) * 0.01);
+        display.displayCurrent(0.500 + (i & 1) * 0.001);
+        display.constantVoltage();
+        if (i % 8 == 0) {
+            display.refresh();
+        }
+    });
+
+    std::printf("every reply:  %8.2f us/update\n", everyReply);
+    std::printf("steady state: %8.2f us/update\n", steadyState);
+    std::printf("coalesced:    %8.2f us/update\n", coalesced);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Compares the compressed telemetry encoding with the CSV log: bytes per sample and decode throughput.
+// Input is a synthetic 24 hours recording at 4 Hz with quantized readings and a little noise.
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QVector>
+#include <cstdio>
+
+#include "telemetry/TelemetryCodec.h"
+#include "telemetry/TelemetryFormat.h"
+
+static QVector<Telemetry::Record> generateRecords(int count) {
+    QVector<Telemetry::Record> records;
+    records.reserve(count);
+
+    QRandomGenerator random(42);
+    Telemetry::Record record;
+    record.Timestamp = 1700000000000;
+    record.Status.ModeCh1 = Global::ConstantVoltage;
+    record.Status.ModeCh2 = Global::ConstantVoltage;
+    record.Status.OutputSwitch = true;
+    record.Ch1.Voltage = 12.00;
+    record.Ch2.Voltage = 5.00;
+
+    for (int i = 0; i < count; ++i) {
+        record.Timestamp += 250 + random.bounded(-3, 4);
+        record.Ch1.Current = 0.500 + (random.bounded(10) == 0 ? 0.001 : 0.0);
+        record.Ch2.Current = 1.000 + (i / 3600) * 0.001;
+        if (random.bounded(20) == 0) {
+            record.Ch1.Voltage = 12.00 + random.bounded(-1, 2) * 0.01;
+        }
+        records.append(record);
+    }
+    return records;
+}
+
+template<typename Fn>
+static double measureSeconds(Fn fn) {
+    QElapsedTimer timer;
+    timer.start();
+    fn();
+    return double(timer.nsecsElapsed()) / 1e9;
+}
+
+int main() {
+    const int count = 24 * 3600 * 4;
+    auto records = generateRecords(count);
+
+    QByteArray csv = Telemetry::csvHeader();
+    double csvEncodeTime = measureSeconds([&] () {
+        for (const auto &record : qAsConst(records)) {
+            Telemetry::appendCsv(csv, record);
+        }
+    });
+
+    Telemetry::Encoder encoder(256);
+    QByteArray compressed = Telemetry::Encoder::streamHeader();
+    double encodeTime = measureSeconds([&] () {
+        for (const auto &record : qAsConst(records)) {
+            encoder.append(record);
+        }
+        encoder.flush();
+        compressed.append(encoder.takeEncoded());
+    });
+
+    int csvDecoded = 0;
+    double csvDecodeTime = measureSeconds([&] () {
+        const auto lines = csv.split('\n');
+        for (int i = 1; i < lines.size(); ++i) {
+            const auto fields = lines.at(i).split(',');
+            if (fields.size() < 10) {
+                continue;
+            }
+            Telemetry::Record record;
+            record.Timestamp = fields.at(0).toLongLong();
+            record.Ch1.Voltage = fields.at(1).toDouble();
+            record.Ch1.Current = fields.at(2).toDouble();
+            record.Ch2.Voltage = fields.at(4).toDouble();
+            record.Ch2.Current = fields.at(5).toDouble();
+            csvDecoded += record.Timestamp != 0;
+        }
+    });
+
+    int decoded = 0;
+    Telemetry::Decoder decoder;
+    double decodeTime = measureSeconds([&] () {
+        const int chunk = 64 * 1024;
+        Telemetry::Record record;
+        for (int pos = 0; pos < compressed.size(); pos += chunk) {
+            decoder.feed(compressed.mid(pos, chunk));
+            while (decoder.next(record)) {
+                ++decoded;
+            }
+        }
+    });
+
+    std::printf("samples:              %d (24 h at 4 Hz)\n", count);
+    std::printf("csv:        %8.2f bytes/sample  encode %7.2f Msample/s  decode %7.2f Msample/s\n",
+                double(csv.size()) / count, count / csvEncodeTime / 1e6, csvDecoded / csvDecodeTime / 1e6);
+    std::printf("compressed: %8.2f bytes/sample  encode %7.2f Msample/s  decode %7.2f Msample/s\n",
+                double(compressed.size()) / count, count / encodeTime / 1e6, decoded / decodeTime / 1e6);
+    std::printf("ratio:      %8.1fx\n", double(csv.size()) / compressed.size());
+
+    if (decoded != count || decoder.hasError()) {
+        std::printf("decode mismatch: %d of %d samples\n", decoded, count);
+        return 1;
+    }
+    return 0;
+}
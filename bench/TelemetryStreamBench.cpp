@@ -0,0 +1,144 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Serialization throughput of the NDJSON telemetry stream: the hand-written formatter against QJsonDocument.
+// Input is a synthetic recording of one million frames with both channels and the status updated.
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QVector>
+#include <cstdio>
+
+#include "telemetry/TelemetryFormat.h"
+
+static QVector<Global::TelemetryFrame> generateFrames(int count) {
+    QVector<Global::TelemetryFrame> frames;
+    frames.reserve(count);
+
+    QRandomGenerator random(42);
+    Global::TelemetryFrame frame;
+    frame.WallTime = 1700000000000;
+    frame.Timestamp = 1000000000;
+    frame.Ch1.VoltageSet = 12.00;
+    frame.Ch1.CurrentSet = 1.000;
+    frame.Ch2.VoltageSet = 5.00;
+    frame.Ch2.CurrentSet = 2.000;
+    frame.Status.ModeCh1 = Global::ConstantVoltage;
+    frame.Status.ModeCh2 = Global::ConstantCurrent;
+    frame.Status.Tracking = Global::Independent;
+    frame.Status.Protection = Global::OutputProtectionAllDisabled;
+    frame.Status.OutputSwitch = true;
+    frame.IsStatusUpdated = true;
+
+    for (int i = 0; i < count; ++i) {
+        frame.WallTime += 16;
+        frame.Timestamp += 16000000 + random.bounded(-50000, 50000);
+        frame.Ch1.ActualVoltage = 12.00 + random.bounded(-1, 2) * 0.01;
+        frame.Ch1.ActualCurrent = 0.500 + random.bounded(10) * 0.001;
+        frame.Ch2.ActualVoltage = 4.98;
+        frame.Ch2.ActualCurrent = 2.000;
+        for (int field = 0; field < Global::TelemetryFrame::FieldsCount; ++field) {
+            frame.setUpdated(Global::TelemetryFrame::Field(field), Global::Channel1);
+            frame.setUpdated(Global::TelemetryFrame::Field(field), Global::Channel2);
+        }
+        frames.append(frame);
+    }
+    return frames;
+}
+
+static QJsonObject channelJson(const Global::ChannelFrame &channel, Global::OutputMode mode) {
+    return {
+            {"vset", channel.VoltageSet},
+            {"iset", channel.CurrentSet},
+            {"v", channel.ActualVoltage},
+            {"i", channel.ActualCurrent},
+            {"mode", mode == Global::ConstantCurrent ? "CC" : "CV"},
+    };
+}
+
+// the same names as the formatter writes.
+static QString trackingName(Global::ChannelsTracking tracking) {
+    switch (tracking) {
+        case Global::Serial:
+            return "serial";
+        case Global::Parallel:
+            return "parallel";
+        case Global::Independent:
+        default:
+            return "independent";
+    }
+}
+
+static QString protectionName(Global::OutputProtection protection) {
+    switch (protection) {
+        case Global::OutputProtectionAllEnabled:
+            return "ovp+ocp";
+        case Global::OverVoltageProtectionOnly:
+            return "ovp";
+        case Global::OverCurrentProtectionOnly:
+            return "ocp";
+        case Global::OutputProtectionAllDisabled:
+        default:
+            return "off";
+    }
+}
+
+template<typename Fn>
+static double measureSeconds(Fn fn) {
+    QElapsedTimer timer;
+    timer.start();
+    fn();
+    return double(timer.nsecsElapsed()) / 1e9;
+}
+
+int main() {
+    const int count = 1000000;
+    auto frames = generateFrames(count);
+
+    QByteArray formatted;
+    formatted.reserve(count * 256);
+    double formatTime = measureSeconds([&] () {
+        for (const auto &frame : qAsConst(frames)) {
+            Telemetry::appendFrameJson(formatted, frame);
+        }
+    });
+
+    QByteArray document;
+    document.reserve(count * 256);
+    double documentTime = measureSeconds([&] () {
+        for (const auto &frame : qAsConst(frames)) {
+            QJsonObject object {
+                    {"t", frame.WallTime},
+                    {"mono", frame.Timestamp},
+                    {"upd", int(frame.Updated | (frame.IsStatusUpdated ? 0x100 : 0))},
+                    {"ch1", channelJson(frame.Ch1, frame.Status.ModeCh1)},
+                    {"ch2", channelJson(frame.Ch2, frame.Status.ModeCh2)},
+                    {"tracking", trackingName(frame.Status.Tracking)},
+                    {"protection", protectionName(frame.Status.Protection)},
+                    {"output", frame.Status.OutputSwitch},
+            };
+            document.append(QJsonDocument(object).toJson(QJsonDocument::Compact));
+            document.append('\n');
+        }
+    });
+
+    std::printf("frames:        %d\n", count);
+    std::printf("formatter:     %8.2f bytes/frame  %7.2f Mframe/s  %8.1f MB/s\n",
+                double(formatted.size()) / count, count / formatTime / 1e6, formatted.size() / formatTime / 1e6);
+    std::printf("QJsonDocument: %8.2f bytes/frame  %7.2f Mframe/s  %8.1f MB/s\n",
+                double(document.size()) / count, count / documentTime / 1e6, document.size() / documentTime / 1e6);
+    std::printf("speedup:       %8.1fx\n", documentTime / formatTime);
+    return 0;
+}
@@ -0,0 +1,62 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "AdaptiveSampler.h"
+
+AdaptiveSampler::AdaptiveSampler() {
+    setOptions(Options());
+}
+
+AdaptiveSampler::AdaptiveSampler(const Options &options) {
+    setOptions(options);
+}
+
+void AdaptiveSampler::setOptions(const Options &options) {
+    mOptions = options;
+    mOptions.idleRate = qMax(0.01, mOptions.idleRate);
+    mOptions.activeRate = qMax(mOptions.idleRate, mOptions.activeRate);
+    reset(0);
+}
+
+void AdaptiveSampler::reset(qint64 now) {
+    // start dense, there is no history to tell the channel is stable.
+    mRate = mOptions.activeRate;
+    mLastDecay = now;
+    for (int i = 0; i < QuantitiesCount; ++i) {
+        mLastSample[i] = now - qint64(1000 / mRate);
+        mIsValueValid[i] = false;
+    }
+}
+
+bool AdaptiveSampler::isDue(Quantity quantity, qint64 now) const {
+    return now - mLastSample[quantity] >= 1000 / mRate;
+}
+
+void AdaptiveSampler::sampled(Quantity quantity, qint64 now) {
+    mLastSample[quantity] = now;
+}
+
+void AdaptiveSampler::update(Quantity quantity, double value, qint64 now) {
+    double threshold = quantity == Voltage ? mOptions.voltageThreshold : mOptions.currentThreshold;
+    bool isChanged = mIsValueValid[quantity] && qAbs(value - mLastValue[quantity]) > threshold;
+    mLastValue[quantity] = value;
+    mIsValueValid[quantity] = true;
+
+    if (isChanged) {
+        mRate = mOptions.activeRate;
+        mLastDecay = now;
+    } else if (now - mLastDecay >= mOptions.decayTime) {
+        mRate = qMax(mOptions.idleRate, mRate / 2);
+        mLastDecay = now;
+    }
+}
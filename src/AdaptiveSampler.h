@@ -0,0 +1,63 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_ADAPTIVESAMPLER_H
+#define PS_MANAGEMENT_ADAPTIVESAMPLER_H
+
+#include <QtGlobal>
+
+/**
+ * Sampling rate of a channel measurements, which follows the rate of change of the readings.
+ *
+ * A reading that differs from the previous one more than the threshold switches the channel to the active rate.
+ * While the readings stay flat, the rate is halved every decay period down to the idle rate.
+ */
+class AdaptiveSampler {
+public:
+    enum Quantity {
+        Voltage,
+        Current,
+        QuantitiesCount
+    };
+
+    struct Options {
+        double idleRate = 1;            // Hz
+        double activeRate = 10;         // Hz
+        double voltageThreshold = 0.02; // V
+        double currentThreshold = 0.005; // A
+        int    decayTime = 1000;        // ms
+    };
+
+    AdaptiveSampler();
+    explicit AdaptiveSampler(const Options &options);
+
+    void setOptions(const Options &options);
+    void reset(qint64 now);
+
+    // time in ms of a monotonic clock.
+    bool isDue(Quantity quantity, qint64 now) const;
+    void sampled(Quantity quantity, qint64 now);
+    void update(Quantity quantity, double value, qint64 now);
+
+    double rate() const { return mRate; }
+
+private:
+    Options mOptions;
+    double  mRate;
+    qint64  mLastDecay = 0;
+    qint64  mLastSample[QuantitiesCount] = {};
+    double  mLastValue[QuantitiesCount] = {};
+    bool    mIsValueValid[QuantitiesCount] = {};
+};
+
+#endif //PS_MANAGEMENT_ADAPTIVESAMPLER_H
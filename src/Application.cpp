@@ -17,37 +17,111 @@
 
 #include "Application.h"
 #include <QTimer>
+#include <QFileInfo>
 #include <QDebug>
-
-#define WORKING_TIMER_INTERVAL_MIN 250
-#define WORKING_TIMER_INTERVAL_MAX 500
-#define WORKING_TIMER_INTERVAL_STEP 25
+#include <QVector>
+
+static void registerMetaTypes() {
+    qRegisterMetaType<Global::Channel>();
+    qRegisterMetaType<Global::MemoryKey>();
+    qRegisterMetaType<Global::ChannelsTracking>();
+    qRegisterMetaType<Global::OutputProtection>();
+    qRegisterMetaType<Global::DeviceStatus>();
+    qRegisterMetaType<Global::DeviceInfo>();
+    qRegisterMetaType<Global::TelemetryFrame>();
+    qRegisterMetaType<CommunicationMetrics>();
+    qRegisterMetaType<EventLoopMetrics>();
+    qRegisterMetaType<Sequencer::Report>();
+    qRegisterMetaType<ListPlayer::Report>();
+    qRegisterMetaType<SweepEngine::Result>();
+    qRegisterMetaType<SoftwareRegulator::Status>();
+    qRegisterMetaType<ChargeEngine::Status>();
+}
 
 Application::Application(int &argc, char **argv, int) : QApplication(argc, argv) {
-    mCommunication = new Communication(this);
+    registerMetaTypes();
+    mEventLoopMonitor = new EventLoopMonitor(this);
+
+    // Communication and Poller live on the I/O thread, so a busy GUI doesn't delay the serial port handling.
+    mCommunication = new Communication();
+    auto protectionRules = mSettings.protectionRules();
+    mCommunication->setProtectionRules(protectionRules);
+
+    mCommunication->setWatchdogOptions(mSettings.watchdogOptions());
+
+    mPoller = new Poller(mCommunication);
+    mSequencer = new Sequencer(mCommunication);
+    mListPlayer = new ListPlayer(mCommunication);
+    mSweepEngine = new SweepEngine(mCommunication);
+    mRegulator = new SoftwareRegulator(mCommunication);
+    mChargeEngine = new ChargeEngine(mCommunication);
     mMainWindow = new MainWindow();
-
-    mDeviceUpdaterTimer.setTimerType(Qt::PreciseTimer);
-    mDeviceUpdaterTimer.setInterval(WORKING_TIMER_INTERVAL_MIN); // 150 min (9600), 250 norm.
-    connect(&mDeviceUpdaterTimer, &QTimer::timeout, this, &Application::DeviceUpdateCycle);
+    mTelemetryLogger = new TelemetryLogger(this);
+    mWakeupCounter = new WakeupCounter(this);
+    mIsTelemetryLogEnabled = mSettings.isTelemetryLogEnabled();
+
+    mPoller->setRateControllerOptions(mSettings.pollRateControllerOptions());
+    mPoller->setProtectionRules(protectionRules);
+
+    // listed once, so an object added later is both moved and deleted. The engines are deleted before the poller and
+    // Communication they use.
+    const QVector<QObject *> ioObjects = {mCommunication, mPoller, mSequencer, mListPlayer, mSweepEngine, mRegulator,
+                                          mChargeEngine};
+    for (auto object : ioObjects) {
+        object->moveToThread(&mIoThread);
+    }
+    for (auto it = ioObjects.crbegin(); it != ioObjects.crend(); ++it) {
+        connect(&mIoThread, &QThread::finished, *it, &QObject::deleteLater);
+    }
+    mIoThread.setObjectName("io");
+    mIoThread.start(QThread::TimeCriticalPriority);
 
     QTimer::singleShot(0, this, SLOT(Run()));
 }
 
 Application::~Application() {
+    mIoThread.quit();
+    mIoThread.wait();
+
+    if (mSettings.isDebugModeEnabled()) {
+        qInfo().noquote() << mEventLoopMonitor->report();
+    }
+    mEventLoopMonitor = nullptr;
+}
+
+bool Application::notify(QObject *receiver, QEvent *event) {
+    // Only the GUI thread is measured, the I/O thread has its own watchdog.
+    if (mEventLoopMonitor == nullptr || QThread::currentThread() != thread()) {
+        return QApplication::notify(receiver, event);
+    }
+
+    mEventLoopMonitor->begin();
+    bool result = QApplication::notify(receiver, event);
+    mEventLoopMonitor->end(receiver, event);
+    return result;
+}
+
+void Application::publishEventLoopMetrics() {
+    mMainWindow->UpdateEventLoopMetrics(mEventLoopMonitor->metrics());
 }
 
 void Application::Run() {
     connect(mMainWindow, &MainWindow::onSerialPortSettingsChanged, mCommunication, &Communication::OpenSerialPort);
     connect(mMainWindow, &MainWindow::onSerialPortDoClose, mCommunication, &Communication::CloseSerialPort);
     connect(mCommunication, &Communication::onMetricsReady, mMainWindow, &MainWindow::UpdateCommunicationMetrics);
-    connect(mCommunication, &Communication::onMetricsReady, this, &Application::TuneDeviceUpdaterTimerInterval);
+    connect(mCommunication, &Communication::onMetricsReady, mPoller, &Poller::UpdateMetrics);
+    connect(mPoller, &Poller::onPollRateChanged, mMainWindow, &MainWindow::UpdatePollRate);
+    connect(mMainWindow, &MainWindow::onVisibilityChanged, mPoller, &Poller::SetVisible);
+    connect(mMainWindow, &MainWindow::onVisibilityChanged, mWakeupCounter, &WakeupCounter::SetReporting);
+    connect(mWakeupCounter, &WakeupCounter::onRateReady, mMainWindow, &MainWindow::UpdateWakeupRate);
+    connect(mWakeupCounter, &WakeupCounter::onRateReady, this, &Application::publishEventLoopMetrics);
 
     connect(mCommunication, &Communication::onSerialPortErrorOccurred, mMainWindow, &MainWindow::SerialPortErrorOccurred);
     connect(mCommunication, &Communication::onSerialPortOpened, mMainWindow, &MainWindow::SerialPortOpened);
     connect(mCommunication, &Communication::onSerialPortClosed, this, &Application::SerialPortClosed);
     connect(mCommunication, &Communication::onDeviceReady, this, &Application::DeviceReady);
     connect(mCommunication, &Communication::onUnknownDevice, mMainWindow, &MainWindow::ConnectionUnknownDevice);
+    connect(mCommunication, &Communication::onProtectionTripped, mMainWindow, &MainWindow::ProtectionTripped);
 
     // Lock operation panel
     connect(mMainWindow, &MainWindow::onSetLocked, mCommunication, &Communication::SetLocked);
@@ -63,6 +137,7 @@ void Application::Run() {
     connect(mMainWindow, &MainWindow::onSavePreset, mCommunication, &Communication::SavePreset);
 
     connect(mMainWindow, &MainWindow::onSetEnableOutputSwitch, mCommunication, &Communication::SetEnableOutputSwitch);
+    connect(mMainWindow, &MainWindow::onEmergencyOutputOff, mCommunication, &Communication::EmergencyOutputOff);
     connect(mMainWindow, &MainWindow::onSetChannelsTracking, mCommunication,
             &Communication::SetChannelTracking);
     connect(mMainWindow, &MainWindow::onSetEnableOutputProtection, this, &Application::OutputProtectionChanged);
@@ -75,101 +150,130 @@ void Application::Run() {
     connect(mMainWindow, &MainWindow::onSetOverVoltageProtectionValue, mCommunication,
             &Communication::SetOverVoltageProtectionValue);
 
-    connect(mCommunication, &Communication::onGetCurrentSet, mMainWindow, &MainWindow::UpdateCurrentSet);
-    connect(mCommunication, &Communication::onGetActualCurrent, mMainWindow, &MainWindow::UpdateActualCurrent);
-
-    connect(mCommunication, &Communication::onGetVoltageSet, mMainWindow, &MainWindow::UpdateVoltageSet);
-    connect(mCommunication, &Communication::onGetActualVoltage, mMainWindow, &MainWindow::UpdateActualVoltage);
-
-    connect(mCommunication, &Communication::onGetDeviceStatus, this, &Application::OutputStatus);
+    // Set and actual values, device status
+    connect(mCommunication, &Communication::onTelemetryFrame, mMainWindow, &MainWindow::UpdateTelemetry);
+    connect(mCommunication, &Communication::onTelemetryFrame, mPoller, &Poller::UpdateTelemetry);
 
     connect(mMainWindow, &MainWindow::onSetVoltage, mCommunication, &Communication::SetVoltage);
     connect(mMainWindow, &MainWindow::onSetCurrent, mCommunication, &Communication::SetCurrent);
 
+    // Telemetry log
+    connect(mCommunication, &Communication::onTelemetryFrame, mTelemetryLogger, &TelemetryLogger::UpdateTelemetry);
+    connect(mTelemetryLogger, &TelemetryLogger::onErrorOccurred, mMainWindow, &MainWindow::TelemetryLogErrorOccurred);
+    connect(mMainWindow, &MainWindow::onSetEnableTelemetryLog, this, &Application::SetEnableTelemetryLog);
+
+    // Sequencer
+    connect(mMainWindow, &MainWindow::onRunSequence, this, &Application::RunSequence);
+    connect(mMainWindow, &MainWindow::onStopSequence, this, &Application::StopSequence);
+    connect(mSequencer, &Sequencer::onStarted, mMainWindow, &MainWindow::SequenceStarted);
+    connect(mSequencer, &Sequencer::onFinished, mMainWindow, &MainWindow::SequenceFinished);
+    connect(mSequencer, &Sequencer::onErrorOccurred, mMainWindow, &MainWindow::SequenceErrorOccurred);
+    connect(mListPlayer, &ListPlayer::onStarted, mMainWindow, &MainWindow::SequenceStarted);
+    connect(mListPlayer, &ListPlayer::onFinished, mMainWindow, &MainWindow::ListFinished);
+    connect(mListPlayer, &ListPlayer::onErrorOccurred, mMainWindow, &MainWindow::SequenceErrorOccurred);
+    connect(mSweepEngine, &SweepEngine::onStarted, mMainWindow, &MainWindow::SequenceStarted);
+    connect(mSweepEngine, &SweepEngine::onFinished, mMainWindow, &MainWindow::SweepFinished);
+    connect(mSweepEngine, &SweepEngine::onErrorOccurred, mMainWindow, &MainWindow::SequenceErrorOccurred);
+    connect(mRegulator, &SoftwareRegulator::onStarted, mMainWindow, &MainWindow::SequenceStarted);
+    connect(mRegulator, &SoftwareRegulator::onStatus, mMainWindow, &MainWindow::UpdateRegulatorStatus);
+    connect(mRegulator, &SoftwareRegulator::onFinished, mMainWindow, &MainWindow::UpdateRegulatorStatus);
+    connect(mRegulator, &SoftwareRegulator::onErrorOccurred, mMainWindow, &MainWindow::SequenceErrorOccurred);
+    connect(mChargeEngine, &ChargeEngine::onStarted, mMainWindow, &MainWindow::SequenceStarted);
+    connect(mChargeEngine, &ChargeEngine::onStatus, mMainWindow, &MainWindow::UpdateChargeStatus);
+    connect(mChargeEngine, &ChargeEngine::onFinished, mMainWindow, &MainWindow::UpdateChargeStatus);
+    connect(mChargeEngine, &ChargeEngine::onErrorOccurred, mMainWindow, &MainWindow::SequenceErrorOccurred);
+    connect(mChargeEngine, &ChargeEngine::onSamplingChanged, mPoller, &Poller::SetExternallySampled);
+
     mMainWindow->show();
     mMainWindow->autoOpenSerialPort();
 }
 
 void Application::DeviceReady(const Global::DeviceInfo &info) {
+    mDeviceInfo = info;
     mMainWindow->ConnectionDeviceReady(info);
 
-//    mCommunication->GetDeviceID();
-    mCommunication->GetOverCurrentProtectionValue(Global::Channel1);
-    mCommunication->GetOverCurrentProtectionValue(Global::Channel2);
-    mCommunication->GetOverVoltageProtectionValue(Global::Channel1);
-    mCommunication->GetOverVoltageProtectionValue(Global::Channel2);
-
-    mDeviceUpdaterTimer.start();
+    auto communication = mCommunication;
+    QMetaObject::invokeMethod(communication, [communication] () {
+//        communication->GetDeviceID();
+        communication->GetOverCurrentProtectionValue(Global::Channel1);
+        communication->GetOverCurrentProtectionValue(Global::Channel2);
+        communication->GetOverVoltageProtectionValue(Global::Channel1);
+        communication->GetOverVoltageProtectionValue(Global::Channel2);
+    });
+
+    QMetaObject::invokeMethod(mPoller, &Poller::Start);
+    mIsDeviceReady = true;
+    updateTelemetryLogState();
 }
 
 void Application::SerialPortClosed() {
-    mDeviceUpdaterTimer.stop();
+    QMetaObject::invokeMethod(mPoller, &Poller::Stop);
+    mIsDeviceReady = false;
+    updateTelemetryLogState();
     mMainWindow->SerialPortClosed();
 }
 
-void Application::DeviceUpdateCycle() {
-    mCommunication->GetDeviceStatus();
-    mCommunication->GetPreset();
-    mCommunication->GetIsLocked();
-    mCommunication->GetIsBuzzerEnabled();
+void Application::OutputProtectionChanged(Global::OutputProtection protection) {
+    auto communication = mCommunication;
+    QMetaObject::invokeMethod(communication, [communication, protection] () {
+        communication->SetEnableOverVoltageProtection(
+                protection == Global::OverVoltageProtectionOnly || protection == Global::OutputProtectionAllEnabled);
+        communication->SetEnableOverCurrentProtection(
+                protection == Global::OverCurrentProtectionOnly || protection == Global::OutputProtectionAllEnabled);
+    });
 }
 
-void Application::OutputStatus(const Global::DeviceStatus &status) {
-    if (status.OutputSwitch) {
-        mCommunication->GetActualCurrent(Global::Channel1);
-        mCommunication->GetActualCurrent(Global::Channel2);
-        mCommunication->GetActualVoltage(Global::Channel1);
-        mCommunication->GetActualVoltage(Global::Channel2);
-
-        disconnect(mCommunication, &Communication::onGetCurrentSet, mMainWindow, &MainWindow::UpdateActualCurrent);
-        disconnect(mCommunication, &Communication::onGetVoltageSet, mMainWindow, &MainWindow::UpdateActualVoltage);
-    } else {
-        connect(mCommunication, &Communication::onGetCurrentSet, mMainWindow, &MainWindow::UpdateActualCurrent);
-        connect(mCommunication, &Communication::onGetVoltageSet, mMainWindow, &MainWindow::UpdateActualVoltage);
-    }
-
-    mCommunication->GetCurrentSet(Global::Channel1);
-    mCommunication->GetCurrentSet(Global::Channel2);
-    mCommunication->GetVoltageSet(Global::Channel1);
-    mCommunication->GetVoltageSet(Global::Channel2);
-
-    if (status.Protection == Global::OverVoltageProtectionOnly || status.Protection == Global::OutputProtectionAllEnabled) {
-        mCommunication->GetOverVoltageProtectionValue(Global::Channel1);
-        mCommunication->GetOverVoltageProtectionValue(Global::Channel2);
-    }
-    if (status.Protection == Global::OverCurrentProtectionOnly || status.Protection == Global::OutputProtectionAllEnabled) {
-        mCommunication->GetOverCurrentProtectionValue(Global::Channel1);
-        mCommunication->GetOverCurrentProtectionValue(Global::Channel2);
-    }
+void Application::SetEnableTelemetryLog(bool enable) {
+    mIsTelemetryLogEnabled = enable;
+    updateTelemetryLogState();
+}
 
-    mMainWindow->UpdateChannelMode(Global::Channel1, status.ModeCh1);
-    mMainWindow->UpdateChannelMode(Global::Channel2, status.ModeCh2);
-    mMainWindow->SetEnableOutputSwitch(status.OutputSwitch);
-    mMainWindow->UpdateOutputProtectionMode(status.Protection);
-    mMainWindow->UpdateChannelTrackingMode(status.Tracking);
+void Application::RunSequence(const QString &fileName) {
+    auto sequencer = mSequencer;
+    auto listPlayer = mListPlayer;
+    auto sweepEngine = mSweepEngine;
+    auto regulator = mRegulator;
+    auto chargeEngine = mChargeEngine;
+    auto info = mDeviceInfo;
+    // a CSV is a setpoint list, a .sweep is an I-V sweep, a .loop is a CP/CR loop, a .charge is a charge profile,
+    // anything else is a sequence.
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    QMetaObject::invokeMethod(sequencer, [sequencer, listPlayer, sweepEngine, regulator, chargeEngine, fileName, info,
+                                          suffix] () {
+        sequencer->Stop();
+        listPlayer->Stop();
+        sweepEngine->Stop();
+        regulator->Stop();
+        chargeEngine->Stop();
+        if (suffix == "csv") {
+            listPlayer->Start(fileName, info);
+        } else if (suffix == "sweep") {
+            sweepEngine->Start(fileName, info);
+        } else if (suffix == "loop") {
+            regulator->Start(fileName, info);
+        } else if (suffix == "charge") {
+            chargeEngine->Start(fileName, info);
+        } else {
+            sequencer->Start(fileName, info);
+        }
+    });
 }
 
-void Application::OutputProtectionChanged(Global::OutputProtection protection) {
-    mCommunication->SetEnableOverVoltageProtection(
-            protection == Global::OverVoltageProtectionOnly || protection == Global::OutputProtectionAllEnabled);
-    mCommunication->SetEnableOverCurrentProtection(
-            protection == Global::OverCurrentProtectionOnly || protection == Global::OutputProtectionAllEnabled);
+void Application::StopSequence() {
+    QMetaObject::invokeMethod(mSequencer, &Sequencer::Stop);
+    QMetaObject::invokeMethod(mListPlayer, &ListPlayer::Stop);
+    QMetaObject::invokeMethod(mSweepEngine, &SweepEngine::Stop);
+    QMetaObject::invokeMethod(mRegulator, &SoftwareRegulator::Stop);
+    QMetaObject::invokeMethod(mChargeEngine, &ChargeEngine::Stop);
 }
 
-void Application::TuneDeviceUpdaterTimerInterval(const CommunicationMetrics &metrics) {
-    int interval = mDeviceUpdaterTimer.interval();
-    if (metrics.queueLength() > 2) {
-        interval = qMin(interval + WORKING_TIMER_INTERVAL_STEP, WORKING_TIMER_INTERVAL_MAX);
+void Application::updateTelemetryLogState() {
+    if (mIsTelemetryLogEnabled && mIsDeviceReady) {
+        if (!mTelemetryLogger->isRunning()) {
+            mTelemetryLogger->Start(mSettings.telemetryLogOptions());
+        }
     } else {
-        interval = qMax(interval - WORKING_TIMER_INTERVAL_STEP, WORKING_TIMER_INTERVAL_MIN);
+        mTelemetryLogger->Stop();
     }
-    mDeviceUpdaterTimer.setInterval(interval);
+    QMetaObject::invokeMethod(mPoller, "SetRecording", Q_ARG(bool, mTelemetryLogger->isRunning()));
 }
-
-
-
-
-
-
-
-
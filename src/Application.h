@@ -21,9 +21,20 @@
 #include <QObject>
 #include <QApplication>
 #include <QQueue>
+#include <QThread>
 #include "Global.h"
 #include "Communication.h"
+#include "Poller.h"
 #include "MainWindow.h"
+#include "Settings.h"
+#include "WakeupCounter.h"
+#include "EventLoopMonitor.h"
+#include "telemetry/TelemetryLogger.h"
+#include "automation/Sequencer.h"
+#include "automation/ListPlayer.h"
+#include "automation/SweepEngine.h"
+#include "automation/SoftwareRegulator.h"
+#include "automation/ChargeEngine.h"
 
 class Application : public QApplication {
     Q_DISABLE_COPY(Application)
@@ -32,10 +43,28 @@ public:
     explicit Application(int &argc, char **argv, int = ApplicationFlags);
     ~Application() override;
 
+    bool notify(QObject *receiver, QEvent *event) override;
+
 private:
     Communication   *mCommunication;
+    Poller          *mPoller;
+    Sequencer       *mSequencer;
+    ListPlayer      *mListPlayer;
+    SweepEngine     *mSweepEngine;
+    SoftwareRegulator *mRegulator;
+    ChargeEngine    *mChargeEngine;
     MainWindow      *mMainWindow;
-    QTimer          mDeviceUpdaterTimer;
+    TelemetryLogger *mTelemetryLogger;
+    WakeupCounter   *mWakeupCounter;
+    EventLoopMonitor *mEventLoopMonitor = nullptr;
+    Settings        mSettings;
+    QThread         mIoThread;        // Communication, Poller and the automation
+    Global::DeviceInfo mDeviceInfo;
+    bool            mIsDeviceReady = false;
+    bool            mIsTelemetryLogEnabled = false;
+
+    void updateTelemetryLogState();
+    void publishEventLoopMetrics();
 
 private slots:
     void Run();
@@ -43,10 +72,10 @@ private slots:
     void DeviceReady(const Global::DeviceInfo &info);
     void SerialPortClosed();
 
-    void DeviceUpdateCycle();
-    void OutputStatus(const Global::DeviceStatus &status);
     void OutputProtectionChanged(Global::OutputProtection protection);
-    void TuneDeviceUpdaterTimerInterval(const CommunicationMetrics &metrics);
+    void SetEnableTelemetryLog(bool enable);
+    void RunSequence(const QString &fileName);
+    void StopSequence();
 };
 
 
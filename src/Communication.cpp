@@ -17,14 +17,29 @@
 
 #include "Communication.h"
 #include "protocol/Factory.h"
+#include "MonotonicClock.h"
 
 #include <QTimer>
+#include <QDateTime>
+#include <QtMath>
 
 #define COLLECT_DEBUG_INFO_MS 500
 #define DELAY_BETWEEN_REQUESTS_MS 60
 #define RESPONSE_TIMEOUT DELAY_BETWEEN_REQUESTS_MS*2
-
-Communication::Communication(QObject *parent) : QObject(parent){
+// Unchanged settings are published anyway once in this period, so a value lost by a consumer heals itself.
+#define SHADOW_KEYFRAME_MS 5000
+#define TRANSACTION_TIME_SMOOTHING 0.2
+// The device parses a command about as long as it takes to answer a query, so the gap after a streamed command
+// follows the transaction time with a margin. A timeout or a garbled reply doubles it.
+#define COMMAND_GAP_MARGIN 1.25
+#define MIN_COMMAND_GAP_MS 10
+// A frame is published, when the queue runs empty after a poll cycle; on a saturated link not later than that.
+#define FRAME_MAX_AGE_MS 250
+
+// The member QObjects are parented, so moveToThread() takes them along.
+Communication::Communication(QObject *parent) : QObject(parent),
+        mSerialPort(this), mWaitResponseTimer(this), mDelayTimer(this), mCommandGap(DELAY_BETWEEN_REQUESTS_MS),
+        mMetricCollectorTimer(this) {
     mSerialPort.setDataBits(QSerialPort::Data8);
     mSerialPort.setParity(QSerialPort::NoParity);
     mSerialPort.setStopBits(QSerialPort::OneStop);
@@ -33,17 +48,34 @@ Communication::Communication(QObject *parent) : QObject(parent){
     connect(&mSerialPort, &QSerialPort::readyRead, this, &Communication::SerialPortReadyRead);
     connect(&mSerialPort, &QSerialPort::errorOccurred, this, &Communication::SerialPortErrorOccurred);
 
-    mMetricCollectorTimer.start(COLLECT_DEBUG_INFO_MS);
+    // runs only while the serial port is open.
+    mMetricCollectorTimer.setInterval(COLLECT_DEBUG_INFO_MS);
     connect(&mMetricCollectorTimer, &QTimer::timeout, this, &Communication::CollectMetrics);
 
     mWaitResponseTimer.setSingleShot(true);
     connect(&mWaitResponseTimer, &QTimer::timeout, this, &Communication::SerialPortReplyTimeout);
+
+    mDelayTimer.setSingleShot(true);
+    mDelayTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mDelayTimer, &QTimer::timeout, this, [this] () {
+        processMessageQueue(true);
+    });
+
+    mShadowKeyframe.start();
 }
 
 Communication::~Communication() {
     CloseSerialPort();
 }
 
+void Communication::setProtectionRules(const QVector<ProtectionEngine::Rule> &rules) {
+    mProtection.setRules(rules);
+}
+
+void Communication::setWatchdogOptions(const Watchdog::Options &options) {
+    mWatchdogOptions = options;
+}
+
 void Communication::OpenSerialPort(const QString &name, int baudRate) {
     CloseSerialPort();
     mSerialPort.setPortName(name);
@@ -52,12 +84,18 @@ void Communication::OpenSerialPort(const QString &name, int baudRate) {
     if (mSerialPort.open(QIODevice::ReadWrite)) {
         mSerialPort.clear();
         mSerialPort.clearError();
+        mMetricsSince = MonotonicClock::nsecs();
+        mMetricCollectorTimer.start();
         emit onSerialPortOpened(name, baudRate);
 
         // The instance of Protocol::Factory is blocking all QT signals of QSerialPort (mSerialPort) until be destroyed.
         auto factory = Protocol::Factory(mSerialPort);
         mDeviceProtocol = factory.createInstance();
         if (mDeviceProtocol != nullptr) {
+            if (mWatchdogOptions.enabled) {
+                mWatchdog = new Watchdog(this, mWatchdogOptions, qintptr(mSerialPort.handle()));
+                mWatchdog->start();
+            }
             emit onDeviceReady(mDeviceProtocol->deviceInfo());
         } else {
             if (factory.deviceID().isEmpty()) {
@@ -72,13 +110,31 @@ void Communication::OpenSerialPort(const QString &name, int baudRate) {
 }
 
 void Communication::CloseSerialPort() {
+    // stop the watchdog before the serial port handle becomes invalid.
+    delete mWatchdog, mWatchdog = nullptr;
+
     while (!mMessageQueue.isEmpty()){
         delete mMessageQueue.dequeue();
     }
+    mReadback = nullptr;
+    mTrialGap = 0;
+    mCommandGap = DELAY_BETWEEN_REQUESTS_MS;
+    mIsDropRequested.storeRelease(0);
 
     delete mDeviceProtocol, mDeviceProtocol = nullptr;
 
+    mMetricCollectorTimer.stop();
+    mDiscardReplySize = 0;
     mMetrics = CommunicationMetrics();
+    mShadow = DeviceShadow();
+    mFrame = Global::TelemetryFrame();
+    mFrameSince = -1;
+    mStatusSampling.reset();
+    for (auto &fieldSampling : mSampling) {
+        for (auto &sampling : fieldSampling) {
+            sampling.reset();
+        }
+    }
 
     if (mSerialPort.isOpen()) {
         mSerialPort.close();
@@ -98,42 +154,111 @@ void Communication::SerialPortErrorOccurred(QSerialPort::SerialPortError error)
 
 void Communication::processMessageQueue(bool clearBusyFlag) {
     if (clearBusyFlag) {
-        mIsBusy = false;
+        setBusy(false);
+    }
+
+    // the watchdog has written the safe state, while this thread was stalled.
+    if (mIsDropRequested.testAndSetOrdered(1, 0)) {
+        dropQueue();
+        pauseQueue(DELAY_BETWEEN_REQUESTS_MS);
+        return;
+    }
+
+    if (!mIsBusy && mMessageQueue.isEmpty()) {
+        publishFrame(); // the poll cycle is over
+        return;
     }
 
-    if (mIsBusy || mMessageQueue.isEmpty()) {
+    qint64 now = MonotonicClock::nsecs();
+    if (mIsBusy || now < mPausedUntil) {
         return;
     }
 
-    mIsBusy = true;
+    // the rest of a reply abandoned by a preemptive command may still come, it mustn't be taken for the next reply.
+    if (mDiscardReplySize > 0) {
+        if (now < mDiscardReplyUntil) {
+            if (!mDelayTimer.isActive()) {
+                mDelayTimer.start(int(qCeil((mDiscardReplyUntil - now) / 1e6)));
+            }
+            return;
+        }
+        mDiscardReplySize = 0;
+        mSerialPort.clear(QSerialPort::Input);
+    }
+
+    setBusy(true);
     auto pMessage = mMessageQueue.head();
-    mSerialPort.write(pMessage->query());
-    mSerialPort.flush();
+    mQueueWaitTime += now - pMessage->enqueueTime();
+    mQueueWaitCount++;
+    pMessage->setSendTime(now);
+    if (!writeToPort(pMessage->query())) {
+        setBusy(false);
+        processMessageQueue(false);
+        return;
+    }
 
     // if the message is command (response is not expected), just remove the message from queue
     // and give some time for execute the action on the devise.
     if (!pMessage->isCommandWithReply()) {
+        int delay = pMessage->isStreamed() ? qCeil(mCommandGap) : DELAY_BETWEEN_REQUESTS_MS;
+        // a command gives no reply, so a shorter gap is tried with a streamed command followed by its readback.
+        Protocol::IMessage *pReadback = nullptr;
+        if (mTrialGap > 0 && mReadback == nullptr && typeid(*pMessage) == typeid(Protocol::MessageRaw)) {
+            pReadback = static_cast<Protocol::MessageRaw*>(pMessage)->takeReadback();
+            if (pReadback != nullptr) {
+                delay = qCeil(mTrialGap);
+                mReadback = pReadback;
+                mReadbackCommand = pMessage->query();
+            }
+        }
+        qint64 tag = pMessage->tag(), sendTime = pMessage->sendTime();
         delete mMessageQueue.dequeue();
-        QTimer::singleShot(DELAY_BETWEEN_REQUESTS_MS, this, [this] () {
-            processMessageQueue(true);
-        });
+        if (pReadback != nullptr) {
+            pReadback->setEnqueueTime(MonotonicClock::nsecs());
+            mMessageQueue.prepend(pReadback);
+        }
+        mDelayTimer.start(delay);
+        if (tag != 0) {
+            emit onCommandWritten(tag, sendTime);
+        }
     } else {
+        mTransactionTimer.start();
         mWaitResponseTimer.start(RESPONSE_TIMEOUT);
     }
 }
 
 void Communication::SerialPortReadyRead() {
+    // no query is written until the abandoned reply is complete, so these bytes are all its.
+    if (mDiscardReplySize > 0) {
+        mDiscardReplySize -= int(mSerialPort.read(mDiscardReplySize).size());
+        if (mDiscardReplySize == 0) {
+            processMessageQueue(false);
+        }
+        return;
+    }
+
     if (mMessageQueue.isEmpty()) {
         mSerialPort.clear();
         return;
     }
 
+    // stamped before anything else is done with the bytes.
+    qint64 arrivalTime = MonotonicClock::nsecs();
     auto pMessage = mMessageQueue.head();
     if (mSerialPort.bytesAvailable() >= pMessage->replySize()) {
         mWaitResponseTimer.stop();
 
+        double transactionTime = mTransactionTimer.nsecsElapsed() / 1e6;
+        mMetrics.transactionTime = mMetrics.transactionTime > 0
+                ? mMetrics.transactionTime + TRANSACTION_TIME_SMOOTHING * (transactionTime - mMetrics.transactionTime)
+                : transactionTime;
+        learnCommandGap(transactionTime);
+
         QByteArray reply(mSerialPort.read(pMessage->replySize()));
-        dispatchMessageReplay(*pMessage, reply);
+        if (pMessage == mReadback) {
+            confirmCommandGap(reply);
+        }
+        dispatchMessageReplay(*pMessage, reply, arrivalTime);
         delete mMessageQueue.dequeue();
 
         processMessageQueue(true);
@@ -142,9 +267,12 @@ void Communication::SerialPortReadyRead() {
 
 void Communication::SerialPortReplyTimeout() {
     mMetrics.responseTimeoutCount++;
+    backOffCommandGap();
     mMessageQueue.clear();
+    mReadback = nullptr;
     mSerialPort.clear();
-    mIsBusy = false;
+    setBusy(false);
+    publishFrame();
 }
 
 bool Communication::isQueueOverflow() const {
@@ -153,6 +281,10 @@ bool Communication::isQueueOverflow() const {
 
 void Communication::enqueueMessage(Protocol::IMessage *pMessage) {
     if (mSerialPort.isOpen()) {
+        pMessage->setEnqueueTime(MonotonicClock::nsecs());
+        if (!pMessage->isCommandWithReply()) {
+            pMessage->setTag(mCommandTag);
+        }
         if (isQueueOverflow() && pMessage->allowToDrop()) {
             mMetrics.droppedCount++;
             delete pMessage;
@@ -162,7 +294,12 @@ void Communication::enqueueMessage(Protocol::IMessage *pMessage) {
         if (pMessage->isCommandWithReply() || mMessageQueue.length() < 2) {
             mMessageQueue.enqueue(pMessage);
         } else {
-            mMessageQueue.insert(1, pMessage); // bring priority for command message.
+            // bring priority for command message, but behind the commands already waiting, so they keep their order.
+            int position = 1;
+            while (position < mMessageQueue.length() && !mMessageQueue.at(position)->isCommandWithReply()) {
+                position++;
+            }
+            mMessageQueue.insert(position, pMessage);
         }
     } else {
         delete pMessage;
@@ -170,34 +307,191 @@ void Communication::enqueueMessage(Protocol::IMessage *pMessage) {
     processMessageQueue(false);
 }
 
+/**
+ * The gap follows the response time of the queries, but a command has no reply: a dropped one would go unnoticed.
+ * So the gap grows right away, and a shorter one is only a trial until the readback of a command written with it
+ * confirms that the device took the command.
+ */
+void Communication::learnCommandGap(double transactionTime) {
+    double target = qBound(double(MIN_COMMAND_GAP_MS), transactionTime * COMMAND_GAP_MARGIN,
+                           double(DELAY_BETWEEN_REQUESTS_MS));
+    double gap = mCommandGap + TRANSACTION_TIME_SMOOTHING * (target - mCommandGap);
+    if (gap >= mCommandGap) {
+        mCommandGap = gap;
+    } else if (mReadback == nullptr && qCeil(gap) < qCeil(mCommandGap)) {
+        mTrialGap = gap;
+    }
+}
+
+/**
+ * The value read back is encoded again: the same command as the one written in the trial gap means the device
+ * took it.
+ */
+void Communication::confirmCommandGap(const QByteArray &reply) {
+    bool ok = false;
+    double value = reply.toDouble(&ok);
+    Protocol::IMessage *pEncoded = nullptr;
+    if (ok && typeid(*mReadback) == typeid(Protocol::MessageGetVoltageSet)) {
+        pEncoded = mDeviceProtocol->createMessageSetVoltage(mReadback->channel(), value);
+    } else if (ok && typeid(*mReadback) == typeid(Protocol::MessageGetCurrentSet)) {
+        pEncoded = mDeviceProtocol->createMessageSetCurrent(mReadback->channel(), value);
+    }
+
+    if (pEncoded != nullptr && pEncoded->query() == mReadbackCommand) {
+        mCommandGap = mTrialGap;
+        mTrialGap = 0;
+    } else {
+        backOffCommandGap();
+    }
+    delete pEncoded;
+    mReadback = nullptr;
+}
+
+void Communication::backOffCommandGap() {
+    mCommandGap = qMin(mCommandGap * 2, double(DELAY_BETWEEN_REQUESTS_MS));
+    mTrialGap = 0;
+}
+
+bool Communication::hasPendingStreamed() const {
+    for (const auto pMessage : mMessageQueue) {
+        if (pMessage->isStreamed()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Communication::setBusy(bool busy) {
+    if (busy && !mIsBusy) {
+        mBusySince = MonotonicClock::nsecs();
+    } else if (!busy && mIsBusy) {
+        mBusyTime += MonotonicClock::nsecs() - mBusySince;
+    }
+    mIsBusy = busy;
+}
+
 void Communication::CollectMetrics() {
+    qint64 now = MonotonicClock::nsecs();
+    if (mIsBusy) {
+        mBusyTime += now - mBusySince;
+        mBusySince = now;
+    }
+    qint64 period = now - mMetricsSince;
+    mMetrics.utilization = period > 0 ? qMin(1.0, double(mBusyTime) / period) : 0;
+    mMetrics.queueWait = mQueueWaitCount > 0 ? mQueueWaitTime / 1e6 / mQueueWaitCount : 0;
+    mBusyTime = 0;
+    mQueueWaitTime = 0;
+    mQueueWaitCount = 0;
+    mMetricsSince = now;
+
+    if (mWatchdog != nullptr) {
+        auto stalls = mWatchdog->stalls();
+        mMetrics.mainLoopStalls = stalls.count[Watchdog::MainLoop];
+        mMetrics.ioLoopStalls = stalls.count[Watchdog::IoLoop];
+        mMetrics.hostSuspends = stalls.hostSuspendCount;
+        mMetrics.maxLoopStall = stalls.maxDuration;
+    }
+
+    collectSampling();
+
+    mMetrics.commandGap = mCommandGap;
     mMetrics.setQueueLength(mMessageQueue.length());
     emit onMetricsReady(mMetrics);
 }
 
-void Communication::dispatchMessageReplay(const Protocol::IMessage &message, const QByteArray &reply) {
+SamplingJitter &Communication::sampling(Global::TelemetryFrame::Field field, Global::Channel channel) {
+    return mSampling[field][channel == Global::Channel1 ? 0 : 1];
+}
+
+void Communication::collectSampling() {
+    // the names are only built here, once per metrics period, not on every reply.
+    static const char *const names[Global::TelemetryFrame::FieldsCount] = {"VSET", "ISET", "VOUT", "IOUT"};
+
+    if (mStatusSampling.stats().count > 0) {
+        mMetrics.sampling["STATUS"] = mStatusSampling.stats();
+    }
+    for (int field = 0; field < Global::TelemetryFrame::FieldsCount; ++field) {
+        for (int channel = 0; channel < 2; ++channel) {
+            auto stats = mSampling[field][channel].stats();
+            if (stats.count > 0) {
+                mMetrics.sampling[QString("%1%2").arg(names[field]).arg(channel + 1)] = stats;
+            }
+        }
+    }
+}
+
+bool Communication::isChanged(DeviceShadow::ChannelField field, Global::Channel channel, double value) {
+    if (mShadow.update(field, channel, value)) {
+        return true;
+    }
+    mMetrics.suppressedCount++;
+    return false;
+}
+
+void Communication::dispatchMessageReplay(const Protocol::IMessage &message, const QByteArray &reply, qint64 arrivalTime) {
+    if (mShadowKeyframe.hasExpired(SHADOW_KEYFRAME_MS)) {
+        mShadow.invalidateAll();
+        mShadowKeyframe.restart();
+    }
+
+    Global::SampleTime time = {message.sendTime(), arrivalTime};
     bool ok = true;
     if (typeid(message) == typeid(Protocol::MessageGetDeviceStatus)) {
-        //mDeviceProtocol->processDeviceStatusReply(reply);
-        emit onGetDeviceStatus(mDeviceProtocol->processDeviceStatusReply(reply));
+        mFrame.Status = mDeviceProtocol->processDeviceStatusReply(reply);
+        mFrame.StatusTime = time;
+        mFrame.IsStatusUpdated = true;
+        mFrame.Timestamp = arrivalTime;
+        if (mFrameSince < 0) {
+            mFrameSince = arrivalTime;
+        }
+        mStatusSampling.sampled(time.Sent, time.Arrived);
     } else if (typeid(message) == typeid(Protocol::MessageGetActualCurrent)) {
-        emit onGetActualCurrent(message.channel(), reply.toDouble(&ok));
+        double current = reply.toDouble(&ok);
+        if (ok) {
+            executeProtectionTrips(mProtection.updateCurrent(message.channel(), current, arrivalTime), arrivalTime);
+            updateFrame(Global::TelemetryFrame::ActualCurrent, message.channel(), current, time);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetActualVoltage)) {
-        emit onGetActualVoltage(message.channel(), reply.toDouble(&ok));
+        double voltage = reply.toDouble(&ok);
+        if (ok) {
+            executeProtectionTrips(mProtection.updateVoltage(message.channel(), voltage, arrivalTime), arrivalTime);
+            updateFrame(Global::TelemetryFrame::ActualVoltage, message.channel(), voltage, time);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetCurrentSet)) {
-        emit onGetCurrentSet(message.channel(), reply.toDouble(&ok));
+        double value = reply.toDouble(&ok);
+        if (ok && isChanged(DeviceShadow::CurrentSet, message.channel(), value)) {
+            updateFrame(Global::TelemetryFrame::CurrentSet, message.channel(), value, time);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetVoltageSet)) {
-        emit onGetVoltageSet(message.channel(), reply.toDouble(&ok));
+        double value = reply.toDouble(&ok);
+        if (ok && isChanged(DeviceShadow::VoltageSet, message.channel(), value)) {
+            updateFrame(Global::TelemetryFrame::VoltageSet, message.channel(), value, time);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetOverCurrentProtectionValue)) {
-        emit onGetOverCurrentProtectionValue(message.channel(), reply.toDouble(&ok));
+        double value = reply.toDouble(&ok);
+        if (ok && isChanged(DeviceShadow::OverCurrentProtectionValue, message.channel(), value)) {
+            emit onGetOverCurrentProtectionValue(message.channel(), value);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetOverVoltageProtectionValue)) {
-        emit onGetOverVoltageProtectionValue(message.channel(), reply.toDouble(&ok));
+        double value = reply.toDouble(&ok);
+        if (ok && isChanged(DeviceShadow::OverVoltageProtectionValue, message.channel(), value)) {
+            emit onGetOverVoltageProtectionValue(message.channel(), value);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetPreset)) {
-        emit onGetPreset(Global::MemoryKey(reply.toInt(&ok)));
+        auto key = Global::MemoryKey(reply.toInt(&ok));
+        if (ok && isChanged(mShadow.Preset, key)) {
+            emit onGetPreset(key);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetIsLocked)) {
-        emit onGetIsLocked(bool(reply.toInt(&ok)));
+        bool locked = bool(reply.toInt(&ok));
+        if (ok && isChanged(mShadow.Locked, locked)) {
+            emit onGetIsLocked(locked);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetIsBeepEnabled)) {
-        emit onGetIsBeepEnabled(bool(reply.toInt(&ok)));
+        bool enabled = bool(reply.toInt(&ok));
+        if (ok && isChanged(mShadow.BeepEnabled, enabled)) {
+            emit onGetIsBeepEnabled(enabled);
+        }
     } else if (typeid(message) == typeid(Protocol::MessageGetDeviceID)) {
         emit onGetDeviceID(reply);
     } else {
@@ -206,10 +500,62 @@ void Communication::dispatchMessageReplay(const Protocol::IMessage &message, con
 
     if (!ok) {
         mMetrics.errorCount++;
+        backOffCommandGap();
+    }
+
+    if (mFrameSince >= 0 && arrivalTime - mFrameSince > FRAME_MAX_AGE_MS * 1000000LL) {
+        publishFrame();
+    }
+}
+
+void Communication::updateFrame(Global::TelemetryFrame::Field field, Global::Channel channel, double value,
+                                const Global::SampleTime &time) {
+    auto &values = mFrame.channel(channel);
+    switch (field) {
+        case Global::TelemetryFrame::VoltageSet:
+            values.VoltageSet = value;
+            break;
+        case Global::TelemetryFrame::CurrentSet:
+            values.CurrentSet = value;
+            break;
+        case Global::TelemetryFrame::ActualVoltage:
+            values.ActualVoltage = value;
+            sampling(field, channel).sampled(time.Sent, time.Arrived);
+            emit onMeasurement(channel, field, value, time);
+            break;
+        case Global::TelemetryFrame::ActualCurrent:
+            values.ActualCurrent = value;
+            sampling(field, channel).sampled(time.Sent, time.Arrived);
+            emit onMeasurement(channel, field, value, time);
+            break;
+        default:
+            return;
+    }
+
+    values.Time[field] = time;
+    mFrame.setUpdated(field, channel);
+    mFrame.Timestamp = time.Arrived;
+    if (mFrameSince < 0) {
+        mFrameSince = time.Arrived;
     }
 }
 
+/**
+ * Publishes the values read since the previous frame in one emission, instead of a signal per reply.
+ */
+void Communication::publishFrame() {
+    if (!mFrame.isUpdated()) {
+        return;
+    }
+
+    mFrame.WallTime = QDateTime::currentMSecsSinceEpoch();
+    emit onTelemetryFrame(mFrame);
+    mFrame.clearUpdated();
+    mFrameSince = -1;
+}
+
 void Communication::SetLocked(bool lock) {
+    mShadow.Locked.valid = false;
     enqueueMessage(mDeviceProtocol->createMessageSetLocked(lock));
 }
 
@@ -218,6 +564,7 @@ void Communication::GetIsLocked() {
 }
 
 void Communication::SetCurrent(Global::Channel channel, double value) {
+    mShadow.invalidate(DeviceShadow::CurrentSet, channel);
     enqueueMessage(mDeviceProtocol->createMessageSetCurrent(channel, value));
 }
 
@@ -226,6 +573,7 @@ void Communication::GetCurrentSet(Global::Channel channel) {
 }
 
 void Communication::SetVoltage(Global::Channel channel, double value) {
+    mShadow.invalidate(DeviceShadow::VoltageSet, channel);
     enqueueMessage(mDeviceProtocol->createMessageSetVoltage(channel, value));
 }
 
@@ -242,10 +590,155 @@ void Communication::GetActualVoltage(Global::Channel channel) {
 }
 
 void Communication::SetEnableOutputSwitch(bool enable) {
+    if (enable) {
+        mProtection.arm();
+    }
+    switchOutput(enable);
+}
+
+void Communication::switchOutput(bool enable) {
     enqueueMessage(mDeviceProtocol->createMessageSetEnableOutputSwitch(enable));
 }
 
+/**
+ * Writes the command right away, without waiting for the in-flight query or the queue. The in-flight query is
+ * abandoned and its late reply is discarded.
+ */
+void Communication::writePreemptive(Protocol::IMessage *pMessage) {
+    abortInFlight();
+
+    writeToPort(pMessage->query(), true);
+    delete pMessage;
+
+    // give the device time to execute the command, as for any other command.
+    pauseQueue(DELAY_BETWEEN_REQUESTS_MS);
+}
+
+void Communication::abortInFlight() {
+    if (mIsBusy && !mMessageQueue.isEmpty() && mWaitResponseTimer.isActive()) {
+        mWaitResponseTimer.stop();
+        auto pAborted = mMessageQueue.dequeue();
+        if (pAborted == mReadback) {
+            mReadback = nullptr;
+        }
+        qint64 received = mSerialPort.read(pAborted->replySize()).size();
+        mDiscardReplySize = pAborted->replySize() - int(received);
+        mDiscardReplyUntil = MonotonicClock::nsecs() + RESPONSE_TIMEOUT * 1000000LL;
+        delete pAborted;
+    }
+}
+
+/**
+ * All the pending messages are dropped, so no setpoint queued before a stall is applied after the safe state.
+ */
+void Communication::dropQueue() {
+    abortInFlight();
+    while (!mMessageQueue.isEmpty()) {
+        delete mMessageQueue.dequeue();
+    }
+    mReadback = nullptr;
+    // the bytes of a command the port didn't take yet.
+    mSerialPort.clear(QSerialPort::Output);
+    mShadow.invalidateAll();
+}
+
+/**
+ * Once the watchdog has written the safe state, only the safe commands are written until the queue is dropped.
+ */
+bool Communication::writeToPort(const QByteArray &data, bool isSafe) {
+    QMutexLocker locker(&mWriteMutex);
+    if (!isSafe && mIsDropRequested.loadAcquire()) {
+        return false;
+    }
+    mSerialPort.write(data);
+    mSerialPort.flush();
+    return true;
+}
+
+/**
+ * The pending command delay is replaced, so it can't end the pause early.
+ */
+void Communication::pauseQueue(int ms) {
+    mPausedUntil = qMax(mPausedUntil, MonotonicClock::nsecs() + ms * 1000000LL);
+    mDelayTimer.start(qMax(ms, mDelayTimer.isActive() ? mDelayTimer.remainingTime() : 0));
+}
+
+/**
+ * Called by the watchdog, when the GUI loop stalls or the host was suspended. The pending messages are dropped and
+ * the first command is written right away; the others are queued, so the command delay between them doesn't block
+ * the thread.
+ */
+void Communication::ApplySafeState(const QList<QByteArray> &commands) {
+    if (!mSerialPort.isOpen() || commands.isEmpty()) {
+        return;
+    }
+
+    mIsDropRequested.storeRelease(0);
+    dropQueue();
+
+    writeToPort(commands.first(), true);
+    for (int i = 1; i < commands.size(); ++i) {
+        auto pMessage = new Protocol::MessageRaw(commands.at(i), false);
+        pMessage->setEnqueueTime(MonotonicClock::nsecs());
+        mMessageQueue.enqueue(pMessage);
+    }
+    pauseQueue(DELAY_BETWEEN_REQUESTS_MS);
+}
+
+/**
+ * Output off ahead of the queue. Pending output switch commands are dropped, so the output can't be turned on
+ * again by a command queued before the emergency.
+ */
+void Communication::EmergencyOutputOff(qint64 requestTime) {
+    if (!mSerialPort.isOpen() || mDeviceProtocol == nullptr) {
+        return;
+    }
+
+    for (int i = mMessageQueue.size() - 1; i >= 0; --i) {
+        if (typeid(*mMessageQueue.at(i)) == typeid(Protocol::MessageSetEnableOutputSwitch)) {
+            delete mMessageQueue.takeAt(i);
+        }
+    }
+    writePreemptive(mDeviceProtocol->createMessageSetEnableOutputSwitch(false));
+
+    mMetrics.emergencyLatency = MonotonicClock::msecsSince(requestTime);
+    emit onEmergencyOutputOffWritten(mMetrics.emergencyLatency);
+}
+
+void Communication::executeProtectionTrips(const QVector<ProtectionEngine::Trip> &trips, qint64 arrivalTime) {
+    if (!trips.isEmpty()) {
+        // the setpoints an engine has streamed would overwrite the action; the engines stop on onProtectionTripped.
+        for (int i = mMessageQueue.size() - 1; i >= 0; --i) {
+            if (mMessageQueue.at(i)->isStreamed()) {
+                delete mMessageQueue.takeAt(i);
+            }
+        }
+    }
+
+    for (const auto &trip : trips) {
+        const auto &rule = mProtection.rules().at(trip.rule);
+        switch (rule.action) {
+            case ProtectionEngine::OutputOff:
+                EmergencyOutputOff(arrivalTime);
+                break;
+            case ProtectionEngine::SetVoltage:
+                mShadow.invalidate(DeviceShadow::VoltageSet, rule.channel);
+                writePreemptive(mDeviceProtocol->createMessageSetVoltage(rule.channel, rule.actionValue));
+                break;
+            case ProtectionEngine::SetCurrent:
+                mShadow.invalidate(DeviceShadow::CurrentSet, rule.channel);
+                writePreemptive(mDeviceProtocol->createMessageSetCurrent(rule.channel, rule.actionValue));
+                break;
+        }
+
+        mMetrics.tripCount++;
+        mMetrics.tripLatency = MonotonicClock::msecsSince(arrivalTime);
+        emit onProtectionTripped(ProtectionEngine::describe(rule, trip.value), mMetrics.tripLatency);
+    }
+}
+
 void Communication::SetEnableBeep(bool enable) {
+    mShadow.BeepEnabled.valid = false;
     enqueueMessage(mDeviceProtocol->createMessageSetEnableBeep(enable));
 }
 
@@ -262,6 +755,7 @@ void Communication::GetDeviceID() {
 }
 
 void Communication::SetPreset(Global::MemoryKey key) {
+    mShadow.invalidateAll(); // recall changes the set values and protection
     enqueueMessage(mDeviceProtocol->createMessageSetPreset(key));
 }
 
@@ -286,6 +780,7 @@ void Communication::SetEnableOverVoltageProtection(bool enable) {
 }
 
 void Communication::SetOverCurrentProtectionValue(Global::Channel channel, double current) {
+    mShadow.invalidate(DeviceShadow::OverCurrentProtectionValue, channel);
     enqueueMessage(mDeviceProtocol->createMessageSetOverCurrentProtectionValue(channel, current));
 }
 
@@ -294,9 +789,26 @@ void Communication::GetOverCurrentProtectionValue(Global::Channel channel) {
 }
 
 void Communication::SetOverVoltageProtectionValue(Global::Channel channel, double voltage) {
+    mShadow.invalidate(DeviceShadow::OverVoltageProtectionValue, channel);
     enqueueMessage(mDeviceProtocol->createMessageSetOverVoltageProtectionValue(channel, voltage));
 }
 
 void Communication::GetOverVoltageProtectionValue(Global::Channel channel) {
     enqueueMessage(mDeviceProtocol->createMessageGetOverVoltageProtectionValue(channel));
 }
+
+/**
+ * A set command encoded ahead of time by the caller, of the field of the channel. It's written ahead of the pending
+ * queries and is followed by the learned command gap, not the fixed delay. The set value of the field is read back,
+ * when the command tries a shorter gap (see learnCommandGap).
+ */
+void Communication::WriteStreamed(Global::Channel channel, DeviceShadow::ChannelField field, const QByteArray &command) {
+    mShadow.invalidate(field, channel);
+    Protocol::IMessage *pReadback = nullptr;
+    if (field == DeviceShadow::VoltageSet) {
+        pReadback = mDeviceProtocol->createMessageGetVoltageSet(channel);
+    } else if (field == DeviceShadow::CurrentSet) {
+        pReadback = mDeviceProtocol->createMessageGetCurrentSet(channel);
+    }
+    enqueueMessage(new Protocol::MessageRaw(command, true, pReadback));
+}
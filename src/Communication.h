@@ -18,22 +18,54 @@
 #ifndef PSC_COMMUNICATION_H
 #define PSC_COMMUNICATION_H
 
+#include <QAtomicInteger>
+#include <QMutex>
 #include <QObject>
 #include <QQueue>
 #include <QTimer>
 #include <QTime>
+#include <QElapsedTimer>
 #include <QtSerialPort/QSerialPort>
 #include <QtSerialPort/QSerialPortInfo>
 
 #include "Global.h"
 #include "protocol/BaseSCPI.h"
 #include "CommunicationMetrics.h"
+#include "DeviceShadow.h"
+#include "ProtectionEngine.h"
+#include "Watchdog.h"
 
 class Communication : public QObject {
     Q_OBJECT
 public:
     explicit Communication(QObject *parent = nullptr);
     ~Communication() override;
+
+    const DeviceShadow &shadow() const { return mShadow; }
+
+    // must be called before the object is moved to the I/O thread.
+    void setProtectionRules(const QVector<ProtectionEngine::Rule> &rules);
+    void setWatchdogOptions(const Watchdog::Options &options);
+
+    void ApplySafeState(const QList<QByteArray> &commands);
+    // thread-safe: the watchdog has written the safe state itself, the queue is dropped before anything else is written.
+    void requestDropQueue() { mIsDropRequested.storeRelease(1); }
+    // held while a command is written, so the watchdog writes between the whole commands.
+    QMutex &writeMutex() { return mWriteMutex; }
+
+    bool isDeviceReady() const { return mDeviceProtocol != nullptr; }
+    // a streamed command waits in the queue, I/O thread only.
+    bool hasPendingStreamed() const;
+    double commandGap() const { return mCommandGap; }
+    // the commands queued until it's set back to 0 carry the tag, I/O thread only.
+    void setCommandTag(qint64 tag) { mCommandTag = tag; }
+    // unique among the engines, so they can run side by side.
+    qint64 newCommandTag() { return ++mLastCommandTag; }
+    // the output switch of the automation engines, I/O thread only. Unlike SetEnableOutputSwitch, the command of the
+    // user, it doesn't re-arm a tripped protection, so a looped OUT on can't undo a trip.
+    void switchOutput(bool enable);
+    // a run the user started is protected again, I/O thread only.
+    void armProtection() { mProtection.arm(); }
 signals:
     void onSerialPortOpened(QString serialPortName, int baudRate);
     void onSerialPortClosed();
@@ -42,14 +74,17 @@ signals:
     void onUnknownDevice(QString deviceID);
 
     void onMetricsReady(const CommunicationMetrics &info);
+    void onEmergencyOutputOffWritten(double latency);
+    // a tagged command was written to the serial port at sendTime (ns, MonotonicClock).
+    void onCommandWritten(qint64 tag, qint64 sendTime);
+    void onProtectionTripped(const QString &description, double latency);
 
     void onGetIsLocked(bool locked);
-    void onGetCurrentSet(Global::Channel channel, double current);
-    void onGetVoltageSet(Global::Channel channel, double voltage);
-    void onGetActualCurrent(Global::Channel channel, double current);
-    void onGetActualVoltage(Global::Channel channel, double voltage);
+    void onTelemetryFrame(const Global::TelemetryFrame &frame);
+    // every VOUT and IOUT reading as it arrives, for the control loops on the I/O thread (direct connections only).
+    void onMeasurement(Global::Channel channel, Global::TelemetryFrame::Field field, double value,
+                       const Global::SampleTime &time);
     void onGetIsBeepEnabled(bool enabled);
-    void onGetDeviceStatus(Global::DeviceStatus status);
     void onGetDeviceID(const QString &info);
     void onGetPreset(Global::MemoryKey key);
     void onGetOverCurrentProtectionValue(Global::Channel channel, double current);
@@ -68,6 +103,7 @@ public slots:
     void GetActualCurrent(Global::Channel channel);
     void GetActualVoltage(Global::Channel channel);
     void SetEnableOutputSwitch(bool enable);
+    void EmergencyOutputOff(qint64 requestTime);
     void SetEnableBeep(bool enable);
     void GetIsBuzzerEnabled();
     void GetDeviceStatus();
@@ -82,6 +118,7 @@ public slots:
     void GetOverCurrentProtectionValue(Global::Channel channel);
     void SetOverVoltageProtectionValue(Global::Channel channel, double voltage);
     void GetOverVoltageProtectionValue(Global::Channel channel);
+    void WriteStreamed(Global::Channel channel, DeviceShadow::ChannelField field, const QByteArray &command);
 
 private slots:
     void SerialPortReadyRead();
@@ -92,19 +129,73 @@ private slots:
 
 private:
     void processMessageQueue(bool clearBusyFlag);
-    void dispatchMessageReplay(const Protocol::IMessage &message, const QByteArray &reply);
+    void dispatchMessageReplay(const Protocol::IMessage &message, const QByteArray &reply, qint64 arrivalTime);
+    void abortInFlight();
+    void dropQueue();
+    void pauseQueue(int ms);
+    bool writeToPort(const QByteArray &data, bool isSafe = false);
+    void writePreemptive(Protocol::IMessage *pMessage);
+    void executeProtectionTrips(const QVector<ProtectionEngine::Trip> &trips, qint64 arrivalTime);
     void enqueueMessage(Protocol::IMessage *pMessage);
+    void updateFrame(Global::TelemetryFrame::Field field, Global::Channel channel, double value,
+                     const Global::SampleTime &time);
+    void publishFrame();
+    SamplingJitter &sampling(Global::TelemetryFrame::Field field, Global::Channel channel);
+    void collectSampling();
+    void learnCommandGap(double transactionTime);
+    void confirmCommandGap(const QByteArray &reply);
+    void backOffCommandGap();
+    void setBusy(bool busy);
     bool isQueueOverflow() const;
+    bool isChanged(DeviceShadow::ChannelField field, Global::Channel channel, double value);
+    template<typename T> bool isChanged(DeviceShadow::Value<T> &shadow, const T &value) {
+        if (shadow.update(value)) {
+            return true;
+        }
+        mMetrics.suppressedCount++;
+        return false;
+    }
 
 private:
     QSerialPort                  mSerialPort;
+    QMutex                       mWriteMutex;
+    QAtomicInt                   mIsDropRequested {0};
     QQueue<Protocol::IMessage*>  mMessageQueue;
     QTimer                       mWaitResponseTimer;
+    QTimer                       mDelayTimer;          // the command delay and the pauses, a pause replaces a delay
+    QElapsedTimer                mTransactionTimer;
+    int                          mDiscardReplySize = 0; // reply bytes of a query aborted by the emergency off
+    qint64                       mDiscardReplyUntil = 0; // ns, MonotonicClock, no query is written meanwhile
+    qint64                       mPausedUntil = 0;       // ns, MonotonicClock, the queue waits for a preemptive command
+    qint64                       mBusySince = 0;       // ns, MonotonicClock
+    qint64                       mBusyTime = 0;        // ns, since the last metrics collection
+    qint64                       mMetricsSince = 0;    // ns, MonotonicClock
+    qint64                       mQueueWaitTime = 0;   // ns, since the last metrics collection
+    int                          mQueueWaitCount = 0;
     volatile bool                mIsBusy = false;
+    double                       mCommandGap;          // ms, after a streamed command
+    double                       mTrialGap = 0;        // ms, a shorter gap until a readback confirms it, 0 -- none
+    Protocol::IMessage           *mReadback = nullptr; // queued, reads back the command written in the trial gap
+    QByteArray                   mReadbackCommand;
+    qint64                       mCommandTag = 0;      // see setCommandTag
+    qint64                       mLastCommandTag = 0;  // see newCommandTag
     Protocol::BaseSCPI*          mDeviceProtocol = nullptr;
 
     QTimer                       mMetricCollectorTimer;
     CommunicationMetrics         mMetrics;
+
+    DeviceShadow                 mShadow;
+    QElapsedTimer                mShadowKeyframe;
+
+    Global::TelemetryFrame       mFrame;
+    qint64                       mFrameSince = -1;     // ns, MonotonicClock, the first update of the pending frame
+    SamplingJitter               mSampling[Global::TelemetryFrame::FieldsCount][2]; // by field and channel
+    SamplingJitter               mStatusSampling;      // see CommunicationMetrics::sampling
+
+    ProtectionEngine             mProtection;
+
+    Watchdog::Options            mWatchdogOptions;
+    Watchdog                     *mWatchdog = nullptr;
 };
 
 
@@ -21,11 +21,35 @@
 #include <QtGlobal>
 #include <QQueue>
 #include <QDebug>
+#include <QMetaType>
+#include <QMap>
+#include "SamplingJitter.h"
 
 struct CommunicationMetrics {
     int errorCount = 0;
     int droppedCount = 0;
     int responseTimeoutCount = 0;
+    int suppressedCount = 0;   // replies not published, because the value didn't change
+    double transactionTime = 0; // ms, average time from writing a query to receiving its reply
+    double commandGap = 0;      // ms, learned pause after a streamed command, see Communication::WriteStreamed
+    double utilization = 0;     // 0..1, share of the last period the link was busy
+    double queueWait = 0;       // ms, average time a message waited in the queue during the last period
+    double emergencyLatency = 0; // ms, from the last emergency output off request to the command written
+    int tripCount = 0;           // host side protection trips
+    double tripLatency = 0;      // ms, from the sample arrival to the command written, last trip
+    int mainLoopStalls = 0;      // watchdog: GUI event loop stalls above the threshold
+    int ioLoopStalls = 0;        // watchdog: I/O event loop stalls above the threshold
+    int hostSuspends = 0;        // watchdog: host sleep detected
+    double maxLoopStall = 0;     // ms, the longest stall of either loop
+    QMap<QString, SamplingJitter::Stats> sampling; // arrival interval statistics by field: "STATUS", "VOUT1", ...
+
+    double maxSamplingJitter() const {
+        double jitter = 0;
+        for (const auto &stats : sampling) {
+            jitter = qMax(jitter, stats.jitter);
+        }
+        return jitter;
+    }
 
     void setQueueLength(int len) {
         mQueueLengthList.enqueue(len);
@@ -48,4 +72,6 @@ private:
 };
 
 
+Q_DECLARE_METATYPE(CommunicationMetrics)
+
 #endif //PS_MANAGEMENT_COMMUNICATIONMETRICS_H
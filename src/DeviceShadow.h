@@ -0,0 +1,88 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_DEVICESHADOW_H
+#define PS_MANAGEMENT_DEVICESHADOW_H
+
+#include "Global.h"
+
+/**
+ * Last known state of the device settings. Communication publishes a decoded reply only if update()
+ * reports a change; invalidated values are published again with the next reply.
+ */
+class DeviceShadow {
+public:
+    enum ChannelField {
+        VoltageSet,
+        CurrentSet,
+        OverVoltageProtectionValue,
+        OverCurrentProtectionValue,
+        ChannelFieldsCount
+    };
+
+    template<typename T>
+    struct Value {
+        T    value {};
+        bool valid = false;
+
+        bool update(const T &newValue) {
+            if (valid && newValue == value) {
+                return false;
+            }
+            value = newValue;
+            valid = true;
+            return true;
+        }
+    };
+
+    bool update(ChannelField field, Global::Channel channel, double value) {
+        return mChannelValues[field][index(channel)].update(value);
+    }
+
+    double value(ChannelField field, Global::Channel channel) const {
+        return mChannelValues[field][index(channel)].value;
+    }
+
+    bool isValid(ChannelField field, Global::Channel channel) const {
+        return mChannelValues[field][index(channel)].valid;
+    }
+
+    void invalidate(ChannelField field, Global::Channel channel) {
+        mChannelValues[field][index(channel)].valid = false;
+    }
+
+    void invalidateAll() {
+        for (auto &field : mChannelValues) {
+            for (auto &value : field) {
+                value.valid = false;
+            }
+        }
+        Locked.valid = false;
+        BeepEnabled.valid = false;
+        Preset.valid = false;
+    }
+
+public:
+    Value<bool>                 Locked;
+    Value<bool>                 BeepEnabled;
+    Value<Global::MemoryKey>    Preset;
+
+private:
+    static int index(Global::Channel channel) {
+        return channel == Global::Channel1 ? 0 : 1;
+    }
+
+    Value<double> mChannelValues[ChannelFieldsCount][2];
+};
+
+#endif //PS_MANAGEMENT_DEVICESHADOW_H
@@ -0,0 +1,83 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_EVENTLOOPMETRICS_H
+#define PS_MANAGEMENT_EVENTLOOPMETRICS_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QMap>
+#include <QMetaType>
+
+/**
+ * Event dispatch times of the GUI thread, collected by EventLoopMonitor. A dispatch time is the time the handler
+ * itself was busy: nested dispatches and the idle time of nested event loops (modal dialogs) are excluded.
+ */
+struct EventLoopMetrics {
+    static const int BUCKETS_COUNT = 12; // [0, 1) ms, [1, 2), [2, 4) ... [1024, inf)
+
+    struct Stall {
+        int    count = 0;
+        double total = 0; // ms
+        double max = 0;   // ms
+    };
+
+    quint64 histogram[BUCKETS_COUNT] = {};
+    quint64 dispatchCount = 0;
+    double  maxDispatch = 0;      // ms
+    QString maxDispatchSource;
+    QMap<QString, Stall> stalls;  // dispatches above the stall threshold by source "Receiver/Event"
+
+    static int bucket(double ms) {
+        int index = 0;
+        for (double limit = 1; index < BUCKETS_COUNT - 1 && ms >= limit; limit *= 2) {
+            index++;
+        }
+        return index;
+    }
+
+    static QString bucketName(int index) {
+        if (index == 0) {
+            return "<1ms";
+        }
+        return index == BUCKETS_COUNT - 1 ? QString(">=%1ms").arg(1 << (index - 1))
+                                          : QString("<%1ms").arg(1 << index);
+    }
+
+    // bucket of the dispatch time that the given fraction (0..1) of the dispatches doesn't exceed, -1 if none yet.
+    int percentileBucket(double fraction) const {
+        if (dispatchCount == 0) {
+            return -1;
+        }
+        quint64 count = 0;
+        for (int i = 0; i < BUCKETS_COUNT; ++i) {
+            count += histogram[i];
+            if (count >= fraction * dispatchCount) {
+                return i;
+            }
+        }
+        return BUCKETS_COUNT - 1;
+    }
+
+    quint64 stallsCount() const {
+        quint64 count = 0;
+        for (const auto &stall : stalls) {
+            count += stall.count;
+        }
+        return count;
+    }
+};
+
+Q_DECLARE_METATYPE(EventLoopMetrics)
+
+#endif //PS_MANAGEMENT_EVENTLOOPMETRICS_H
@@ -0,0 +1,102 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "EventLoopMonitor.h"
+#include "MonotonicClock.h"
+
+#include <QAbstractEventDispatcher>
+#include <QMetaEnum>
+#include <QStringList>
+#include <QDebug>
+
+EventLoopMonitor::EventLoopMonitor(QObject *parent) : QObject(parent) {
+    auto dispatcher = QAbstractEventDispatcher::instance(thread());
+    if (dispatcher != nullptr) {
+        connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, [this] () {
+            mBlockedAt = MonotonicClock::nsecs();
+        });
+        connect(dispatcher, &QAbstractEventDispatcher::awake, this, [this] () {
+            if (mBlockedAt >= 0) {
+                mIdleTotal += MonotonicClock::nsecs() - mBlockedAt;
+                mBlockedAt = -1;
+            }
+        });
+    }
+    mFrames.reserve(16);
+}
+
+void EventLoopMonitor::begin() {
+    mFrames.append({MonotonicClock::nsecs(), mIdleTotal, 0});
+}
+
+void EventLoopMonitor::end(const QObject *receiver, const QEvent *event) {
+    if (mFrames.isEmpty()) {
+        return;
+    }
+
+    Frame frame = mFrames.takeLast();
+    qint64 busy = MonotonicClock::nsecs() - frame.start - (mIdleTotal - frame.idleStart);
+    if (!mFrames.isEmpty()) {
+        mFrames.last().children += busy;
+    }
+
+    double ms = (busy - frame.children) / 1e6;
+    mMetrics.histogram[EventLoopMetrics::bucket(ms)]++;
+    mMetrics.dispatchCount++;
+
+    if (ms >= mStallThreshold || ms > mMetrics.maxDispatch) {
+        QString name = source(receiver, event);
+        if (ms > mMetrics.maxDispatch) {
+            mMetrics.maxDispatch = ms;
+            mMetrics.maxDispatchSource = name;
+        }
+        if (ms >= mStallThreshold) {
+            auto &stall = mMetrics.stalls[name];
+            stall.count++;
+            stall.total += ms;
+            stall.max = qMax(stall.max, ms);
+            qWarning().noquote() << QString("Event loop stalled for %1 ms by %2").arg(ms, 0, 'f', 1).arg(name);
+        }
+    }
+}
+
+QString EventLoopMonitor::source(const QObject *receiver, const QEvent *event) {
+    QString name = receiver->metaObject()->className();
+    if (!receiver->objectName().isEmpty()) {
+        name += "(" + receiver->objectName() + ")";
+    }
+
+    static const QMetaEnum types = QMetaEnum::fromType<QEvent::Type>();
+    const char *type = types.valueToKey(event->type());
+    return name + "/" + (type != nullptr ? QString(type) : QString::number(event->type()));
+}
+
+QString EventLoopMonitor::report() const {
+    QStringList lines;
+    lines << QString("Event loop: %1 dispatches, max %2 ms by %3")
+            .arg(mMetrics.dispatchCount).arg(mMetrics.maxDispatch, 0, 'f', 1).arg(mMetrics.maxDispatchSource);
+
+    QStringList histogram;
+    for (int i = 0; i < EventLoopMetrics::BUCKETS_COUNT; ++i) {
+        if (mMetrics.histogram[i] > 0) {
+            histogram << QString("%1:%2").arg(EventLoopMetrics::bucketName(i)).arg(mMetrics.histogram[i]);
+        }
+    }
+    lines << "  histogram " + histogram.join(' ');
+
+    for (auto it = mMetrics.stalls.cbegin(); it != mMetrics.stalls.cend(); ++it) {
+        lines << QString("  stall %1: %2 times, total %3 ms, max %4 ms")
+                .arg(it.key()).arg(it->count).arg(it->total, 0, 'f', 1).arg(it->max, 0, 'f', 1);
+    }
+    return lines.join('\n');
+}
@@ -0,0 +1,56 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_EVENTLOOPMONITOR_H
+#define PS_MANAGEMENT_EVENTLOOPMONITOR_H
+
+#include <QObject>
+#include <QEvent>
+#include <QVector>
+#include "EventLoopMetrics.h"
+
+/**
+ * Measures the dispatch time of every event of the GUI thread (Application::notify() calls begin() and end())
+ * and attributes the long ones to the receiver and the event type.
+ */
+class EventLoopMonitor : public QObject {
+    Q_OBJECT
+public:
+    explicit EventLoopMonitor(QObject *parent = nullptr);
+
+    void setStallThreshold(int ms) { mStallThreshold = ms; }
+
+    void begin();
+    void end(const QObject *receiver, const QEvent *event);
+
+    const EventLoopMetrics &metrics() const { return mMetrics; }
+    QString report() const;
+
+private:
+    static QString source(const QObject *receiver, const QEvent *event);
+
+private:
+    struct Frame {
+        qint64 start;     // ns
+        qint64 idleStart; // ns, mIdleTotal at the start
+        qint64 children;  // ns, busy time of the nested dispatches
+    };
+
+    QVector<Frame>      mFrames;
+    qint64              mIdleTotal = 0;   // ns, time the loop waited for events
+    qint64              mBlockedAt = -1;  // ns
+    int                 mStallThreshold = 100;
+    EventLoopMetrics    mMetrics;
+};
+
+#endif //PS_MANAGEMENT_EVENTLOOPMONITOR_H
@@ -19,6 +19,7 @@
 #define POWER_SUPPLY_CONTROLLER_GLOBAL_H
 
 #include <QString>
+#include <QMetaType>
 
 namespace Global {
     enum Channel {
@@ -75,6 +76,64 @@ namespace Global {
 
         int ActiveChannelsCount;       // Only active channels, ignore fixed.
     };
+
+    // MonotonicClock times (ns) of a sample: its query written and the complete reply seen.
+    struct SampleTime {
+        qint64 Sent = 0;
+        qint64 Arrived = 0;
+    };
+
+    // the values of a channel in a TelemetryFrame, inherited by it as TelemetryFrame::Field.
+    struct TelemetryFields {
+        enum Field {
+            VoltageSet,
+            CurrentSet,
+            ActualVoltage,
+            ActualCurrent,
+            FieldsCount
+        };
+    };
+
+    struct ChannelFrame {
+        double VoltageSet = 0.0;
+        double CurrentSet = 0.0;
+        double ActualVoltage = 0.0;
+        double ActualCurrent = 0.0;
+        SampleTime Time[TelemetryFields::FieldsCount];  // indexed by TelemetryFrame::Field
+    };
+
+    // Snapshot of the device published by Communication once per poll cycle. All the values are the latest known,
+    // the Updated bits tell which of them were read in this cycle.
+    struct TelemetryFrame : TelemetryFields {
+        qint64          Timestamp = 0; // ns, MonotonicClock, arrival of the last reply of the cycle
+        qint64          WallTime = 0;  // ms since epoch
+        ChannelFrame    Ch1;
+        ChannelFrame    Ch2;
+        DeviceStatus    Status = {};
+        SampleTime      StatusTime;
+        bool            IsStatusUpdated = false;
+        quint8          Updated = 0;
+
+        static quint8 bit(Field field, Channel channel) {
+            return quint8(1u << (field + (channel == Channel1 ? 0 : FieldsCount)));
+        }
+        bool isUpdated(Field field, Channel channel) const { return Updated & bit(field, channel); }
+        bool isUpdated() const { return Updated != 0 || IsStatusUpdated; }
+        void setUpdated(Field field, Channel channel) { Updated |= bit(field, channel); }
+        void clearUpdated() { Updated = 0, IsStatusUpdated = false; }
+
+        ChannelFrame &channel(Channel ch) { return ch == Channel1 ? Ch1 : Ch2; }
+        const ChannelFrame &channel(Channel ch) const { return ch == Channel1 ? Ch1 : Ch2; }
+    };
 }
 
+// queued connections between the GUI and the I/O thread.
+Q_DECLARE_METATYPE(Global::Channel)
+Q_DECLARE_METATYPE(Global::MemoryKey)
+Q_DECLARE_METATYPE(Global::ChannelsTracking)
+Q_DECLARE_METATYPE(Global::OutputProtection)
+Q_DECLARE_METATYPE(Global::DeviceStatus)
+Q_DECLARE_METATYPE(Global::DeviceInfo)
+Q_DECLARE_METATYPE(Global::TelemetryFrame)
+
 #endif //POWER_SUPPLY_CONTROLLER_GLOBAL_H
@@ -15,10 +15,15 @@
 #include "ui_mainwindow.h"
 
 #include <QDebug>
+#include <QDateTime>
+#include <QEvent>
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QMessageBox>
 #include <QSerialPortInfo>
 
 #include "Application.h"
+#include "MonotonicClock.h"
 
 const double V0 = 0.00;
 const double A0 = 0.000;
@@ -62,6 +67,10 @@ void MainWindow::setupUI() {
     connect(ui->actionDisconnect, &QAction::triggered, this, &MainWindow::onSerialPortDoClose);
     connect(ui->actionLockDevice, &QAction::toggled, this, &MainWindow::onSetLocked);
     connect(ui->actionBuzzer, &QAction::toggled, this, &MainWindow::onSetEnabledBeep);
+    ui->actionTelemetryLog->setChecked(mSettings.isTelemetryLogEnabled());
+    connect(ui->actionTelemetryLog, &QAction::toggled, this, &MainWindow::SetEnableTelemetryLog);
+    connect(ui->actionRunSequence, &QAction::triggered, this, &MainWindow::RunSequence);
+    connect(ui->actionStopSequence, &QAction::triggered, this, &MainWindow::onStopSequence);
     connect(ui->actionExit, &QAction::triggered, this, &QWidget::close);
     connect(ui->menuPort, &QMenu::aboutToShow, this, &MainWindow::CreateSerialPortMenuItems);
     connect(ui->menuHelp, &QMenu::triggered, this, &MainWindow::ShowAboutBox);
@@ -71,10 +80,12 @@ void MainWindow::setupUI() {
     setStatusBar(mStatusBar);
 
     auto display = new DisplayWidget(this);
+    display->setMaximumRefreshRate(mSettings.displayRefreshRate());
     ui->layoutDisplayCh1->addWidget(display);
     mDisplay[Global::Channel1] = display;
 
     display = new DisplayWidget(this);
+    display->setMaximumRefreshRate(mSettings.displayRefreshRate());
     ui->layoutDisplayCh2->addWidget(display);
     mDisplay[Global::Channel2] = display;
 
@@ -115,9 +126,19 @@ void MainWindow::setupUI() {
     ui->groupBoxChannelsTracking->layout()->addWidget(mChannelsTracking);
     connect(mChannelsTracking, &ChannelsTrackingWidget::onSetChannelsTracking, this, &MainWindow::onSetChannelsTracking);
 
+    mChartWindow = new ChartWindow(this);
+    connect(ui->actionShowCharts, &QAction::toggled, this, &MainWindow::ShowCharts);
+    connect(mChartWindow, &ChartWindow::onClosed, this, [=] () { ui->actionShowCharts->setChecked(false); });
+
     mOutputSwitch = new OutputSwitch(this);
     ui->outputSwitchLayout->addWidget(mOutputSwitch);
-    connect(mOutputSwitch, &QPushButton::clicked, this,&MainWindow::onSetEnableOutputSwitch);
+    connect(mOutputSwitch, &QPushButton::clicked, this, [=] (bool checked) {
+        if (checked) {
+            emit onSetEnableOutputSwitch(true);
+        } else {
+            emit onEmergencyOutputOff(MonotonicClock::nsecs());
+        }
+    });
 }
 
 template<typename func>
@@ -152,7 +173,96 @@ void MainWindow::SerialPortErrorOccurred(const QString &error) {
     QMessageBox::warning(this, tr("Serial Port Error Occurred"),error, QMessageBox::Close);
 }
 
+void MainWindow::TelemetryLogErrorOccurred(const QString &error) {
+    ui->actionTelemetryLog->setChecked(false);
+    QMessageBox::warning(this, tr("Telemetry Log Error Occurred"), error, QMessageBox::Close);
+}
+
+void MainWindow::ProtectionTripped(const QString &description, double latency) {
+    // not a message box, a modal dialog would block the event loop while the output is being handled.
+    mStatusBar->showMessage(tr("Protection tripped: %1 (%2 ms)").arg(description).arg(latency, 0, 'f', 2));
+}
+
+void MainWindow::SequenceStarted(const QString &fileName) {
+    ui->actionStopSequence->setEnabled(true);
+    mStatusBar->showMessage(tr("Sequence %1 is running").arg(QFileInfo(fileName).fileName()));
+}
+
+void MainWindow::SequenceFinished(const Sequencer::Report &report) {
+    ui->actionStopSequence->setEnabled(false);
+    mStatusBar->showMessage(tr("Sequence %1 %2 after %3 s, lateness mean %4 ms, max %5 ms")
+                                    .arg(QFileInfo(report.fileName).fileName())
+                                    .arg(report.isCompleted ? tr("completed") : tr("stopped"))
+                                    .arg(report.elapsed, 0, 'f', 1)
+                                    .arg(report.meanLateness, 0, 'f', 1)
+                                    .arg(report.maxLateness, 0, 'f', 1));
+}
+
+void MainWindow::ListFinished(const ListPlayer::Report &report) {
+    ui->actionStopSequence->setEnabled(false);
+    mStatusBar->showMessage(tr("List %1 %2 after %3 s, %4 of %5 points at %6/s, %7 missed deadlines")
+                                    .arg(QFileInfo(report.fileName).fileName())
+                                    .arg(report.isCompleted ? tr("completed") : tr("stopped"))
+                                    .arg(report.elapsed, 0, 'f', 1)
+                                    .arg(report.sent)
+                                    .arg(report.points)
+                                    .arg(report.rate, 0, 'f', 1)
+                                    .arg(report.missedDeadlines()));
+}
+
+void MainWindow::SweepFinished(const SweepEngine::Result &result) {
+    ui->actionStopSequence->setEnabled(false);
+    QString message = tr("Sweep %1 %2 after %3 s, %4 points (%5 refined, %6 unsettled, %7 without readings)")
+            .arg(QFileInfo(result.fileName).fileName())
+            .arg(result.isCompleted ? tr("completed") : tr("stopped"))
+            .arg(result.elapsed, 0, 'f', 1)
+            .arg(result.points.size())
+            .arg(result.refinedCount)
+            .arg(result.unsettledCount)
+            .arg(result.missingCount);
+    if (!result.tableFileName.isEmpty()) {
+        message += tr(", saved to %1").arg(QFileInfo(result.tableFileName).fileName());
+    }
+    mStatusBar->showMessage(message);
+}
+
+void MainWindow::UpdateRegulatorStatus(const SoftwareRegulator::Status &status) {
+    ui->actionStopSequence->setEnabled(status.isRunning);
+    QString unit = status.mode == SoftwareRegulator::ConstantPower ? tr("W") : tr("Ohm");
+    mStatusBar->showMessage(tr("%1 %2 %3%4: %5 %3 at %6 Hz, error %7%%8")
+                                    .arg(status.mode == SoftwareRegulator::ConstantPower ? tr("CP") : tr("CR"))
+                                    .arg(status.target)
+                                    .arg(unit)
+                                    .arg(status.isRunning ? QString() : tr(" stopped"))
+                                    .arg(status.actual, 0, 'f', 2)
+                                    .arg(status.loopRate, 0, 'f', 1)
+                                    .arg(status.relativeError, 0, 'f', 1)
+                                    .arg(status.isCurrentLimited ? tr(", current limited") : QString()));
+}
+
+void MainWindow::UpdateChargeStatus(const ChargeEngine::Status &status) {
+    ui->actionStopSequence->setEnabled(status.isRunning);
+    QString message = tr("Charge %1 %2: %3 V, %4 A, %5 Ah, %6 Wh")
+            .arg(QFileInfo(status.fileName).fileName())
+            .arg(ChargeEngine::phaseName(status.phase))
+            .arg(status.voltage, 0, 'f', 3)
+            .arg(status.current, 0, 'f', 3)
+            .arg(status.charge, 0, 'f', 3)
+            .arg(status.energy, 0, 'f', 2);
+    if (!status.isRunning) {
+        message += tr(", finished: %1").arg(ChargeEngine::terminationName(status.termination));
+    }
+    mStatusBar->showMessage(message);
+}
+
+void MainWindow::SequenceErrorOccurred(const QString &error) {
+    QMessageBox::warning(this, tr("Sequence Error"), error, QMessageBox::Close);
+}
+
 void MainWindow::ConnectionDeviceReady(const Global::DeviceInfo &info) {
+    if (info.ID != mDeviceInfo.ID) {
+        mChartWindow->clear();
+    }
     mDeviceInfo = info;
     ShowDeviceNameOrID();
     setControlLimits(info);
@@ -167,11 +277,89 @@ void MainWindow::ConnectionUnknownDevice(const QString& deviceID) {
 }
 
 void MainWindow::UpdateCommunicationMetrics(const CommunicationMetrics &info) {
-    mStatusBar->setText(tr("Q:%1 E:%2 D:%3 T:%4")
-                                  .arg(info.queueLength())
-                                  .arg(info.errorCount)
-                                  .arg(info.droppedCount)
-                                  .arg(info.responseTimeoutCount), StatusBar::DebugInfo);
+    mMetricsInfo = tr("Q:%1 E:%2 D:%3 T:%4 S:%5 U:%6% W:%7ms RTT:%8ms")
+                           .arg(info.queueLength())
+                           .arg(info.errorCount)
+                           .arg(info.droppedCount)
+                           .arg(info.responseTimeoutCount)
+                           .arg(info.suppressedCount)
+                           .arg(qRound(info.utilization * 100))
+                           .arg(qRound(info.queueWait))
+                           .arg(info.transactionTime, 0, 'f', 1);
+    if (!info.sampling.isEmpty()) {
+        mMetricsInfo += tr(" J:%1ms").arg(info.maxSamplingJitter(), 0, 'f', 1);
+    }
+    if (info.emergencyLatency > 0) {
+        mMetricsInfo += tr(" OFF:%1ms").arg(info.emergencyLatency, 0, 'f', 2);
+    }
+    if (info.tripCount > 0) {
+        mMetricsInfo += tr(" TRIP:%1/%2ms").arg(info.tripCount).arg(info.tripLatency, 0, 'f', 2);
+    }
+    if (info.mainLoopStalls + info.ioLoopStalls + info.hostSuspends > 0) {
+        mMetricsInfo += tr(" STALL:%1/%2/%3 %4ms")
+                .arg(info.mainLoopStalls)
+                .arg(info.ioLoopStalls)
+                .arg(info.hostSuspends)
+                .arg(qRound(info.maxLoopStall));
+    }
+    updateDebugInfo();
+}
+
+void MainWindow::changeEvent(QEvent *event) {
+    QMainWindow::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange) {
+        updateVisibility();
+    }
+}
+
+void MainWindow::showEvent(QShowEvent *event) {
+    QMainWindow::showEvent(event);
+    updateVisibility();
+}
+
+void MainWindow::hideEvent(QHideEvent *event) {
+    QMainWindow::hideEvent(event);
+    updateVisibility();
+}
+
+void MainWindow::updateVisibility() {
+    bool visible = isVisible() && !isMinimized();
+    if (mIsVisible != visible) {
+        mIsVisible = visible;
+        emit onVisibilityChanged(visible);
+    }
+}
+
+void MainWindow::UpdatePollRate(double rate, const QString &state) {
+    mPollRateInfo = tr("R:%1/s%2").arg(rate, 0, 'f', 1).arg(state);
+}
+
+void MainWindow::UpdateWakeupRate(double wakeupsPerSecond) {
+    mWakeupInfo = tr("WK:%1/s").arg(wakeupsPerSecond, 0, 'f', 1);
+    updateDebugInfo();
+}
+
+void MainWindow::UpdateEventLoopMetrics(const EventLoopMetrics &metrics) {
+    mEventLoopInfo = tr("EL:%1ms").arg(qRound(metrics.maxDispatch));
+    int p50 = metrics.percentileBucket(0.5), p99 = metrics.percentileBucket(0.99);
+    if (p50 >= 0) {
+        mEventLoopInfo += tr(" p50%1 p99%2").arg(EventLoopMetrics::bucketName(p50), EventLoopMetrics::bucketName(p99));
+    }
+    quint64 stalls = metrics.stallsCount();
+    if (stalls > 0) {
+        mEventLoopInfo += tr("/%1 %2").arg(stalls).arg(metrics.maxDispatchSource);
+    }
+    updateDebugInfo();
+}
+
+void MainWindow::updateDebugInfo() {
+    QStringList info;
+    for (const auto &text : {mMetricsInfo, mPollRateInfo, mWakeupInfo, mEventLoopInfo}) {
+        if (!text.isEmpty()) {
+            info << text;
+        }
+    }
+    mStatusBar->setText(info.join(' '), StatusBar::DebugInfo);
 }
 
 void MainWindow::SerialPortClosed() {
@@ -181,19 +369,31 @@ void MainWindow::SerialPortClosed() {
     mStatusBar->setText(tr("Disconnected"), StatusBar::ConnectionStatus);
     mStatusBar->setText(tr("N/A"), StatusBar::DeviceInfo);
     mStatusBar->setText(tr("N/A"), StatusBar::LockStatus);
+    mMetricsInfo.clear();
+    mPollRateInfo.clear();
+    updateDebugInfo();
 
     UpdateChannelTrackingMode(Global::Independent);
     enableControls(false);
 
-    UpdateActualVoltage(Global::Channel1, V0);
-    UpdateActualVoltage(Global::Channel2, V0);
-    UpdateActualCurrent(Global::Channel1, A0);
-    UpdateActualCurrent(Global::Channel2, A0);
+    // zeroed readings, shown the way the device reports them with the output on.
+    Global::TelemetryFrame zeroed;
+    zeroed.Status.OutputSwitch = true;
+    for (auto channel : {Global::Channel1, Global::Channel2}) {
+        zeroed.channel(channel).ActualVoltage = V0;
+        zeroed.channel(channel).ActualCurrent = A0;
+        zeroed.setUpdated(Global::TelemetryFrame::ActualVoltage, channel);
+        zeroed.setUpdated(Global::TelemetryFrame::ActualCurrent, channel);
+    }
+    UpdateTelemetry(zeroed);
 
     UpdateOverVoltageProtectionSet(Global::Channel1, V0);
     UpdateOverVoltageProtectionSet(Global::Channel2, V0);
     UpdateOverCurrentProtectionSet(Global::Channel1, A0);
     UpdateOverCurrentProtectionSet(Global::Channel2, A0);
+
+    // the next session starts its own time axis, after the zeroed readings above.
+    mChartWindow->clear();
 }
 
 void MainWindow::enableControls(bool enable) {
@@ -207,6 +407,7 @@ void MainWindow::enableControls(bool enable) {
     ui->groupBoxOperation->setEnabled(enable);
     ui->actionLockDevice->setEnabled(enable);
     ui->actionBuzzer->setEnabled(enable);
+    ui->actionRunSequence->setEnabled(enable);
 }
 
 void MainWindow::setControlLimits(const Global::DeviceInfo &info) {
@@ -226,6 +427,33 @@ void MainWindow::SetEnableReadonlyMode(bool enable) {
     enableControls(!enable);
 }
 
+void MainWindow::SetEnableTelemetryLog(bool enable) {
+    mSettings.setTelemetryLogEnabled(enable);
+    emit onSetEnableTelemetryLog(enable);
+}
+
+void MainWindow::RunSequence() {
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Run Sequence"), QString(),
+                                                    tr("Sequences (*.seq *.txt);;Setpoint lists (*.csv);;I-V sweeps (*.sweep);;"
+                                                       "CP/CR loops (*.loop);;Charge profiles (*.charge);;All files (*)"));
+    if (!fileName.isEmpty()) {
+        emit onRunSequence(fileName);
+    }
+}
+
+void MainWindow::ShowCharts(bool show) {
+    if (show == mChartWindow->isVisible()) {
+        return;
+    }
+
+    if (show) {
+        mChartWindow->move(frameGeometry().topRight() + QPoint(4, 0));
+        mChartWindow->show();
+    } else {
+        mChartWindow->hide();
+    }
+}
+
 void MainWindow::SetEnableBeep(bool enable) {
     ui->actionBuzzer->setChecked(enable);
 }
@@ -287,12 +515,45 @@ void MainWindow::UpdateActivePreset(Global::MemoryKey key) {
     mPreset->SetActivePreset(key);
 }
 
-void MainWindow::UpdateActualVoltage(Global::Channel channel, double voltage) {
-    mDisplay[channel]->displayVoltage(voltage);
-}
+void MainWindow::UpdateTelemetry(const Global::TelemetryFrame &frame) {
+    using Frame = Global::TelemetryFrame;
+
+    for (auto channel : {Global::Channel1, Global::Channel2}) {
+        const auto &values = frame.channel(channel);
+        if (frame.isUpdated(Frame::VoltageSet, channel)) {
+            UpdateVoltageSet(channel, values.VoltageSet);
+        }
+        if (frame.isUpdated(Frame::CurrentSet, channel)) {
+            UpdateCurrentSet(channel, values.CurrentSet);
+        }
 
-void MainWindow::UpdateActualCurrent(Global::Channel channel, double current) {
-    mDisplay[channel]->displayCurrent(current);
+        if (!frame.Status.OutputSwitch) {
+            // the output is off, show the set values instead of the actual ones
+            if (frame.IsStatusUpdated || frame.isUpdated(Frame::VoltageSet, channel) ||
+                frame.isUpdated(Frame::CurrentSet, channel)) {
+                mDisplay[channel]->displayVoltage(values.VoltageSet);
+                mDisplay[channel]->displayCurrent(values.CurrentSet);
+            }
+            continue;
+        }
+
+        if (frame.isUpdated(Frame::ActualVoltage, channel)) {
+            mDisplay[channel]->displayVoltage(values.ActualVoltage);
+            mChartWindow->appendVoltage(channel, frame.WallTime, values.ActualVoltage);
+        }
+        if (frame.isUpdated(Frame::ActualCurrent, channel)) {
+            mDisplay[channel]->displayCurrent(values.ActualCurrent);
+            mChartWindow->appendCurrent(channel, frame.WallTime, values.ActualCurrent);
+        }
+    }
+
+    if (frame.IsStatusUpdated) {
+        UpdateChannelMode(Global::Channel1, frame.Status.ModeCh1);
+        UpdateChannelMode(Global::Channel2, frame.Status.ModeCh2);
+        SetEnableOutputSwitch(frame.Status.OutputSwitch);
+        UpdateOutputProtectionMode(frame.Status.Protection);
+        UpdateChannelTrackingMode(frame.Status.Tracking);
+    }
 }
 
 void MainWindow::UpdateVoltageSet(Global::Channel channel, double voltage) {
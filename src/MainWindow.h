@@ -19,6 +19,12 @@
 #include "Global.h"
 #include "Settings.h"
 #include "CommunicationMetrics.h"
+#include "EventLoopMetrics.h"
+#include "automation/Sequencer.h"
+#include "automation/ListPlayer.h"
+#include "automation/SweepEngine.h"
+#include "automation/SoftwareRegulator.h"
+#include "automation/ChargeEngine.h"
 #include "widgets/ClickableLabel.h"
 #include "widgets/DialWidget.h"
 #include "widgets/ProtectionWidget.h"
@@ -28,6 +34,7 @@
 #include "widgets/ChannelsTrackingWidget.h"
 #include "widgets/OutputSwitch.h"
 #include "widgets/StatusBar.h"
+#include "widgets/ChartWindow.h"
 
 namespace Ui {
     class MainWindow;
@@ -52,22 +59,38 @@ signals:
     void onSetVoltage(Global::Channel channel, double value);
     void onSetCurrent(Global::Channel channel, double value);
     void onSetEnableOutputSwitch(bool state);
+    void onEmergencyOutputOff(qint64 requestTime);
     void onSetLocked(bool enable);
     void onSetEnabledBeep(bool enable);
+    void onSetEnableTelemetryLog(bool enable);
+    void onRunSequence(const QString &fileName);
+    void onStopSequence();
+    void onVisibilityChanged(bool visible);
 
 public slots:
     void SerialPortOpened(const QString &serialPortName, int baudRate);
     void SerialPortClosed();
     void SerialPortErrorOccurred(const QString &error);
+    void TelemetryLogErrorOccurred(const QString &error);
+    void ProtectionTripped(const QString &description, double latency);
+    void SequenceStarted(const QString &fileName);
+    void SequenceFinished(const Sequencer::Report &report);
+    void ListFinished(const ListPlayer::Report &report);
+    void SweepFinished(const SweepEngine::Result &result);
+    void UpdateRegulatorStatus(const SoftwareRegulator::Status &status);
+    void UpdateChargeStatus(const ChargeEngine::Status &status);
+    void SequenceErrorOccurred(const QString &error);
     void ConnectionDeviceReady(const Global::DeviceInfo &info);
     void ConnectionUnknownDevice(const QString &deviceID);
     void UpdateCommunicationMetrics(const CommunicationMetrics &info);
+    void UpdatePollRate(double rate, const QString &state);
+    void UpdateWakeupRate(double wakeupsPerSecond);
+    void UpdateEventLoopMetrics(const EventLoopMetrics &metrics);
     void UpdateChannelTrackingMode(Global::ChannelsTracking tracking);
     void UpdateOutputProtectionMode(Global::OutputProtection protection);
     void UpdateChannelMode(Global::Channel channel, Global::OutputMode mode);
     void UpdateActivePreset(Global::MemoryKey key);
-    void UpdateActualVoltage(Global::Channel channel, double voltage);
-    void UpdateActualCurrent(Global::Channel channel, double current);
+    void UpdateTelemetry(const Global::TelemetryFrame &frame);
     void UpdateVoltageSet(Global::Channel channel, double voltage);
     void UpdateCurrentSet(Global::Channel channel, double current);
     void UpdateOverVoltageProtectionSet(Global::Channel channel, double voltage);
@@ -76,9 +99,17 @@ public slots:
     void SetEnableLock(bool enable);
     void SetEnableBeep(bool enable);
 
+protected:
+    void changeEvent(QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
 private slots:
     void SerialPortChanged(bool toggled);
     void SetEnableReadonlyMode(bool enable);
+    void SetEnableTelemetryLog(bool enable);
+    void RunSequence();
+    void ShowCharts(bool show);
     void CreateSerialPortMenuItems();
     static void ShowAboutBox();
     void ShowDeviceNameOrID();
@@ -92,6 +123,8 @@ private:
     void setControlLimits(const Global::DeviceInfo &info);
     void enableChannel(Global::Channel ch, bool enable);
     void createBaudRatesMenu();
+    void updateVisibility();
+    void updateDebugInfo();
     QString chosenSerialPort() const;
     int chosenBaudRates(int defaultValue = 9600) const;
 
@@ -108,8 +141,14 @@ private:
     OutputSwitch                                *mOutputSwitch = nullptr;
     ChannelsTrackingWidget                      *mChannelsTracking = nullptr;
     StatusBar                                   *mStatusBar = nullptr;
+    ChartWindow                                 *mChartWindow = nullptr;
 
     bool mIsSerialConnected = false;
+    bool mIsVisible = false;
+    QString mMetricsInfo;
+    QString mPollRateInfo;
+    QString mWakeupInfo;
+    QString mEventLoopInfo;
     Global::DeviceInfo mDeviceInfo;
 };
 
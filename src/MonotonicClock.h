@@ -0,0 +1,37 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_MONOTONICCLOCK_H
+#define PS_MANAGEMENT_MONOTONICCLOCK_H
+
+#include <QElapsedTimer>
+
+/**
+ * Process wide monotonic time, comparable between objects and threads. Not affected by the wall clock changes.
+ */
+namespace MonotonicClock {
+    inline qint64 nsecs() {
+        static const QElapsedTimer clock = [] () {
+            QElapsedTimer timer;
+            timer.start();
+            return timer;
+        }();
+        return clock.nsecsElapsed();
+    }
+
+    inline double msecsSince(qint64 nsecsTimestamp) {
+        return (nsecs() - nsecsTimestamp) / 1e6;
+    }
+}
+
+#endif //PS_MANAGEMENT_MONOTONICCLOCK_H
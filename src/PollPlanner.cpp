@@ -0,0 +1,153 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PollPlanner.h"
+#include <QtGlobal>
+#include <climits>
+
+#define MAX_PERIOD_TICKS 1024
+#define MAX_SLOWDOWN 8
+
+PollPlanner::PollPlanner() = default;
+
+void PollPlanner::setRate(Field field, double rate, Priority priority) {
+    mFields[field].rate = qMax(0.0, rate);
+    mFields[field].priority = priority;
+}
+
+double PollPlanner::scheduledRate(Field field) const {
+    int period = mFields[field].period;
+    return period > 0 ? 1000.0 / (period * mTickInterval) : 0;
+}
+
+bool PollPlanner::isChannelField(Field field) {
+    switch (field) {
+        case ActualVoltage:
+        case ActualCurrent:
+        case VoltageSet:
+        case CurrentSet:
+        case OverVoltageProtectionValue:
+        case OverCurrentProtectionValue:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void PollPlanner::setTickInterval(int ms) {
+    mTickInterval = qMax(1, ms);
+}
+
+void PollPlanner::setLinkCapacity(double capacity) {
+    mLinkCapacity = qMax(0.0, capacity);
+}
+
+double PollPlanner::scheduledLoad() const {
+    return loadPerTick() * 1000.0 / mTickInterval;
+}
+
+int PollPlanner::queriesPerPoll(Field field) const {
+    return isChannelField(field) ? 2 : 1;
+}
+
+double PollPlanner::loadPerTick() const {
+    double load = 0;
+    for (int field = 0; field < FieldsCount; ++field) {
+        if (mFields[field].period > 0) {
+            load += double(queriesPerPoll(Field(field))) / mFields[field].period;
+        }
+    }
+    return load;
+}
+
+void PollPlanner::compile() {
+    // nearest power of two period for the declared rate.
+    for (auto &plan : mFields) {
+        plan.period = 0;
+        if (plan.rate > 0) {
+            double desired = 1000.0 / (plan.rate * mTickInterval);
+            int period = 1;
+            while (period * 1.5 <= desired && period < MAX_PERIOD_TICKS) {
+                period *= 2;
+            }
+            plan.period = period;
+        }
+        plan.declaredPeriod = plan.period;
+    }
+
+    // slow down the least important fields until the schedule fits into the link. The first pass keeps every
+    // field within MAX_SLOWDOWN of its declared rate, only if that is not enough the fields may starve.
+    double capacityPerTick = mLinkCapacity * mTickInterval / 1000.0;
+    if (capacityPerTick > 0) {
+        for (int slowdown : {MAX_SLOWDOWN, MAX_PERIOD_TICKS}) {
+            for (int priority = PriorityLow; priority <= PriorityHigh; ++priority) {
+                while (loadPerTick() > capacityPerTick) {
+                    int fastest = -1;
+                    for (int field = 0; field < FieldsCount; ++field) {
+                        const auto &plan = mFields[field];
+                        int limit = qMin(plan.declaredPeriod * slowdown, MAX_PERIOD_TICKS);
+                        if (plan.priority == priority && plan.period > 0 && plan.period < limit &&
+                            (fastest < 0 || plan.period < mFields[fastest].period)) {
+                            fastest = field;
+                        }
+                    }
+                    if (fastest < 0) {
+                        break;
+                    }
+                    mFields[fastest].period *= 2;
+                }
+            }
+        }
+    }
+
+    int length = 1;
+    for (const auto &plan : mFields) {
+        length = qMax(length, plan.period);
+    }
+
+    mSchedule = QVector<QVector<Query>>(length);
+    QVector<int> slotLoad(length, 0);
+
+    // place the fast fields first, each query goes to the least loaded phase.
+    for (int period = 1; period <= length; period *= 2) {
+        for (int field = 0; field < FieldsCount; ++field) {
+            if (mFields[field].period != period) {
+                continue;
+            }
+
+            QVector<Global::Channel> channels;
+            if (isChannelField(Field(field))) {
+                channels << Global::Channel1 << Global::Channel2;
+            } else {
+                channels << Global::Channel1;
+            }
+
+            for (auto channel : channels) {
+                int bestPhase = 0, bestLoad = INT_MAX;
+                for (int phase = 0; phase < period; ++phase) {
+                    int load = 0;
+                    for (int slot = phase; slot < length; slot += period) {
+                        load += slotLoad[slot];
+                    }
+                    if (load < bestLoad) {
+                        bestLoad = load, bestPhase = phase;
+                    }
+                }
+                for (int slot = bestPhase; slot < length; slot += period) {
+                    mSchedule[slot].append({Field(field), channel});
+                    slotLoad[slot]++;
+                }
+            }
+        }
+    }
+}
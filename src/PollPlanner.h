@@ -0,0 +1,91 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_POLLPLANNER_H
+#define PS_MANAGEMENT_POLLPLANNER_H
+
+#include <QVector>
+#include "Global.h"
+
+/**
+ * Compiles the per field refresh rates into a repeating schedule of device queries.
+ *
+ * The schedule is a list of slots, one per tick. A field polled at 1/k of the tick rate (k is a power of two)
+ * appears in every k-th slot, the phase is picked to balance the slots. When the declared rates exceed the
+ * link capacity, the periods of the lowest priority fields are doubled first, until the load fits.
+ */
+class PollPlanner {
+public:
+    enum Field {
+        DeviceStatus,
+        ActualVoltage,
+        ActualCurrent,
+        VoltageSet,
+        CurrentSet,
+        OverVoltageProtectionValue,
+        OverCurrentProtectionValue,
+        Preset,
+        Locked,
+        BeepEnabled,
+        FieldsCount
+    };
+
+    enum Priority {
+        PriorityLow,
+        PriorityNormal,
+        PriorityHigh,
+    };
+
+    struct Query {
+        Field           field;
+        Global::Channel channel;
+    };
+
+    PollPlanner();
+
+    void setRate(Field field, double rate, Priority priority);
+    double rate(Field field) const { return mFields[field].rate; }
+    double scheduledRate(Field field) const;
+
+    static bool isChannelField(Field field);
+
+    void setTickInterval(int ms);
+    int tickInterval() const { return mTickInterval; }
+
+    // queries per second, which the link is able to carry.
+    void setLinkCapacity(double capacity);
+    double linkCapacity() const { return mLinkCapacity; }
+    double scheduledLoad() const;
+
+    void compile();
+    const QVector<QVector<Query>> &schedule() const { return mSchedule; }
+
+private:
+    struct FieldPlan {
+        double   rate = 0;   // Hz, 0 - disabled
+        Priority priority = PriorityNormal;
+        int      declaredPeriod = 0; // ticks, nearest to the declared rate
+        int      period = 0;         // ticks, fitted into the link capacity
+    };
+
+    int queriesPerPoll(Field field) const;
+    double loadPerTick() const;
+
+private:
+    FieldPlan               mFields[FieldsCount];
+    int                     mTickInterval = 100;
+    double                  mLinkCapacity = 0;
+    QVector<QVector<Query>> mSchedule;
+};
+
+#endif //PS_MANAGEMENT_POLLPLANNER_H
@@ -0,0 +1,76 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PollRateController.h"
+#include <QtGlobal>
+
+PollRateController::PollRateController() {
+    setOptions(Options());
+}
+
+PollRateController::PollRateController(const Options &options) {
+    setOptions(options);
+}
+
+void PollRateController::setOptions(const Options &options) {
+    mOptions = options;
+    mOptions.minRate = qMax(0.1, mOptions.minRate);
+    mOptions.maxRate = qMax(mOptions.minRate, mOptions.maxRate);
+    reset();
+}
+
+void PollRateController::reset() {
+    mRate = qBound(mOptions.minRate, mOptions.initialRate, mOptions.maxRate);
+    mState = Holding;
+    mHoldCounter = 0;
+    mLastTimeoutCount = 0;
+    mLastDroppedCount = 0;
+}
+
+double PollRateController::update(const CommunicationMetrics &metrics) {
+    // the counters are cumulative and restart from zero with the new connection.
+    int timeouts = qMax(0, metrics.responseTimeoutCount - mLastTimeoutCount);
+    int dropped = qMax(0, metrics.droppedCount - mLastDroppedCount);
+    mLastTimeoutCount = metrics.responseTimeoutCount;
+    mLastDroppedCount = metrics.droppedCount;
+
+    bool isCongested = timeouts > 0 || dropped > 0 || metrics.queueWait > 2 * mOptions.targetQueueWait;
+    bool hasHeadroom = metrics.utilization < mOptions.targetUtilization && metrics.queueWait < mOptions.targetQueueWait;
+
+    if (isCongested) {
+        mRate = qMax(mOptions.minRate, mRate * mOptions.decreaseFactor);
+        mState = Decreasing;
+        mHoldCounter = mOptions.holdUpdates;
+    } else if (mHoldCounter > 0) {
+        mHoldCounter--;
+        mState = Holding;
+    } else if (hasHeadroom) {
+        mRate = qMin(mOptions.maxRate, mRate + mOptions.increaseStep);
+        mState = Increasing;
+    } else {
+        mState = Holding;
+    }
+
+    return mRate;
+}
+
+QString PollRateController::stateName() const {
+    switch (mState) {
+        case Increasing:
+            return "+";
+        case Decreasing:
+            return "-";
+        default:
+            return "=";
+    }
+}
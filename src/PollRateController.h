@@ -0,0 +1,68 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_POLLRATECONTROLLER_H
+#define PS_MANAGEMENT_POLLRATECONTROLLER_H
+
+#include <QString>
+#include "CommunicationMetrics.h"
+
+/**
+ * Additive-increase/multiplicative-decrease controller of the poll rate (queries per second).
+ *
+ * While the link utilization and the queue wait are below the targets, the rate grows by a fixed step on each
+ * update. A timeout, a dropped message or a queue wait above the limit cut the rate by a factor, and the growth
+ * is held for a few updates, so the rate settles just below what the line and the device can sustain.
+ */
+class PollRateController {
+public:
+    struct Options {
+        double minRate = 4;              // queries per second
+        double maxRate = 60;
+        double initialRate = 20;
+        double increaseStep = 1;         // queries per second, per update
+        double decreaseFactor = 0.7;
+        double targetUtilization = 0.8;  // 0..1
+        double targetQueueWait = 40;     // ms
+        int    holdUpdates = 4;          // updates without increase, after a decrease
+    };
+
+    enum State {
+        Increasing,
+        Holding,
+        Decreasing,
+    };
+
+    PollRateController();
+    explicit PollRateController(const Options &options);
+
+    void setOptions(const Options &options);
+    const Options &options() const { return mOptions; }
+
+    void reset();
+    double update(const CommunicationMetrics &metrics);
+
+    double rate() const { return mRate; }
+    State state() const { return mState; }
+    QString stateName() const;
+
+private:
+    Options mOptions;
+    double  mRate = 0;
+    State   mState = Holding;
+    int     mHoldCounter = 0;
+    int     mLastTimeoutCount = 0;
+    int     mLastDroppedCount = 0;
+};
+
+#endif //PS_MANAGEMENT_POLLRATECONTROLLER_H
@@ -0,0 +1,265 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Poller.h"
+#include <QtGlobal>
+
+#define POLL_TICK_INTERVAL_MS 100
+#define HEARTBEAT_INTERVAL_MS 2000
+#define CAPACITY_CHANGE_THRESHOLD 0.05 // recompile the schedule, when the rate budget changes more than that.
+
+Poller::Poller(Communication *communication, QObject *parent)
+        : QObject(parent), mCommunication(communication), mTimer(this) {
+    mPlanner.setTickInterval(POLL_TICK_INTERVAL_MS);
+    mPlanner.setRate(PollPlanner::DeviceStatus, 4, PollPlanner::PriorityHigh);
+    mPlanner.setRate(PollPlanner::ActualVoltage, 10, PollPlanner::PriorityHigh);
+    mPlanner.setRate(PollPlanner::ActualCurrent, 10, PollPlanner::PriorityHigh);
+    mPlanner.setRate(PollPlanner::VoltageSet, 2, PollPlanner::PriorityNormal);
+    mPlanner.setRate(PollPlanner::CurrentSet, 2, PollPlanner::PriorityNormal);
+    mPlanner.setRate(PollPlanner::Preset, 1, PollPlanner::PriorityNormal);
+    mPlanner.setRate(PollPlanner::OverVoltageProtectionValue, 0.5, PollPlanner::PriorityLow);
+    mPlanner.setRate(PollPlanner::OverCurrentProtectionValue, 0.5, PollPlanner::PriorityLow);
+    mPlanner.setRate(PollPlanner::Locked, 0.2, PollPlanner::PriorityLow);
+    mPlanner.setRate(PollPlanner::BeepEnabled, 0.2, PollPlanner::PriorityLow);
+    mPlanner.setLinkCapacity(mRateController.rate());
+    mPlanner.compile();
+
+    AdaptiveSampler::Options samplerOptions;
+    samplerOptions.activeRate = mPlanner.rate(PollPlanner::ActualVoltage);
+    for (auto &sampler : mSamplers) {
+        sampler.setOptions(samplerOptions);
+    }
+    mClock.start();
+
+    mTimer.setTimerType(Qt::PreciseTimer);
+    mTimer.setInterval(POLL_TICK_INTERVAL_MS);
+    connect(&mTimer, &QTimer::timeout, this, &Poller::Tick);
+}
+
+void Poller::setRateControllerOptions(const PollRateController::Options &options) {
+    mRateController.setOptions(options);
+    setLinkCapacity(mRateController.rate());
+}
+
+void Poller::setProtectionRules(const QVector<ProtectionEngine::Rule> &rules) {
+    mIsProtected[0] = mIsProtected[1] = false;
+    for (const auto &rule : rules) {
+        mIsProtected[rule.channel == Global::Channel1 ? 0 : 1] = true;
+    }
+    updateTimer();
+}
+
+void Poller::Start() {
+    mRateController.reset();
+    setLinkCapacity(mRateController.rate());
+    mSlot = 0;
+    mIsStatusValid = false;
+    updateTimer();
+    mTimer.start();
+}
+
+void Poller::Stop() {
+    mTimer.stop();
+}
+
+void Poller::UpdateTelemetry(const Global::TelemetryFrame &frame) {
+    if (frame.IsStatusUpdated) {
+        updateDeviceStatus(frame.Status);
+    }
+
+    qint64 now = mClock.elapsed();
+    for (auto channel : {Global::Channel1, Global::Channel2}) {
+        const auto &values = frame.channel(channel);
+        if (frame.isUpdated(Global::TelemetryFrame::ActualVoltage, channel)) {
+            sampler(channel).update(AdaptiveSampler::Voltage, values.ActualVoltage, now);
+        }
+        if (frame.isUpdated(Global::TelemetryFrame::ActualCurrent, channel)) {
+            sampler(channel).update(AdaptiveSampler::Current, values.ActualCurrent, now);
+        }
+    }
+}
+
+void Poller::updateDeviceStatus(const Global::DeviceStatus &status) {
+    if (status.OutputSwitch && !(mIsStatusValid && mStatus.OutputSwitch)) {
+        for (auto &sampler : mSamplers) {
+            sampler.reset(mClock.elapsed());
+        }
+    }
+    mStatus = status;
+    mIsStatusValid = true;
+}
+
+void Poller::UpdateMetrics(const CommunicationMetrics &metrics) {
+    if (!isActive()) {
+        return;
+    }
+
+    setLinkCapacity(mRateController.update(metrics));
+    emit onPollRateChanged(mRateController.rate(), mRateController.stateName());
+}
+
+void Poller::setLinkCapacity(double capacity) {
+    double current = mPlanner.linkCapacity();
+    if (current > 0 && qAbs(capacity - current) / current < CAPACITY_CHANGE_THRESHOLD) {
+        return;
+    }
+
+    mPlanner.setLinkCapacity(capacity);
+    mPlanner.compile();
+    mSlot %= mPlanner.schedule().size();
+}
+
+void Poller::SetVisible(bool visible) {
+    mIsVisible = visible;
+    updateTimer();
+}
+
+void Poller::SetRecording(bool recording) {
+    mIsRecording = recording;
+    updateTimer();
+}
+
+void Poller::SetExternallySampled(Global::Channel channel, bool sampled) {
+    mIsExternallySampled[channel == Global::Channel1 ? 0 : 1] = sampled;
+}
+
+void Poller::updateTimer() {
+    bool heartbeat = !mIsVisible && !mIsRecording && !isProtecting();
+    if (heartbeat == mIsHeartbeat) {
+        return;
+    }
+
+    mIsHeartbeat = heartbeat;
+    mTimer.setTimerType(heartbeat ? Qt::CoarseTimer : Qt::PreciseTimer);
+    mTimer.setInterval(heartbeat ? HEARTBEAT_INTERVAL_MS : POLL_TICK_INTERVAL_MS);
+    if (mTimer.isActive()) {
+        mTimer.start(); // apply the timer type
+        if (!heartbeat) {
+            Tick(); // the window is back, don't wait for the next tick.
+        }
+    }
+}
+
+void Poller::Tick() {
+    if (mIsHeartbeat) {
+        mCommunication->GetDeviceStatus();
+        return;
+    }
+
+    const auto &schedule = mPlanner.schedule();
+    for (const auto &query : schedule.at(mSlot)) {
+        if (isRequired(query)) {
+            poll(query);
+        }
+    }
+    mSlot = (mSlot + 1) % schedule.size();
+}
+
+bool Poller::isRequired(const PollPlanner::Query &query) const {
+    if (query.field == PollPlanner::DeviceStatus) {
+        return true;
+    }
+    if (!mIsStatusValid) {
+        return false;
+    }
+
+    bool isMeasurement = query.field == PollPlanner::ActualVoltage || query.field == PollPlanner::ActualCurrent;
+    bool isProtectedMeasurement = isMeasurement && isProtected(query.channel);
+    // the automation's own readings reach the frames, the chart and the log as well.
+    if (isMeasurement && isExternallySampled(query.channel) && !isProtectedMeasurement) {
+        return false;
+    }
+    if (!mIsVisible && !(isMeasurement && mIsRecording) && !isProtectedMeasurement) {
+        return false;
+    }
+
+    // in Serial or Parallel tracking the channel 1 follows the channel 2 and is not shown, but its measurements are
+    // still recorded.
+    if (PollPlanner::isChannelField(query.field) && query.channel == Global::Channel1 &&
+        mStatus.Tracking != Global::Independent && !(isMeasurement && mIsRecording) && !isProtectedMeasurement) {
+        return false;
+    }
+
+    // protection values change only by the user, a set command or a preset recall invalidates them in the shadow.
+    const auto &shadow = mCommunication->shadow();
+    if (query.field == PollPlanner::OverVoltageProtectionValue) {
+        return (mStatus.Protection == Global::OverVoltageProtectionOnly ||
+                mStatus.Protection == Global::OutputProtectionAllEnabled) &&
+               !shadow.isValid(DeviceShadow::OverVoltageProtectionValue, query.channel);
+    }
+    if (query.field == PollPlanner::OverCurrentProtectionValue) {
+        return (mStatus.Protection == Global::OverCurrentProtectionOnly ||
+                mStatus.Protection == Global::OutputProtectionAllEnabled) &&
+               !shadow.isValid(DeviceShadow::OverCurrentProtectionValue, query.channel);
+    }
+
+    return true;
+}
+
+void Poller::poll(const PollPlanner::Query &query) {
+    switch (query.field) {
+        case PollPlanner::DeviceStatus:
+            mCommunication->GetDeviceStatus();
+            break;
+        case PollPlanner::ActualVoltage:
+            pollMeasurement(query.channel, AdaptiveSampler::Voltage);
+            break;
+        case PollPlanner::ActualCurrent:
+            pollMeasurement(query.channel, AdaptiveSampler::Current);
+            break;
+        case PollPlanner::VoltageSet:
+            mCommunication->GetVoltageSet(query.channel);
+            break;
+        case PollPlanner::CurrentSet:
+            mCommunication->GetCurrentSet(query.channel);
+            break;
+        case PollPlanner::OverVoltageProtectionValue:
+            mCommunication->GetOverVoltageProtectionValue(query.channel);
+            break;
+        case PollPlanner::OverCurrentProtectionValue:
+            mCommunication->GetOverCurrentProtectionValue(query.channel);
+            break;
+        case PollPlanner::Preset:
+            mCommunication->GetPreset();
+            break;
+        case PollPlanner::Locked:
+            mCommunication->GetIsLocked();
+            break;
+        case PollPlanner::BeepEnabled:
+            mCommunication->GetIsBuzzerEnabled();
+            break;
+        default:
+            break;
+    }
+}
+
+void Poller::pollMeasurement(Global::Channel channel, AdaptiveSampler::Quantity quantity) {
+    // while the output is off, the set values are shown instead.
+    if (!mStatus.OutputSwitch) {
+        return;
+    }
+
+    // half a tick of slack, so the slot closest to the sampler period is taken. A protection rule needs every
+    // scheduled reading, flat or not.
+    qint64 now = mClock.elapsed();
+    if (!isProtected(channel) && !sampler(channel).isDue(quantity, now + POLL_TICK_INTERVAL_MS / 2)) {
+        return;
+    }
+
+    sampler(channel).sampled(quantity, now);
+    if (quantity == AdaptiveSampler::Voltage) {
+        mCommunication->GetActualVoltage(channel);
+    } else {
+        mCommunication->GetActualCurrent(channel);
+    }
+}
@@ -0,0 +1,99 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_POLLER_H
+#define PS_MANAGEMENT_POLLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "Global.h"
+#include "Communication.h"
+#include "CommunicationMetrics.h"
+#include "PollPlanner.h"
+#include "PollRateController.h"
+#include "AdaptiveSampler.h"
+#include "ProtectionEngine.h"
+
+/**
+ * Periodically queries the device according to the schedule compiled by PollPlanner.
+ * The schedule is rebuilt when PollRateController moves the rate budget noticeably. The scheduled measurement
+ * queries of a channel are skipped while its AdaptiveSampler reports the readings are flat. Queries of values, which
+ * can't change or aren't visible (the slave channel in tracking mode, known protection values, everything but the
+ * status and recorded measurements while the window is hidden), are skipped as well. While the window is hidden
+ * and nothing is recorded, only the status is polled with a slow heartbeat.
+ *
+ * The measurements of a channel watched by a host side protection rule are polled at the full planner rate whatever
+ * the visibility, the tracking mode or the sampler says: ProtectionEngine only sees what is polled. The measurements
+ * of a channel sampled by an automation, e.g. ChargeEngine, aren't polled while it runs, unless a rule watches them.
+ */
+class Poller : public QObject {
+    Q_OBJECT
+public:
+    explicit Poller(Communication *communication, QObject *parent = nullptr);
+
+    bool isActive() const { return mTimer.isActive(); }
+    const PollPlanner &planner() const { return mPlanner; }
+    const PollRateController &rateController() const { return mRateController; }
+    void setRateControllerOptions(const PollRateController::Options &options);
+    void setProtectionRules(const QVector<ProtectionEngine::Rule> &rules);
+
+signals:
+    void onPollRateChanged(double rate, const QString &state);
+
+public slots:
+    void Start();
+    void Stop();
+
+    void UpdateTelemetry(const Global::TelemetryFrame &frame);
+    void SetVisible(bool visible);
+    void SetRecording(bool recording);
+    void SetExternallySampled(Global::Channel channel, bool sampled);
+    void UpdateMetrics(const CommunicationMetrics &metrics);
+
+private slots:
+    void Tick();
+
+private:
+    void updateDeviceStatus(const Global::DeviceStatus &status);
+    void setLinkCapacity(double capacity);
+    bool isRequired(const PollPlanner::Query &query) const;
+    void poll(const PollPlanner::Query &query);
+    void pollMeasurement(Global::Channel channel, AdaptiveSampler::Quantity quantity);
+    void updateTimer();
+    AdaptiveSampler &sampler(Global::Channel channel) { return mSamplers[channel == Global::Channel1 ? 0 : 1]; }
+    bool isProtected(Global::Channel channel) const { return mIsProtected[channel == Global::Channel1 ? 0 : 1]; }
+    bool isProtecting() const { return mIsProtected[0] || mIsProtected[1]; }
+    bool isExternallySampled(Global::Channel channel) const {
+        return mIsExternallySampled[channel == Global::Channel1 ? 0 : 1];
+    }
+
+private:
+    Communication        *mCommunication;
+    PollPlanner          mPlanner;
+    PollRateController   mRateController;
+    QTimer               mTimer;
+    int                  mSlot = 0;
+    QElapsedTimer        mClock;
+    AdaptiveSampler      mSamplers[2];
+
+    Global::DeviceStatus mStatus = {};
+    bool                 mIsStatusValid = false;
+    bool                 mIsVisible = true;
+    bool                 mIsRecording = false;
+    bool                 mIsHeartbeat = false;
+    bool                 mIsProtected[2] = {};  // a protection rule watches the channel measurements
+    bool                 mIsExternallySampled[2] = {};
+};
+
+#endif //PS_MANAGEMENT_POLLER_H
@@ -0,0 +1,129 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ProtectionEngine.h"
+#include <QtGlobal>
+
+void ProtectionEngine::setRules(const QVector<Rule> &rules) {
+    mRules = rules;
+    arm();
+}
+
+void ProtectionEngine::arm() {
+    mTripped = QVector<bool>(mRules.size(), false);
+    for (auto &channel : mChannels) {
+        channel = ChannelState();
+    }
+}
+
+void ProtectionEngine::integrateEnergy(ChannelState &state, qint64 time) {
+    if (state.isVoltageValid && state.isCurrentValid && state.energyTime > 0) {
+        state.energy += state.voltage * state.current * (time - state.energyTime) / 3.6e12;
+    }
+    state.energyTime = time;
+}
+
+QVector<ProtectionEngine::Trip> ProtectionEngine::updateVoltage(Global::Channel channel, double voltage, qint64 time) {
+    if (mRules.isEmpty()) {
+        return {};
+    }
+
+    auto &s = state(channel);
+    integrateEnergy(s, time);
+    s.voltage = voltage;
+    s.isVoltageValid = true;
+
+    return evaluate(channel);
+}
+
+QVector<ProtectionEngine::Trip> ProtectionEngine::updateCurrent(Global::Channel channel, double current, qint64 time) {
+    if (mRules.isEmpty()) {
+        return {};
+    }
+
+    auto &s = state(channel);
+    integrateEnergy(s, time);
+    if (s.isCurrentValid && time > s.currentTime) {
+        s.currentSlewRate = qAbs(current - s.current) * 1e9 / (time - s.currentTime);
+    }
+    s.current = current;
+    s.currentTime = time;
+    s.isCurrentValid = true;
+
+    return evaluate(channel);
+}
+
+QVector<ProtectionEngine::Trip> ProtectionEngine::evaluate(Global::Channel channel) {
+    const auto &s = state(channel);
+    QVector<Trip> trips;
+    for (int i = 0; i < mRules.size(); ++i) {
+        const auto &rule = mRules.at(i);
+        if (mTripped.at(i) || rule.channel != channel) {
+            continue;
+        }
+
+        double value;
+        switch (rule.condition) {
+            case PowerAbove:
+                if (!s.isVoltageValid || !s.isCurrentValid) {
+                    continue;
+                }
+                value = s.voltage * s.current;
+                break;
+            case CurrentSlewRateAbove:
+                value = s.currentSlewRate;
+                break;
+            case EnergyAbove:
+                value = s.energy;
+                break;
+            default:
+                continue;
+        }
+
+        if (value > rule.threshold) {
+            mTripped[i] = true;
+            trips.append({i, value});
+        }
+    }
+    return trips;
+}
+
+QString ProtectionEngine::describe(const Rule &rule, double value) {
+    QString condition;
+    switch (rule.condition) {
+        case PowerAbove:
+            condition = QString("power %1 W > %2 W").arg(value, 0, 'f', 2).arg(rule.threshold);
+            break;
+        case CurrentSlewRateAbove:
+            condition = QString("dI/dt %1 A/s > %2 A/s").arg(value, 0, 'f', 3).arg(rule.threshold);
+            break;
+        case EnergyAbove:
+            condition = QString("energy %1 Wh > %2 Wh").arg(value, 0, 'f', 3).arg(rule.threshold);
+            break;
+    }
+
+    QString action;
+    switch (rule.action) {
+        case OutputOff:
+            action = "output off";
+            break;
+        case SetVoltage:
+            action = QString("VSET %1 V").arg(rule.actionValue);
+            break;
+        case SetCurrent:
+            action = QString("ISET %1 A").arg(rule.actionValue);
+            break;
+    }
+
+    return QString("CH%1 %2, %3").arg(rule.channel).arg(condition, action);
+}
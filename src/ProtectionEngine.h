@@ -0,0 +1,90 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_PROTECTIONENGINE_H
+#define PS_MANAGEMENT_PROTECTIONENGINE_H
+
+#include <QString>
+#include <QVector>
+#include "Global.h"
+
+/**
+ * Host side protection rules, evaluated on every decoded measurement (on the I/O thread, by Communication).
+ *
+ * Conditions the device can't check itself: output power, rate of change of the current and the energy delivered
+ * since the output was switched on. A tripped rule stays tripped until arm() is called, which happens when the user
+ * switches the output on again or starts an automation engine. A trip stops the running engines, and an OUT on of an
+ * engine doesn't re-arm the rules.
+ */
+class ProtectionEngine {
+public:
+    enum Condition {
+        PowerAbove,             // W
+        CurrentSlewRateAbove,   // A/s, absolute value
+        EnergyAbove,            // Wh
+    };
+
+    enum Action {
+        OutputOff,
+        SetVoltage,             // actionValue, V
+        SetCurrent,             // actionValue, A
+    };
+
+    struct Rule {
+        Condition       condition = PowerAbove;
+        Global::Channel channel = Global::Channel1;
+        double          threshold = 0;
+        Action          action = OutputOff;
+        double          actionValue = 0;
+    };
+
+    struct Trip {
+        int    rule;
+        double value;   // the value of the condition, which crossed the threshold
+    };
+
+    void setRules(const QVector<Rule> &rules);
+    const QVector<Rule> &rules() const { return mRules; }
+    bool isEmpty() const { return mRules.isEmpty(); }
+
+    void arm();
+
+    // time in ns of MonotonicClock.
+    QVector<Trip> updateVoltage(Global::Channel channel, double voltage, qint64 time);
+    QVector<Trip> updateCurrent(Global::Channel channel, double current, qint64 time);
+
+    static QString describe(const Rule &rule, double value);
+
+private:
+    struct ChannelState {
+        double voltage = 0;
+        double current = 0;
+        bool   isVoltageValid = false;
+        bool   isCurrentValid = false;
+        qint64 currentTime = 0;
+        double currentSlewRate = 0;
+        double energy = 0;      // Wh
+        qint64 energyTime = 0;
+    };
+
+    ChannelState &state(Global::Channel channel) { return mChannels[channel == Global::Channel1 ? 0 : 1]; }
+    void integrateEnergy(ChannelState &state, qint64 time);
+    QVector<Trip> evaluate(Global::Channel channel);
+
+private:
+    QVector<Rule>   mRules;
+    QVector<bool>   mTripped;
+    ChannelState    mChannels[2];
+};
+
+#endif //PS_MANAGEMENT_PROTECTIONENGINE_H
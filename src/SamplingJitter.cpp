@@ -0,0 +1,59 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SamplingJitter.h"
+#include <QtMath>
+
+SamplingJitter::SamplingJitter(int window) : mIntervals(qMax(2, window)), mLatencies(qMax(2, window)) {
+}
+
+void SamplingJitter::sampled(qint64 sendTime, qint64 arrivalTime) {
+    if (mLastArrival >= 0) {
+        mIntervals[mNext] = (arrivalTime - mLastArrival) / 1e6;
+        mLatencies[mNext] = sendTime > 0 ? (arrivalTime - sendTime) / 1e6 : 0;
+        mNext = (mNext + 1) % mIntervals.size();
+        mCount = qMin(mCount + 1, mIntervals.size());
+    }
+    mLastArrival = arrivalTime;
+}
+
+void SamplingJitter::reset() {
+    mNext = 0;
+    mCount = 0;
+    mLastArrival = -1;
+}
+
+SamplingJitter::Stats SamplingJitter::stats() const {
+    Stats stats;
+    stats.count = mCount;
+    if (mCount == 0) {
+        return stats;
+    }
+
+    double sum = 0, latency = 0;
+    for (int i = 0; i < mCount; ++i) {
+        sum += mIntervals.at(i);
+        latency += mLatencies.at(i);
+    }
+    stats.interval = sum / mCount;
+    stats.latency = latency / mCount;
+
+    double variance = 0;
+    for (int i = 0; i < mCount; ++i) {
+        double deviation = mIntervals.at(i) - stats.interval;
+        variance += deviation * deviation;
+        stats.maxDeviation = qMax(stats.maxDeviation, qAbs(deviation));
+    }
+    stats.jitter = qSqrt(variance / mCount);
+    return stats;
+}
@@ -0,0 +1,50 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_SAMPLINGJITTER_H
+#define PS_MANAGEMENT_SAMPLINGJITTER_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * Rolling statistics of the intervals between the arrivals of one sampled field and of its query latency,
+ * over the last window samples. The intervals of a field slowed down by AdaptiveSampler are counted as they are,
+ * so the jitter is meaningful for a steady rate only.
+ */
+class SamplingJitter {
+public:
+    struct Stats {
+        int    count = 0;
+        double interval = 0;     // ms, mean
+        double jitter = 0;       // ms, standard deviation of the interval
+        double maxDeviation = 0; // ms, the largest distance of an interval from the mean
+        double latency = 0;      // ms, mean time from sending the query to the reply arrival
+    };
+
+    explicit SamplingJitter(int window = 64);
+
+    // times in ns of MonotonicClock.
+    void sampled(qint64 sendTime, qint64 arrivalTime);
+    void reset();
+    Stats stats() const;
+
+private:
+    QVector<double> mIntervals;  // ms, ring buffers
+    QVector<double> mLatencies;  // ms
+    int             mNext = 0;
+    int             mCount = 0;
+    qint64          mLastArrival = -1;
+};
+
+#endif //PS_MANAGEMENT_SAMPLINGJITTER_H
@@ -16,15 +16,21 @@
 //
 
 #include "Settings.h"
-#include "Application.h"
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QDebug>
 
 Settings::Settings(QObject *parent) : QObject(parent),
 mSettings(QSettings::Scope::UserScope,
-          Application::organizationName(),
-          Application::applicationName(), parent)
+          QCoreApplication::organizationName(),
+          QCoreApplication::applicationName(), parent)
           {
 }
 
+Settings::Settings(const QString &fileName, QObject *parent) : QObject(parent),
+mSettings(fileName, QSettings::IniFormat, parent) {
+}
+
 int Settings::serialPortBaudRate() const {
     return mSettings.value("serial-port/baud-rate", 9600).toInt();
 }
@@ -49,3 +55,163 @@ bool Settings::isDebugModeEnabled() const {
 void Settings::setDebugModeEnabled(bool enabled) {
     setValue("debug-mode/enabled", enabled);
 }
+
+int Settings::displayRefreshRate() const {
+    return mSettings.value("ui/max-refresh-rate", 25).toInt();
+}
+
+double Settings::pollMinRate() const {
+    return mSettings.value("poll/min-rate", 4).toDouble();
+}
+
+double Settings::pollMaxRate() const {
+    return mSettings.value("poll/max-rate", 60).toDouble();
+}
+
+double Settings::pollTargetUtilization() const {
+    return mSettings.value("poll/target-utilization", 0.8).toDouble();
+}
+
+PollRateController::Options Settings::pollRateControllerOptions() const {
+    PollRateController::Options options;
+    options.minRate = pollMinRate();
+    options.maxRate = pollMaxRate();
+    options.targetUtilization = pollTargetUtilization();
+    return options;
+}
+
+/**
+ * [protection]
+ * rules\size=1
+ * rules\1\condition=power    ; power (W), current-slew (A/s), energy (Wh)
+ * rules\1\channel=1
+ * rules\1\threshold=30
+ * rules\1\action=off         ; off, vset, iset
+ * rules\1\value=0            ; V or A for vset/iset
+ */
+QVector<ProtectionEngine::Rule> Settings::protectionRules() {
+    QVector<ProtectionEngine::Rule> rules;
+    int size = mSettings.beginReadArray("protection/rules");
+    for (int i = 0; i < size; ++i) {
+        mSettings.setArrayIndex(i);
+
+        ProtectionEngine::Rule rule;
+        QString condition = mSettings.value("condition").toString();
+        if (condition == "power") {
+            rule.condition = ProtectionEngine::PowerAbove;
+        } else if (condition == "current-slew") {
+            rule.condition = ProtectionEngine::CurrentSlewRateAbove;
+        } else if (condition == "energy") {
+            rule.condition = ProtectionEngine::EnergyAbove;
+        } else {
+            qWarning() << "Unknown protection rule condition" << condition;
+            continue;
+        }
+
+        rule.channel = mSettings.value("channel", 1).toInt() == 2 ? Global::Channel2 : Global::Channel1;
+        rule.threshold = mSettings.value("threshold").toDouble();
+
+        QString action = mSettings.value("action", "off").toString();
+        if (action == "vset") {
+            rule.action = ProtectionEngine::SetVoltage;
+        } else if (action == "iset") {
+            rule.action = ProtectionEngine::SetCurrent;
+        } else {
+            rule.action = ProtectionEngine::OutputOff;
+        }
+        rule.actionValue = mSettings.value("value").toDouble();
+
+        rules.append(rule);
+    }
+    mSettings.endArray();
+
+    return rules;
+}
+
+bool Settings::isWatchdogEnabled() const {
+    return mSettings.value("watchdog/enabled", false).toBool();
+}
+
+int Settings::watchdogStallThreshold() const {
+    return mSettings.value("watchdog/stall-threshold", 2000).toInt();
+}
+
+QStringList Settings::watchdogSafeState() const {
+    return mSettings.value("watchdog/safe-state", QStringList{"OUT0"}).toStringList();
+}
+
+Watchdog::Options Settings::watchdogOptions() const {
+    Watchdog::Options options;
+    options.enabled = isWatchdogEnabled();
+    options.stallThreshold = watchdogStallThreshold();
+    options.safeState.clear();
+    for (const auto &command : watchdogSafeState()) {
+        options.safeState.append(command.toLatin1());
+    }
+    return options;
+}
+
+bool Settings::isTelemetryLogEnabled() const {
+    return mSettings.value("telemetry-log/enabled", false).toBool();
+}
+
+void Settings::setTelemetryLogEnabled(bool enabled) {
+    setValue("telemetry-log/enabled", enabled);
+}
+
+QString Settings::telemetryLogDirectory() const {
+    QString defaultValue = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/telemetry";
+    return mSettings.value("telemetry-log/directory", defaultValue).toString();
+}
+
+QString Settings::telemetryLogFormat() const {
+    return mSettings.value("telemetry-log/format", "csv").toString();
+}
+
+qint64 Settings::telemetryLogRotateSize() const {
+    return mSettings.value("telemetry-log/rotate-size-mb", 0).toLongLong() * 1024 * 1024;
+}
+
+int Settings::telemetryLogRotateInterval() const {
+    return mSettings.value("telemetry-log/rotate-interval-min", 0).toInt() * 60;
+}
+
+bool Settings::isTelemetryLogFsyncEnabled() const {
+    return mSettings.value("telemetry-log/fsync", false).toBool();
+}
+
+TelemetryLogger::Options Settings::telemetryLogOptions() const {
+    TelemetryLogger::Options options;
+    options.directory = telemetryLogDirectory();
+    QString format = telemetryLogFormat();
+    if (format == "ndjson") {
+        options.format = TelemetryLogger::NDJSON;
+    } else if (format == "psmt") {
+        options.format = TelemetryLogger::Compressed;
+    } else {
+        options.format = TelemetryLogger::CSV;
+    }
+    options.rotateSize = telemetryLogRotateSize();
+    options.rotateInterval = telemetryLogRotateInterval();
+    options.fsync = isTelemetryLogFsyncEnabled();
+
+    return options;
+}
+
+bool Settings::isTelemetryStreamEnabled() const {
+    return mSettings.value("telemetry-stream/enabled", false).toBool();
+}
+
+TelemetryStream::Options Settings::telemetryStreamOptions() const {
+    TelemetryStream::Options options;
+    options.path = mSettings.value("telemetry-stream/path", options.path).toString();
+    options.policy = TelemetryStream::policyFromString(mSettings.value("telemetry-stream/policy").toString());
+    options.queueSize = mSettings.value("telemetry-stream/queue-size", options.queueSize).toInt();
+    options.maxQueueSize = mSettings.value("telemetry-stream/max-queue-size", options.maxQueueSize).toInt();
+
+    return options;
+}
+
+int Settings::daemonReconnectInterval() const {
+    return mSettings.value("daemon/reconnect-interval-s", 5).toInt();
+}
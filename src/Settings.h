@@ -20,10 +20,21 @@
 
 #include <QSettings>
 #include <QString>
+#include <QStringList>
+#include "ProtectionEngine.h"
+#include "PollRateController.h"
+#include "Watchdog.h"
+#include "telemetry/TelemetryLogger.h"
+#include "telemetry/TelemetryStream.h"
 
 class Settings : public QObject {
 public:
     explicit Settings(QObject *parent = nullptr);
+    // INI file, for the headless tools.
+    explicit Settings(const QString &fileName, QObject *parent = nullptr);
+
+    QString fileName() const { return mSettings.fileName(); }
+    QSettings::Status status() const { return mSettings.status(); }
 
     int serialPortBaudRate() const;
     void setSerialPortBaudRate(int baudRate);
@@ -33,6 +44,34 @@ public:
 
     bool isDebugModeEnabled() const;
     void setDebugModeEnabled(bool enabled);
+
+    int displayRefreshRate() const;
+
+    double pollMinRate() const;
+    double pollMaxRate() const;
+    double pollTargetUtilization() const;
+    PollRateController::Options pollRateControllerOptions() const;
+
+    QVector<ProtectionEngine::Rule> protectionRules();
+
+    bool isWatchdogEnabled() const;
+    int watchdogStallThreshold() const;
+    QStringList watchdogSafeState() const;
+    Watchdog::Options watchdogOptions() const;
+
+    bool isTelemetryLogEnabled() const;
+    void setTelemetryLogEnabled(bool enabled);
+    QString telemetryLogDirectory() const;
+    QString telemetryLogFormat() const;
+    qint64 telemetryLogRotateSize() const;
+    int telemetryLogRotateInterval() const;
+    bool isTelemetryLogFsyncEnabled() const;
+    TelemetryLogger::Options telemetryLogOptions() const;
+
+    bool isTelemetryStreamEnabled() const;
+    TelemetryStream::Options telemetryStreamOptions() const;
+
+    int daemonReconnectInterval() const;
 private:
     QSettings mSettings;
 
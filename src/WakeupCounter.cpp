@@ -0,0 +1,53 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "WakeupCounter.h"
+#include <QAbstractEventDispatcher>
+
+#define REPORT_INTERVAL_MS 5000
+
+WakeupCounter::WakeupCounter(QObject *parent) : QObject(parent) {
+    auto dispatcher = QAbstractEventDispatcher::instance();
+    if (dispatcher != nullptr) {
+        connect(dispatcher, &QAbstractEventDispatcher::awake, this, [this] () {
+            mWakeupsCount++;
+        });
+    }
+
+    mReportTimer.setTimerType(Qt::VeryCoarseTimer);
+    mReportTimer.setInterval(REPORT_INTERVAL_MS);
+    connect(&mReportTimer, &QTimer::timeout, this, &WakeupCounter::Report);
+    mSinceReport.start();
+}
+
+void WakeupCounter::SetReporting(bool enable) {
+    if (enable == mReportTimer.isActive()) {
+        return;
+    }
+
+    if (enable) {
+        // covers the period without reporting, e.g. while the window was hidden.
+        Report();
+        mReportTimer.start();
+    } else {
+        mReportTimer.stop();
+    }
+}
+
+void WakeupCounter::Report() {
+    qint64 elapsed = mSinceReport.restart();
+    if (elapsed > 0) {
+        emit onRateReady((mWakeupsCount - mReportedCount) * 1000.0 / elapsed);
+    }
+    mReportedCount = mWakeupsCount;
+}
@@ -0,0 +1,48 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_WAKEUPCOUNTER_H
+#define PS_MANAGEMENT_WAKEUPCOUNTER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+/**
+ * Counts the wakeups of the main event loop and reports the average rate since the previous report.
+ * The report timer runs only while reporting is enabled, so the counter doesn't add wakeups to an idle process.
+ */
+class WakeupCounter : public QObject {
+    Q_OBJECT
+public:
+    explicit WakeupCounter(QObject *parent = nullptr);
+
+    quint64 wakeupsCount() const { return mWakeupsCount; }
+
+signals:
+    void onRateReady(double wakeupsPerSecond);
+
+public slots:
+    void SetReporting(bool enable);
+
+private slots:
+    void Report();
+
+private:
+    QTimer        mReportTimer;
+    QElapsedTimer mSinceReport;
+    quint64       mWakeupsCount = 0;
+    quint64       mReportedCount = 0;
+};
+
+#endif //PS_MANAGEMENT_WAKEUPCOUNTER_H
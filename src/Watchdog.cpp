@@ -0,0 +1,185 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Watchdog.h"
+#include "Communication.h"
+#include "MonotonicClock.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#define COMMAND_DELAY_MS 60
+
+/**
+ * How long the host has been suspended, ns since an arbitrary point: a clock which runs while the host sleeps minus
+ * one which stops. Only the changes count.
+ */
+static qint64 suspendedNsecs() {
+#if defined(Q_OS_LINUX)
+    timespec boot = {}, monotonic = {};
+    clock_gettime(CLOCK_BOOTTIME, &boot);
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    return (boot.tv_sec - monotonic.tv_sec) * 1000000000LL + (boot.tv_nsec - monotonic.tv_nsec);
+#elif defined(Q_OS_MACOS)
+    return qint64(clock_gettime_nsec_np(CLOCK_MONOTONIC_RAW) - clock_gettime_nsec_np(CLOCK_UPTIME_RAW));
+#elif defined(Q_OS_WIN)
+    ULONGLONG unbiased = 0; // 100 ns, without the sleep
+    QueryUnbiasedInterruptTime(&unbiased);
+    return qint64(GetTickCount64()) * 1000000LL - qint64(unbiased) * 100;
+#else
+    // the wall clock may also be set by hand, which looks like a suspend.
+    return QDateTime::currentMSecsSinceEpoch() * 1000000LL - MonotonicClock::nsecs();
+#endif
+}
+
+Watchdog::Watchdog(Communication *communication, const Options &options, qintptr serialPortHandle)
+        : mCommunication(communication), mOptions(options), mHandle(serialPortHandle),
+          mState(QSharedPointer<State>::create()) {
+    mOptions.stallThreshold = qMax(100, mOptions.stallThreshold);
+    setObjectName("watchdog");
+}
+
+Watchdog::~Watchdog() {
+    stop();
+}
+
+void Watchdog::stop() {
+    {
+        QMutexLocker locker(&mMutex);
+        mStopRequested = true;
+        mCondition.wakeAll();
+    }
+    wait();
+}
+
+Watchdog::Stalls Watchdog::stalls() const {
+    Stalls stalls;
+    for (int loop = 0; loop < LoopsCount; ++loop) {
+        stalls.count[loop] = mState->count[loop].loadAcquire();
+    }
+    stalls.hostSuspendCount = mState->hostSuspendCount.loadAcquire();
+    stalls.maxDuration = mState->maxDuration.loadAcquire() / 1e6;
+    return stalls;
+}
+
+void Watchdog::run() {
+    // a quarter of the threshold, so a stall is detected at most 25% late.
+    const int interval = mOptions.stallThreshold / 4;
+    const qint64 threshold = mOptions.stallThreshold * 1000000LL;
+
+    qint64 suspended = suspendedNsecs();
+
+    QMutexLocker locker(&mMutex);
+    while (!mStopRequested) {
+        mCondition.wait(&mMutex, interval);
+        if (mStopRequested) {
+            break;
+        }
+
+        qint64 now = MonotonicClock::nsecs();
+        // a wall clock change isn't a suspend, the boot time clock only runs ahead of the monotonic one in a sleep.
+        qint64 nowSuspended = suspendedNsecs();
+        bool isHostResumed = nowSuspended - suspended > threshold;
+        suspended = nowSuspended;
+
+        if (isHostResumed) {
+            mState->hostSuspendCount.fetchAndAddOrdered(1);
+            triggerSafeState(MainLoop);
+            continue;
+        }
+
+        for (int loop = 0; loop < LoopsCount; ++loop) {
+            auto &state = mState->loops[loop];
+            qint64 pingTime = state.pingTime.loadAcquire();
+            if (pingTime == 0) {
+                ping(Loop(loop), loop == MainLoop ? QCoreApplication::instance() : static_cast<QObject *>(mCommunication));
+            } else if (now - pingTime > threshold && state.stalled.testAndSetOrdered(0, 1)) {
+                mState->count[loop].fetchAndAddOrdered(1);
+                triggerSafeState(Loop(loop));
+            }
+        }
+    }
+}
+
+void Watchdog::ping(Loop loop, QObject *context) {
+    mState->loops[loop].pingTime.storeRelease(MonotonicClock::nsecs());
+    auto state = mState;
+    QMetaObject::invokeMethod(context, [state, loop] () {
+        acknowledge(state, loop);
+    }, Qt::QueuedConnection);
+}
+
+void Watchdog::acknowledge(const QSharedPointer<State> &state, Loop loop) {
+    auto &loopState = state->loops[loop];
+    qint64 duration = MonotonicClock::nsecs() - loopState.pingTime.loadAcquire();
+    if (loopState.stalled.testAndSetOrdered(1, 0)) {
+        qint64 max = state->maxDuration.loadAcquire();
+        while (duration > max && !state->maxDuration.testAndSetOrdered(max, duration)) {
+            max = state->maxDuration.loadAcquire();
+        }
+    }
+    loopState.pingTime.storeRelease(0);
+}
+
+void Watchdog::triggerSafeState(Loop loop) {
+    if (loop == IoLoop) {
+        // nothing queued before the stall is written after the safe state, when the I/O thread runs again.
+        mCommunication->requestDropQueue();
+
+        // the I/O thread holds the lock while it writes a command, the safe state goes between the whole commands.
+        // A thread stuck in the write for the whole threshold doesn't hold off the safe state.
+        auto &writeMutex = mCommunication->writeMutex();
+        bool wasWriting = !writeMutex.tryLock();
+        bool isLocked = !wasWriting || writeMutex.tryLock(mOptions.stallThreshold);
+        if (wasWriting) {
+            QThread::msleep(COMMAND_DELAY_MS);
+        }
+        for (const auto &command : mOptions.safeState) {
+            writeNative(mHandle, command);
+            QThread::msleep(COMMAND_DELAY_MS);
+        }
+        if (isLocked) {
+            writeMutex.unlock();
+        }
+    } else {
+        auto communication = mCommunication;
+        auto commands = mOptions.safeState;
+        QMetaObject::invokeMethod(communication, [communication, commands] () {
+            communication->ApplySafeState(commands);
+        }, Qt::QueuedConnection);
+    }
+}
+
+bool Watchdog::writeNative(qintptr handle, const QByteArray &data) {
+#ifdef Q_OS_WIN
+    // QSerialPort opens the port for overlapped I/O.
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    DWORD written = 0;
+    BOOL ok = WriteFile(HANDLE(handle), data.constData(), DWORD(data.size()), nullptr, &overlapped);
+    if (!ok && GetLastError() == ERROR_IO_PENDING) {
+        ok = GetOverlappedResult(HANDLE(handle), &overlapped, &written, TRUE);
+    }
+    CloseHandle(overlapped.hEvent);
+    return ok;
+#else
+    return ::write(int(handle), data.constData(), size_t(data.size())) == data.size();
+#endif
+}
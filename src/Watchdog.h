@@ -0,0 +1,95 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_WATCHDOG_H
+#define PS_MANAGEMENT_WATCHDOG_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <QSharedPointer>
+#include <QList>
+#include <QByteArray>
+
+class Communication;
+
+/**
+ * Host-loss watchdog. A monitor thread pings the GUI and the I/O event loops with a queued call and expects
+ * the answer within the stall threshold, the loops don't run any timers for it.
+ *
+ * A stalled GUI loop, or a host that has been suspended (the boot time clock ran ahead of the monotonic clock),
+ * makes the I/O thread apply the safe state. A stalled I/O loop can't do that, so the monitor thread writes
+ * the safe state commands to the native handle of the serial port itself, between the whole commands of the I/O
+ * thread, and has the queue dropped before the I/O thread writes again.
+ */
+class Watchdog : public QThread {
+public:
+    enum Loop {
+        MainLoop,
+        IoLoop,
+        LoopsCount
+    };
+
+    struct Options {
+        bool              enabled = false;
+        int               stallThreshold = 2000;  // ms
+        QList<QByteArray> safeState = {"OUT0"};   // commands, written with the command delay between them
+    };
+
+    struct Stalls {
+        int    count[LoopsCount] = {};
+        int    hostSuspendCount = 0;
+        double maxDuration = 0;  // ms
+    };
+
+    Watchdog(Communication *communication, const Options &options, qintptr serialPortHandle);
+    ~Watchdog() override;
+
+    void stop();
+    Stalls stalls() const;
+
+    static bool writeNative(qintptr handle, const QByteArray &data);
+
+protected:
+    void run() override;
+
+private:
+    struct LoopState {
+        QAtomicInteger<qint64> pingTime {0};  // ns, MonotonicClock, 0 - no ping pending
+        QAtomicInt             stalled {0};
+    };
+
+    struct State {
+        LoopState              loops[LoopsCount];
+        QAtomicInt             count[LoopsCount];
+        QAtomicInt             hostSuspendCount {0};
+        QAtomicInteger<qint64> maxDuration {0};  // ns
+    };
+
+    void ping(Loop loop, QObject *context);
+    void triggerSafeState(Loop loop);
+    static void acknowledge(const QSharedPointer<State> &state, Loop loop);
+
+private:
+    Communication           *mCommunication;
+    Options                 mOptions;
+    qintptr                 mHandle;
+    QSharedPointer<State>   mState;  // shared with the pending pings, which may outlive the watchdog
+
+    QMutex                  mMutex;
+    QWaitCondition          mCondition;
+    bool                    mStopRequested = false;
+};
+
+#endif //PS_MANAGEMENT_WATCHDOG_H
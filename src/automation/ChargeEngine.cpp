@@ -0,0 +1,354 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ChargeEngine.h"
+#include "MonotonicClock.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+
+// the readings are asked again, when they don't come, e.g. dropped by a reply timeout.
+#define REQUEST_TIMEOUT_MS 2000
+#define INTERVAL_GROWTH 1.5
+// the interval while a phase is about to end, in units of the minimum interval.
+#define APPROACH_INTERVAL_FACTOR 4
+// the current is approaching the taper below (1 + this) * taper current.
+#define TAPER_APPROACH 0.5
+// samples in a row below the taper current, which end the charge; a single noisy reading doesn't.
+#define TAPER_SAMPLES 3
+// the voltage of a cell settles after the start of CC, the drop from the peak isn't looked at before.
+#define DELTA_V_HOLDOFF_S 120
+
+static QString formatDuration(double seconds) {
+    auto total = qint64(seconds);
+    return QString("%1:%2:%3").arg(total / 3600)
+            .arg(total / 60 % 60, 2, 10, QChar('0'))
+            .arg(total % 60, 2, 10, QChar('0'));
+}
+
+ChargeEngine::ChargeEngine(Communication *communication, QObject *parent)
+        : QObject(parent), mCommunication(communication), mSampleTimer(this) {
+    mSampleTimer.setSingleShot(true);
+    connect(&mSampleTimer, &QTimer::timeout, this, &ChargeEngine::SampleDue);
+    connect(mCommunication, &Communication::onSerialPortClosed, this, &ChargeEngine::Stop);
+    connect(mCommunication, &Communication::onProtectionTripped, this, &ChargeEngine::Stop);
+    connect(mCommunication, &Communication::onTelemetryFrame, this, &ChargeEngine::UpdateTelemetry);
+}
+
+bool ChargeEngine::loadOptions(const QString &fileName, ChargeEngine::Options &options, QString &error) {
+    if (!QFileInfo::exists(fileName)) {
+        error = QString("%1 doesn't exist").arg(fileName);
+        return false;
+    }
+
+    QSettings settings(fileName, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        error = QString("%1 isn't a valid INI file").arg(fileName);
+        return false;
+    }
+
+    options = Options();
+    int channel = settings.value("charge/channel", 1).toInt();
+    if (channel != 1 && channel != 2) {
+        error = "charge/channel: expected 1 or 2";
+        return false;
+    }
+    options.channel = Global::Channel(channel);
+
+    options.current = settings.value("charge/current", options.current).toDouble();
+    options.voltage = settings.value("charge/voltage", options.voltage).toDouble();
+    options.taperCurrent = settings.value("termination/taper-current", options.taperCurrent).toDouble();
+    options.deltaVoltage = settings.value("termination/delta-v", options.deltaVoltage).toDouble();
+    options.maxTime = settings.value("termination/max-time-min", options.maxTime).toInt();
+    options.minInterval = settings.value("sampling/min-interval-ms", options.minInterval).toInt();
+    options.maxInterval = settings.value("sampling/max-interval-ms", options.maxInterval).toInt();
+    options.approachMargin = settings.value("sampling/approach-margin", options.approachMargin).toDouble();
+
+    if (options.current <= 0 || options.voltage <= 0) {
+        error = "charge: current and voltage must be positive";
+        return false;
+    }
+    if (options.taperCurrent <= 0 && options.deltaVoltage <= 0 && options.maxTime <= 0) {
+        error = "termination: expected taper-current, delta-v or max-time-min";
+        return false;
+    }
+    if (options.minInterval <= 0 || options.maxInterval < options.minInterval) {
+        error = "sampling: expected 0 < min-interval-ms <= max-interval-ms";
+        return false;
+    }
+    return true;
+}
+
+QString ChargeEngine::phaseName(ChargeEngine::Phase phase) {
+    return phase == ConstantCurrent ? "CC" : "CV";
+}
+
+QString ChargeEngine::terminationName(ChargeEngine::Termination termination) {
+    switch (termination) {
+        case TaperCurrent:
+            return "taper current";
+        case MaxTime:
+            return "maximum time";
+        case DeltaVoltage:
+            return "delta V";
+        case OutputSwitchedOff:
+            return "output switched off";
+        case Stopped:
+            return "stopped";
+        default:
+            return "not terminated";
+    }
+}
+
+QString ChargeEngine::describe(const ChargeEngine::Status &status) {
+    QString text = QString("%1 %2: %3 V, %4 A, %5 Ah, %6 Wh after %7")
+            .arg(status.fileName, phaseName(status.phase))
+            .arg(status.voltage, 0, 'f', 3).arg(status.current, 0, 'f', 3)
+            .arg(status.charge, 0, 'f', 3).arg(status.energy, 0, 'f', 2)
+            .arg(formatDuration(status.elapsed));
+    if (status.termination != NotTerminated) {
+        text += QString(", %1").arg(terminationName(status.termination));
+    }
+    return text;
+}
+
+void ChargeEngine::Start(const QString &fileName, const Global::DeviceInfo &info) {
+    Stop();
+
+    QString error;
+    if (!loadOptions(fileName, mOptions, error)) {
+        emit onErrorOccurred(QString("%1: %2").arg(fileName, error));
+        return;
+    }
+    if (mOptions.channel == Global::Channel2 && info.ActiveChannelsCount < 2) {
+        emit onErrorOccurred(QString("%1: %2 has one channel").arg(fileName, info.Name));
+        return;
+    }
+    if (mOptions.voltage > info.MaxVoltage || mOptions.current > info.MaxCurrent) {
+        emit onErrorOccurred(QString("%1: the charge is outside %2 V, %3 A")
+                                     .arg(fileName).arg(info.MaxVoltage).arg(info.MaxCurrent));
+        return;
+    }
+
+    mStatus = Status();
+    mStatus.fileName = fileName;
+    if (!openLog()) {
+        return;
+    }
+
+    mIsRunning = true;
+    mStatus.isRunning = true;
+    mLastSample = 0;
+    mPeakVoltage = 0;
+    mTaperSamples = 0;
+    mInterval = mOptions.minInterval;
+    emit onStarted(fileName);
+
+    mCommunication->SetCurrent(mOptions.channel, mOptions.current);
+    mCommunication->SetVoltage(mOptions.channel, mOptions.voltage);
+    mCommunication->armProtection();
+    mCommunication->switchOutput(true);
+
+    mStartTime = mPhaseTime = MonotonicClock::nsecs();
+    emit onSamplingChanged(mOptions.channel, true);
+    request();
+}
+
+void ChargeEngine::Stop() {
+    if (mIsRunning) {
+        finish(Stopped);
+    }
+}
+
+void ChargeEngine::SampleDue() {
+    if (mIsRunning) {
+        request();
+    }
+}
+
+void ChargeEngine::request() {
+    mHasVoltage = mHasCurrent = mHasStatus = false;
+    // the queries sent after this moment are written after the set commands, see Communication::enqueueMessage.
+    mRequestTime = MonotonicClock::nsecs();
+    mCommunication->GetDeviceStatus();
+    mCommunication->GetActualVoltage(mOptions.channel);
+    mCommunication->GetActualCurrent(mOptions.channel);
+    mSampleTimer.start(REQUEST_TIMEOUT_MS);
+}
+
+void ChargeEngine::UpdateTelemetry(const Global::TelemetryFrame &frame) {
+    if (!mIsRunning || mRequestTime == 0) {
+        return;
+    }
+
+    // the readings of the polling count as well, when they are fresh enough.
+    const auto &values = frame.channel(mOptions.channel);
+    if (frame.isUpdated(Global::TelemetryFrame::ActualVoltage, mOptions.channel) &&
+        values.Time[Global::TelemetryFrame::ActualVoltage].Sent >= mRequestTime) {
+        mVoltage = values.ActualVoltage;
+        mHasVoltage = true;
+    }
+    if (frame.isUpdated(Global::TelemetryFrame::ActualCurrent, mOptions.channel) &&
+        values.Time[Global::TelemetryFrame::ActualCurrent].Sent >= mRequestTime) {
+        mCurrent = values.ActualCurrent;
+        mHasCurrent = true;
+    }
+    if (frame.IsStatusUpdated && frame.StatusTime.Sent >= mRequestTime) {
+        auto mode = mOptions.channel == Global::Channel1 ? frame.Status.ModeCh1 : frame.Status.ModeCh2;
+        mMode = mode == Global::ConstantCurrent ? ConstantCurrent : ConstantVoltage;
+        mIsOutputOn = frame.Status.OutputSwitch;
+        mHasStatus = true;
+    }
+
+    if (mHasVoltage && mHasCurrent && mHasStatus) {
+        mRequestTime = 0;
+        sample();
+    }
+}
+
+void ChargeEngine::sample() {
+    qint64 now = MonotonicClock::nsecs();
+    // trapezoids between the samples, the intervals are long in the CV tail. Before the first sample the output
+    // is already on in CC, so the first reading counts back to the start.
+    if (mLastSample > 0) {
+        double hours = (now - mLastSample) / 3.6e12;
+        mStatus.charge += (mStatus.current + mCurrent) / 2 * hours;
+        mStatus.energy += (mStatus.voltage * mStatus.current + mVoltage * mCurrent) / 2 * hours;
+    } else {
+        double hours = (now - mStartTime) / 3.6e12;
+        mStatus.charge += mCurrent * hours;
+        mStatus.energy += mVoltage * mCurrent * hours;
+    }
+    mLastSample = now;
+
+    bool isPhaseChanged = mStatus.samples > 0 && mMode != mStatus.phase;
+    if (isPhaseChanged) {
+        mPhaseTime = now;
+        mPeakVoltage = 0;
+        mTaperSamples = 0;
+        mInterval = mOptions.minInterval;
+    }
+
+    if (mMode == ConstantCurrent) {
+        mPeakVoltage = qMax(mPeakVoltage, mVoltage);
+    } else {
+        mTaperSamples = mCurrent <= mOptions.taperCurrent ? mTaperSamples + 1 : 0;
+    }
+
+    mStatus.phase = mMode;
+    mStatus.voltage = mVoltage;
+    mStatus.current = mCurrent;
+    mStatus.elapsed = (now - mStartTime) / 1e9;
+    mStatus.phaseElapsed = (now - mPhaseTime) / 1e9;
+    mStatus.samples++;
+    appendLog();
+
+    if (isPhaseChanged) {
+        emit onPhaseChanged(mStatus);
+    }
+
+    auto termination = checkTermination();
+    if (termination != NotTerminated) {
+        finish(termination);
+        return;
+    }
+
+    mInterval = nextInterval();
+    mStatus.interval = mInterval;
+    emit onStatus(mStatus);
+    mSampleTimer.start(mInterval);
+}
+
+ChargeEngine::Termination ChargeEngine::checkTermination() const {
+    if (!mIsOutputOn) {
+        return OutputSwitchedOff;
+    }
+    if (mOptions.maxTime > 0 && mStatus.elapsed >= mOptions.maxTime * 60) {
+        return MaxTime;
+    }
+    if (mStatus.phase == ConstantVoltage && mOptions.taperCurrent > 0 && mTaperSamples >= TAPER_SAMPLES) {
+        return TaperCurrent;
+    }
+    if (mStatus.phase == ConstantCurrent && mOptions.deltaVoltage > 0 && mStatus.phaseElapsed >= DELTA_V_HOLDOFF_S &&
+        mPeakVoltage - mStatus.voltage >= mOptions.deltaVoltage) {
+        return DeltaVoltage;
+    }
+    return NotTerminated;
+}
+
+/**
+ * The interval grows with every sample of a phase, from the minimum up to the maximum. While the phase is about to
+ * end, it's held at a few minimum intervals, so the transition and the termination are seen in time.
+ */
+int ChargeEngine::nextInterval() const {
+    double interval = mInterval * INTERVAL_GROWTH;
+
+    bool isApproaching;
+    if (mStatus.phase == ConstantCurrent) {
+        isApproaching = mStatus.voltage >= mOptions.voltage * (1 - mOptions.approachMargin) ||
+                        (mOptions.deltaVoltage > 0 && mPeakVoltage - mStatus.voltage >= mOptions.deltaVoltage / 2);
+    } else {
+        isApproaching = mOptions.taperCurrent > 0 && mStatus.current <= mOptions.taperCurrent * (1 + TAPER_APPROACH);
+    }
+    if (isApproaching || mTaperSamples > 0) {
+        interval = qMin(interval, double(mOptions.minInterval * APPROACH_INTERVAL_FACTOR));
+    }
+    if (mOptions.maxTime > 0) {
+        interval = qMin(interval, mOptions.maxTime * 60e3 - mStatus.elapsed * 1e3);
+    }
+    return qBound(mOptions.minInterval, int(interval), mOptions.maxInterval);
+}
+
+bool ChargeEngine::openLog() {
+    QFileInfo info(mStatus.fileName);
+    QString fileName = QString("%1/%2-%3.csv").arg(info.absolutePath(), info.completeBaseName(),
+                                                  QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+    mLog.setFileName(fileName);
+    if (!mLog.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        emit onErrorOccurred(QString("%1: %2").arg(fileName, mLog.errorString()));
+        return false;
+    }
+
+    mLog.write("time_s,phase,voltage,current,ah,wh\n");
+    mLog.flush();
+    mStatus.logFileName = fileName;
+    return true;
+}
+
+void ChargeEngine::appendLog() {
+    // a line per sample and flushed, so a crash or a power cut keeps the charge so far.
+    QTextStream out(&mLog);
+    out << QString::number(mStatus.elapsed, 'f', 1) << ',' << phaseName(mStatus.phase) << ','
+        << mStatus.voltage << ',' << mStatus.current << ','
+        << QString::number(mStatus.charge, 'f', 6) << ',' << QString::number(mStatus.energy, 'f', 6) << '\n';
+    out.flush();
+    mLog.flush();
+}
+
+void ChargeEngine::finish(ChargeEngine::Termination termination) {
+    mSampleTimer.stop();
+    mIsRunning = false;
+    mRequestTime = 0;
+    if (mCommunication->isDeviceReady()) {
+        mCommunication->switchOutput(false);
+    }
+
+    mStatus.elapsed = MonotonicClock::msecsSince(mStartTime) / 1e3;
+    mStatus.termination = termination;
+    mStatus.isRunning = false;
+    mLog.close();
+    emit onSamplingChanged(mOptions.channel, false);
+    emit onFinished(mStatus);
+}
@@ -0,0 +1,144 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_CHARGEENGINE_H
+#define PS_MANAGEMENT_CHARGEENGINE_H
+
+#include <QFile>
+#include <QObject>
+#include <QTimer>
+#include "Communication.h"
+
+/**
+ * CC/CV charge of a battery on one channel, on the I/O thread. ISET is the charge current and VSET the charge
+ * voltage; the device does the regulation and its CC/CV mode bit (DeviceStatus) tells the phase.
+ *
+ * The charge ends when the current tapers below the termination current in CV, when the voltage drops from its peak
+ * by delta-v in CC (NiMH/NiCd), after the maximum time, or when the output is switched off at the device.
+ *
+ * The sampling interval is short after the start and after a phase change, and while the voltage approaches the CV
+ * level or the current approaches the taper; otherwise it grows up to the maximum, so a long CV tail costs a few
+ * queries a minute, while the Poller leaves the measurements of the channel to the engine (onSamplingChanged). Ah
+ * and Wh are integrated from the start and between the samples, and every sample is appended to a CSV log next to
+ * the profile. The profile is described by an INI file (see loadOptions).
+ */
+class ChargeEngine : public QObject {
+    Q_OBJECT
+public:
+    enum Phase {
+        ConstantCurrent,
+        ConstantVoltage,
+    };
+
+    enum Termination {
+        NotTerminated,
+        TaperCurrent,
+        MaxTime,
+        DeltaVoltage,
+        OutputSwitchedOff,
+        Stopped,
+    };
+
+    struct Options {
+        Global::Channel channel = Global::Channel1;
+        double  current = 0.5;          // A, CC
+        double  voltage = 4.2;          // V, CV
+        double  taperCurrent = 0.05;    // A, 0 disables
+        double  deltaVoltage = 0;       // V, 0 disables
+        int     maxTime = 0;            // min, 0 disables
+        int     minInterval = 250;      // ms
+        int     maxInterval = 30000;    // ms
+        double  approachMargin = 0.02;  // relative, below the CV voltage, where the CC phase is about to end
+    };
+
+    struct Status {
+        QString     fileName;
+        QString     logFileName;
+        Phase       phase = ConstantCurrent;
+        Termination termination = NotTerminated;
+        double      voltage = 0;        // V
+        double      current = 0;        // A
+        double      charge = 0;         // Ah
+        double      energy = 0;         // Wh
+        double      elapsed = 0;        // s
+        double      phaseElapsed = 0;   // s, since the last phase change
+        int         interval = 0;       // ms, the present sampling interval
+        qint64      samples = 0;
+        bool        isRunning = false;
+    };
+
+    explicit ChargeEngine(Communication *communication, QObject *parent = nullptr);
+
+    bool isRunning() const { return mIsRunning; }
+
+    static bool loadOptions(const QString &fileName, Options &options, QString &error);
+    static QString describe(const Status &status);
+    static QString phaseName(Phase phase);
+    static QString terminationName(Termination termination);
+
+signals:
+    void onStarted(const QString &fileName);
+    void onStatus(const ChargeEngine::Status &status);
+    void onPhaseChanged(const ChargeEngine::Status &status);
+    void onFinished(const ChargeEngine::Status &status);
+    // the engine samples the measurements of the channel itself, the polling of them can pause.
+    void onSamplingChanged(Global::Channel channel, bool sampled);
+    void onErrorOccurred(QString error);
+
+public slots:
+    void Start(const QString &fileName, const Global::DeviceInfo &info);
+    void Stop();
+
+    void UpdateTelemetry(const Global::TelemetryFrame &frame);
+
+private slots:
+    void SampleDue();
+
+private:
+    void request();
+    void sample();
+    Termination checkTermination() const;
+    int nextInterval() const;
+    bool openLog();
+    void appendLog();
+    void finish(Termination termination);
+
+private:
+    Communication   *mCommunication;
+    Options         mOptions;
+    QTimer          mSampleTimer;
+    QFile           mLog;
+    bool            mIsRunning = false;
+
+    qint64          mStartTime = 0;     // ns, MonotonicClock
+    qint64          mPhaseTime = 0;     // ns, MonotonicClock, the last phase change
+    qint64          mRequestTime = 0;   // ns, MonotonicClock, the queries of the pending sample, 0 if none
+    qint64          mLastSample = 0;    // ns, MonotonicClock, 0 before the first sample
+
+    double          mVoltage = 0;
+    double          mCurrent = 0;
+    bool            mIsOutputOn = false;
+    Phase           mMode = ConstantCurrent;
+    bool            mHasVoltage = false;
+    bool            mHasCurrent = false;
+    bool            mHasStatus = false;
+
+    double          mPeakVoltage = 0;   // V, in CC
+    int             mTaperSamples = 0;  // in a row below the taper current
+    int             mInterval = 0;      // ms
+    Status          mStatus;
+};
+
+Q_DECLARE_METATYPE(ChargeEngine::Status)
+
+#endif //PS_MANAGEMENT_CHARGEENGINE_H
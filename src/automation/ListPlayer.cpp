@@ -0,0 +1,177 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ListPlayer.h"
+#include "MonotonicClock.h"
+#include <QtMath>
+
+#define COARSE_WAIT_MIN_MS 1000
+#define COARSE_WAIT_PART 0.9
+#define LATE_THRESHOLD_MS 10
+// after the last point, how long its command in the queue is waited for.
+#define DRAIN_TIMEOUT_MS 1000
+
+ListPlayer::ListPlayer(Communication *communication, QObject *parent)
+        : QObject(parent), mCommunication(communication), mTimer(this) {
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &ListPlayer::Tick);
+    connect(mCommunication, &Communication::onSerialPortClosed, this, &ListPlayer::Stop);
+    connect(mCommunication, &Communication::onCommandWritten, this, &ListPlayer::CommandWritten);
+    connect(mCommunication, &Communication::onProtectionTripped, this, &ListPlayer::Stop);
+}
+
+QString ListPlayer::describe(const ListPlayer::Report &report) {
+    return QString("%1 %2 after %3 s (planned %4 s): %5 of %6 points sent at %7/s, %8 missed deadlines "
+                   "(%9 skipped, %10 late), lateness mean %11 ms, max %12 ms, command gap %13 ms")
+            .arg(report.fileName, report.isCompleted ? "completed" : "stopped")
+            .arg(report.elapsed, 0, 'f', 1).arg(report.plannedDuration, 0, 'f', 1)
+            .arg(report.sent).arg(report.points).arg(report.rate, 0, 'f', 1)
+            .arg(report.missedDeadlines()).arg(report.skipped).arg(report.late)
+            .arg(report.meanLateness, 0, 'f', 2).arg(report.maxLateness, 0, 'f', 2)
+            .arg(report.commandGap, 0, 'f', 1);
+}
+
+void ListPlayer::Start(const QString &fileName, const Global::DeviceInfo &info) {
+    Stop();
+
+    if (!mList.load(fileName) || !mList.encode(info)) {
+        emit onErrorOccurred(QString("%1: %2").arg(fileName, mList.errorString()));
+        return;
+    }
+
+    mReport = Report();
+    mReport.fileName = fileName;
+    mReport.points = mList.points().size();
+    mReport.plannedDuration = mList.duration() / 1e9;
+    mTotalLateness = 0;
+    mWaitingTag = 0;
+
+    mIndex = 0;
+    mIsRunning = true;
+    mCommunication->armProtection();
+    mStartTime = MonotonicClock::nsecs();
+    emit onStarted(fileName);
+    Tick();
+}
+
+void ListPlayer::Stop() {
+    if (mIsRunning) {
+        finish(false);
+    }
+}
+
+void ListPlayer::Tick() {
+    const auto &points = mList.points();
+    if (mIndex >= points.size()) {
+        // the command of the last point wasn't written in time.
+        finish(true);
+        return;
+    }
+
+    qint64 now = MonotonicClock::nsecs();
+    qint64 elapsed = now - mStartTime;
+
+    if (points.at(mIndex).at <= elapsed) {
+        if (mCommunication->hasPendingStreamed()) {
+            // the previous command isn't written yet, come back after a command gap.
+            mTimer.setTimerType(Qt::PreciseTimer);
+            mTimer.start(qMax(1, qCeil(mCommunication->commandGap() / 2)));
+            return;
+        }
+
+        int latest = mIndex;
+        while (latest + 1 < points.size() && points.at(latest + 1).at <= elapsed) {
+            latest++;
+        }
+        mReport.skipped += latest - mIndex;
+        send(latest);
+        mIndex = latest + 1;
+
+        if (mIndex >= points.size()) {
+            if (mWaitingTag == 0) {
+                finish(true);
+            } else {
+                // the last command is still queued, its lateness is taken when it's written.
+                mTimer.setTimerType(Qt::PreciseTimer);
+                mTimer.start(DRAIN_TIMEOUT_MS);
+            }
+            return;
+        }
+    }
+
+    double ms = qMax(0.0, (mStartTime + points.at(mIndex).at - MonotonicClock::nsecs()) / 1e6);
+    if (ms >= COARSE_WAIT_MIN_MS) {
+        mTimer.setTimerType(Qt::CoarseTimer);
+        mTimer.start(int(ms * COARSE_WAIT_PART));
+    } else {
+        mTimer.setTimerType(Qt::PreciseTimer);
+        mTimer.start(qCeil(ms));
+    }
+}
+
+void ListPlayer::send(int index) {
+    if (mWaitingTag != 0) {
+        // the previous command was dropped from the queue, it never took effect.
+        mReport.skipped++;
+    }
+
+    const auto &point = mList.points().at(index);
+    mWaitingTag = mCommunication->newCommandTag();
+    mWaitingAt = point.at;
+    mCommunication->setCommandTag(mWaitingTag);
+    mCommunication->WriteStreamed(mList.channel(), mList.field(), point.command);
+    mCommunication->setCommandTag(0);
+}
+
+void ListPlayer::CommandWritten(qint64 tag, qint64 sendTime) {
+    if (!mIsRunning || tag != mWaitingTag) {
+        return;
+    }
+
+    mWaitingTag = 0;
+    double lateness = (sendTime - mStartTime - mWaitingAt) / 1e6;
+    mTotalLateness += lateness;
+    mReport.sent++;
+    mReport.maxLateness = qMax(mReport.maxLateness, lateness);
+    if (lateness > LATE_THRESHOLD_MS) {
+        mReport.late++;
+    }
+
+    if (mIndex >= mList.points().size()) {
+        finish(true);
+    }
+}
+
+void ListPlayer::finish(bool completed) {
+    mTimer.stop();
+    mIsRunning = false;
+    if (mWaitingTag != 0) {
+        mReport.skipped++;
+        mWaitingTag = 0;
+    }
+
+    mReport.isCompleted = completed;
+    if (!completed) {
+        // the points, which were due but not sent, missed their deadlines as well.
+        qint64 elapsed = MonotonicClock::nsecs() - mStartTime;
+        const auto &points = mList.points();
+        while (mIndex < points.size() && points.at(mIndex).at <= elapsed) {
+            mReport.skipped++, mIndex++;
+        }
+    }
+    mReport.elapsed = MonotonicClock::msecsSince(mStartTime) / 1e3;
+    mReport.meanLateness = mReport.sent > 0 ? mTotalLateness / mReport.sent : 0;
+    mReport.rate = mReport.elapsed > 0 ? mReport.sent / mReport.elapsed : 0;
+    mReport.commandGap = mCommunication->commandGap();
+    emit onFinished(mReport);
+}
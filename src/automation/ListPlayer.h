@@ -0,0 +1,93 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_LISTPLAYER_H
+#define PS_MANAGEMENT_LISTPLAYER_H
+
+#include <QObject>
+#include <QTimer>
+#include "Communication.h"
+#include "SetpointList.h"
+
+/**
+ * List mode: plays a SetpointList through Communication, on the I/O thread.
+ *
+ * The commands are encoded before the start, a due point costs only putting its bytes into the queue. At most one
+ * command of the list waits in the queue, the next one follows the learned command gap of Communication, so the
+ * list goes as fast as the link allows and never piles up behind the polling. When the points are denser than
+ * that, the latest due point is sent and the ones before it are skipped.
+ *
+ * Missed deadlines are the skipped points and the points written later than LATE_THRESHOLD_MS. The lateness is
+ * measured when the command is written to the serial port (onCommandWritten), so the queue wait and the command gap
+ * count. A point whose command was dropped from the queue is skipped.
+ */
+class ListPlayer : public QObject {
+    Q_OBJECT
+public:
+    struct Report {
+        QString fileName;
+        int     points = 0;        // after the duplicates were left out
+        int     sent = 0;          // written to the serial port
+        int     skipped = 0;
+        int     late = 0;
+        double  meanLateness = 0;  // ms, of the sent points
+        double  maxLateness = 0;   // ms
+        double  commandGap = 0;    // ms, learned, at the end
+        double  rate = 0;          // commands per second
+        double  plannedDuration = 0; // s
+        double  elapsed = 0;       // s
+        bool    isCompleted = false;
+
+        int missedDeadlines() const { return skipped + late; }
+    };
+
+    explicit ListPlayer(Communication *communication, QObject *parent = nullptr);
+
+    bool isRunning() const { return mIsRunning; }
+    Report report() const { return mReport; }
+
+    static QString describe(const Report &report);
+
+signals:
+    void onStarted(const QString &fileName);
+    void onFinished(const ListPlayer::Report &report);
+    void onErrorOccurred(QString error);
+
+public slots:
+    void Start(const QString &fileName, const Global::DeviceInfo &info);
+    void Stop();
+
+private slots:
+    void Tick();
+    void CommandWritten(qint64 tag, qint64 sendTime);
+
+private:
+    void send(int index);
+    void finish(bool completed);
+
+private:
+    Communication *mCommunication;
+    SetpointList  mList;
+    QTimer        mTimer;
+    int           mIndex = 0;
+    bool          mIsRunning = false;
+    qint64        mStartTime = 0;    // ns, MonotonicClock
+    qint64        mWaitingTag = 0;   // of the queued command, 0 if none
+    qint64        mWaitingAt = 0;    // ns since the start, the plan of the queued command
+    double        mTotalLateness = 0;
+    Report        mReport;
+};
+
+Q_DECLARE_METATYPE(ListPlayer::Report)
+
+#endif //PS_MANAGEMENT_LISTPLAYER_H
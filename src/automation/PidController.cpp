@@ -0,0 +1,41 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PidController.h"
+
+PidController::PidController() : PidController(Gains(), 0, 0) {
+}
+
+PidController::PidController(const PidController::Gains &gains, double minOutput, double maxOutput)
+        : mGains(gains), mMinOutput(minOutput), mMaxOutput(maxOutput) {
+}
+
+void PidController::reset(double output) {
+    mOutput = qBound(mMinOutput, output, mMaxOutput);
+    mIntegrator = mOutput;
+    mHasMeasurement = false;
+}
+
+double PidController::update(double error, double measurement, double dt, bool holdIntegrator) {
+    double derivative = mHasMeasurement && dt > 0 ? (measurement - mLastMeasurement) / dt : 0;
+    mLastMeasurement = measurement;
+    mHasMeasurement = true;
+
+    bool isSaturated = (mOutput >= mMaxOutput && error > 0) || (mOutput <= mMinOutput && error < 0);
+    if (!holdIntegrator && !isSaturated) {
+        mIntegrator = qBound(mMinOutput, mIntegrator + mGains.ki * error * dt, mMaxOutput);
+    }
+
+    mOutput = qBound(mMinOutput, mIntegrator + mGains.kp * error - mGains.kd * derivative, mMaxOutput);
+    return mOutput;
+}
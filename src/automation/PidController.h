@@ -0,0 +1,53 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_PIDCONTROLLER_H
+#define PS_MANAGEMENT_PIDCONTROLLER_H
+
+#include <QtGlobal>
+
+/**
+ * Positional PID with the output clamped to a range. The integrator doesn't wind up: it stops while the output is
+ * saturated in the direction of the error, and it can be held, e.g. while the supply limits the current. The
+ * derivative is taken on the measurement, so a setpoint change doesn't kick the output. dt is the real time between
+ * the samples, the serial link doesn't sample evenly.
+ */
+class PidController {
+public:
+    struct Gains {
+        double kp = 0.3;
+        double ki = 2.0;    // 1/s
+        double kd = 0;      // s
+    };
+
+    PidController();
+    PidController(const Gains &gains, double minOutput, double maxOutput);
+
+    // bumpless start from the present output.
+    void reset(double output);
+    // dt in seconds.
+    double update(double error, double measurement, double dt, bool holdIntegrator = false);
+
+    double output() const { return mOutput; }
+
+private:
+    Gains  mGains;
+    double mMinOutput;
+    double mMaxOutput;
+    double mIntegrator = 0;
+    double mLastMeasurement = 0;
+    bool   mHasMeasurement = false;
+    double mOutput = 0;
+};
+
+#endif //PS_MANAGEMENT_PIDCONTROLLER_H
@@ -0,0 +1,272 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Sequence.h"
+#include <QFile>
+#include <QtMath>
+
+#define DEFAULT_RAMP_STEP_MS 100
+#define MIN_RAMP_STEP_MS 10
+
+static bool parseDuration(const QByteArray &word, qint64 &ns) {
+    double scale = 1e9;
+    QByteArray number = word;
+    if (word.endsWith("ms")) {
+        scale = 1e6, number.chop(2);
+    } else if (word.endsWith("min")) {
+        scale = 60e9, number.chop(3);
+    } else if (word.endsWith("s")) {
+        number.chop(1);
+    }
+
+    bool ok;
+    double value = number.toDouble(&ok);
+    if (!ok || value < 0) {
+        return false;
+    }
+    ns = qint64(qRound64(value * scale));
+    return true;
+}
+
+static bool parseChannel(const QByteArray &word, Global::Channel &channel) {
+    if (word == "1") {
+        channel = Global::Channel1;
+    } else if (word == "2") {
+        channel = Global::Channel2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseValue(const QByteArray &word, double &value) {
+    bool ok;
+    value = word.toDouble(&ok);
+    return ok && value >= 0;
+}
+
+bool Sequence::load(const QString &fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        mErrorString = QString("%1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    return parse(file.readAll());
+}
+
+bool Sequence::parse(const QByteArray &text) {
+    mProgram.clear();
+    mErrorString.clear();
+
+    QVector<int> loops;
+    const auto lines = text.split('\n');
+    for (int i = 0; i < lines.size(); ++i) {
+        QByteArray line = lines.at(i);
+        int comment = line.indexOf('#');
+        if (comment >= 0) {
+            line.truncate(comment);
+        }
+        const auto words = line.simplified().split(' ');
+        if (words.first().isEmpty()) {
+            continue;
+        }
+        if (!parseLine(words, i + 1)) {
+            return false;
+        }
+
+        auto &instruction = mProgram.last();
+        if (instruction.operation == LoopBegin) {
+            loops.append(mProgram.size() - 1);
+        } else if (instruction.operation == LoopEnd) {
+            if (loops.isEmpty()) {
+                return fail(i + 1, "END without LOOP");
+            }
+            int begin = loops.takeLast();
+            instruction.match = begin;
+            mProgram[begin].match = mProgram.size() - 1;
+            if (mProgram.at(begin).count == 0 && duration(begin + 1, mProgram.size() - 1) == 0) {
+                return fail(i + 1, "an endless LOOP must WAIT or RAMP");
+            }
+        }
+    }
+
+    if (!loops.isEmpty()) {
+        return fail(mProgram.at(loops.last()).line, "LOOP without END");
+    }
+    rewind();
+    return true;
+}
+
+bool Sequence::parseLine(const QList<QByteArray> &words, int line) {
+    Instruction instruction;
+    instruction.line = line;
+    const QByteArray keyword = words.first().toUpper();
+
+    if (keyword == "VSET" || keyword == "ISET") {
+        instruction.command = keyword == "VSET" ? SetVoltage : SetCurrent;
+        if (words.size() != 3 || !parseChannel(words.at(1), instruction.channel) ||
+            !parseValue(words.at(2), instruction.value)) {
+            return fail(line, QString("expected %1 <channel> <value>").arg(QString(keyword)));
+        }
+    } else if (keyword == "OUT") {
+        instruction.command = SetOutput;
+        QByteArray state = words.size() == 2 ? words.at(1).toLower() : QByteArray();
+        if (state != "on" && state != "off" && state != "1" && state != "0") {
+            return fail(line, "expected OUT on|off");
+        }
+        instruction.value = state == "on" || state == "1" ? 1 : 0;
+    } else if (keyword == "WAIT") {
+        instruction.operation = Wait;
+        if (words.size() != 2 || !parseDuration(words.at(1), instruction.duration)) {
+            return fail(line, "expected WAIT <duration>");
+        }
+    } else if (keyword == "RAMP") {
+        instruction.operation = Ramp;
+        QByteArray target = words.size() > 1 ? words.at(1).toUpper() : QByteArray();
+        instruction.command = target == "ISET" ? SetCurrent : SetVoltage;
+        instruction.step = DEFAULT_RAMP_STEP_MS * 1000000LL;
+        if ((words.size() != 6 && words.size() != 7) || (target != "VSET" && target != "ISET") ||
+            !parseChannel(words.at(2), instruction.channel) || !parseValue(words.at(3), instruction.value) ||
+            !parseValue(words.at(4), instruction.to) || !parseDuration(words.at(5), instruction.duration) ||
+            (words.size() == 7 && !parseDuration(words.at(6), instruction.step))) {
+            return fail(line, "expected RAMP VSET|ISET <channel> <from> <to> <duration> [<step>]");
+        }
+        if (instruction.step < MIN_RAMP_STEP_MS * 1000000LL) {
+            return fail(line, QString("the RAMP step is shorter than %1 ms").arg(MIN_RAMP_STEP_MS));
+        }
+    } else if (keyword == "LOOP") {
+        instruction.operation = LoopBegin;
+        bool ok = true;
+        instruction.count = words.size() == 2 ? words.at(1).toInt(&ok) : 0;
+        if (words.size() > 2 || !ok || instruction.count < 0 || (words.size() == 2 && instruction.count == 0)) {
+            return fail(line, "expected LOOP [<count>]");
+        }
+    } else if (keyword == "END") {
+        instruction.operation = LoopEnd;
+    } else {
+        return fail(line, QString("unknown statement %1").arg(QString(words.first())));
+    }
+
+    mProgram.append(instruction);
+    return true;
+}
+
+bool Sequence::validate(const Global::DeviceInfo &info) {
+    for (const auto &instruction : qAsConst(mProgram)) {
+        if (instruction.operation != Set && instruction.operation != Ramp) {
+            continue;
+        }
+        if (instruction.channel == Global::Channel2 && info.ActiveChannelsCount < 2) {
+            return fail(instruction.line, QString("%1 has one channel").arg(info.Name));
+        }
+
+        double high = qMax(instruction.value, instruction.operation == Ramp ? instruction.to : 0);
+        if (instruction.command == SetVoltage && high > info.MaxVoltage) {
+            return fail(instruction.line, QString("%1 V is above the %2 V maximum").arg(high).arg(info.MaxVoltage));
+        }
+        if (instruction.command == SetCurrent && high > info.MaxCurrent) {
+            return fail(instruction.line, QString("%1 A is above the %2 A maximum").arg(high).arg(info.MaxCurrent));
+        }
+    }
+    return true;
+}
+
+bool Sequence::fail(int line, const QString &error) {
+    mErrorString = QString("line %1: %2").arg(line).arg(error);
+    return false;
+}
+
+qint64 Sequence::duration() const {
+    return duration(0, mProgram.size());
+}
+
+qint64 Sequence::duration(int begin, int end) const {
+    qint64 total = 0;
+    for (int i = begin; i < end; ++i) {
+        const auto &instruction = mProgram.at(i);
+        if (instruction.operation == Wait || instruction.operation == Ramp) {
+            total += instruction.duration;
+        } else if (instruction.operation == LoopBegin) {
+            qint64 body = duration(i + 1, instruction.match);
+            if (body < 0 || (instruction.count == 0 && body > 0)) {
+                return -1;
+            }
+            total += body * instruction.count;
+            i = instruction.match;
+        }
+    }
+    return total;
+}
+
+void Sequence::rewind() {
+    mPosition = 0;
+    mTime = 0;
+    mRampStep = 0;
+    mLoops.clear();
+}
+
+bool Sequence::next(Action &action) {
+    while (mPosition < mProgram.size()) {
+        const auto &instruction = mProgram.at(mPosition);
+        switch (instruction.operation) {
+            case Set:
+                action.at = mTime;
+                action.command = instruction.command;
+                action.channel = instruction.channel;
+                action.value = instruction.value;
+                action.line = instruction.line;
+                mPosition++;
+                return true;
+
+            case Wait:
+                mTime += instruction.duration;
+                mPosition++;
+                break;
+
+            case Ramp: {
+                // the points are spread evenly, the last one lands exactly on the target value and time.
+                qint64 steps = qMax<qint64>(1, qCeil(double(instruction.duration) / instruction.step));
+                if (mRampStep <= steps) {
+                    action.at = mTime + instruction.duration * mRampStep / steps;
+                    action.command = instruction.command;
+                    action.channel = instruction.channel;
+                    action.value = instruction.value + (instruction.to - instruction.value) * mRampStep / steps;
+                    action.line = instruction.line;
+                    mRampStep++;
+                    return true;
+                }
+                mTime += instruction.duration;
+                mRampStep = 0;
+                mPosition++;
+                break;
+            }
+
+            case LoopBegin:
+                mLoops.append({mPosition + 1, instruction.count});
+                mPosition++;
+                break;
+
+            case LoopEnd: {
+                auto &loop = mLoops.last();
+                if (loop.left == 0 || --loop.left > 0) {
+                    mPosition = loop.begin;
+                } else {
+                    mLoops.removeLast();
+                    mPosition++;
+                }
+                break;
+            }
+        }
+    }
+    return false;
+}
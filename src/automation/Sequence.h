@@ -0,0 +1,104 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_SEQUENCE_H
+#define PS_MANAGEMENT_SEQUENCE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "Global.h"
+
+/**
+ * Voltage and current program for Sequencer, one statement per line:
+ *
+ *   VSET <ch> <V>          ISET <ch> <A>          OUT on|off
+ *   WAIT <duration>
+ *   RAMP VSET|ISET <ch> <from> <to> <duration> [<step>]
+ *   LOOP [<count>] ... END  (no count -- forever)
+ *
+ * A duration is seconds, or a number with the ms, s or min suffix; '#' starts a comment.
+ * next() unrolls the loops and ramps into the actions with their planned times, the times are computed from the
+ * program only, so the plan doesn't drift whatever happens to the execution.
+ */
+class Sequence {
+public:
+    enum Command {
+        SetVoltage,
+        SetCurrent,
+        SetOutput,
+    };
+
+    struct Action {
+        qint64          at = 0;     // ns since the start of the sequence
+        Command         command = SetVoltage;
+        Global::Channel channel = Global::Channel1;
+        double          value = 0;  // V, A, or 0/1 of the output switch
+        int             line = 0;
+    };
+
+    bool load(const QString &fileName);
+    bool parse(const QByteArray &text);
+    // values out of the device ranges and a channel the device doesn't have.
+    bool validate(const Global::DeviceInfo &info);
+    QString errorString() const { return mErrorString; }
+
+    bool isEmpty() const { return mProgram.isEmpty(); }
+    // ns of the whole sequence, -1 if it loops forever.
+    qint64 duration() const;
+
+    void rewind();
+    bool next(Action &action);
+
+private:
+    enum Operation {
+        Set,
+        Wait,
+        Ramp,
+        LoopBegin,
+        LoopEnd,
+    };
+
+    struct Instruction {
+        Operation       operation = Set;
+        Command         command = SetVoltage;
+        Global::Channel channel = Global::Channel1;
+        double          value = 0;
+        double          to = 0;         // Ramp
+        qint64          duration = 0;   // ns, Wait and Ramp
+        qint64          step = 0;       // ns, Ramp
+        int             count = 0;      // LoopBegin, 0 -- forever
+        int             match = -1;     // LoopBegin and LoopEnd, the index of the other one
+        int             line = 0;
+    };
+
+    struct Loop {
+        int begin;
+        int left;
+    };
+
+    bool parseLine(const QList<QByteArray> &words, int line);
+    bool fail(int line, const QString &error);
+    qint64 duration(int begin, int end) const;
+
+private:
+    QVector<Instruction> mProgram;
+    QString              mErrorString;
+
+    int                  mPosition = 0;
+    qint64               mTime = 0;
+    int                  mRampStep = 0;
+    QVector<Loop>        mLoops;
+};
+
+#endif //PS_MANAGEMENT_SEQUENCE_H
@@ -0,0 +1,165 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Sequencer.h"
+#include "MonotonicClock.h"
+#include <QtMath>
+
+// Coarse timers may fire 5% early or late, so a long wait is slept coarse up to this part of it.
+#define COARSE_WAIT_MIN_MS 1000
+#define COARSE_WAIT_PART 0.9
+#define LATE_THRESHOLD_MS 10
+// after the last action, how long the commands still in the queue are waited for.
+#define DRAIN_TIMEOUT_MS 1000
+
+Sequencer::Sequencer(Communication *communication, QObject *parent)
+        : QObject(parent), mCommunication(communication), mTimer(this) {
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &Sequencer::Tick);
+    // there is nobody to send the commands to.
+    connect(mCommunication, &Communication::onSerialPortClosed, this, &Sequencer::Stop);
+    connect(mCommunication, &Communication::onCommandWritten, this, &Sequencer::CommandWritten);
+    // a looped OUT on mustn't undo the trip.
+    connect(mCommunication, &Communication::onProtectionTripped, this, &Sequencer::Stop);
+}
+
+QString Sequencer::describe(const Sequencer::Report &report) {
+    QString planned = report.plannedDuration < 0 ? "endless" : QString("%1 s").arg(report.plannedDuration, 0, 'f', 1);
+    return QString("%1 %2 after %3 s (planned %4): %5 actions, lateness mean %6 ms, max %7 ms at line %8, "
+                   "%9 later than %10 ms, %11 unwritten")
+            .arg(report.fileName, report.isCompleted ? "completed" : "stopped")
+            .arg(report.elapsed, 0, 'f', 1).arg(planned).arg(report.actions)
+            .arg(report.meanLateness, 0, 'f', 2).arg(report.maxLateness, 0, 'f', 2).arg(report.maxLatenessLine)
+            .arg(report.lateActions).arg(LATE_THRESHOLD_MS).arg(report.unwrittenActions);
+}
+
+void Sequencer::Start(const QString &fileName, const Global::DeviceInfo &info) {
+    Stop();
+
+    if (!mSequence.load(fileName) || !mSequence.validate(info)) {
+        emit onErrorOccurred(mSequence.errorString());
+        return;
+    }
+
+    mReport = Report();
+    mReport.fileName = fileName;
+    qint64 duration = mSequence.duration();
+    mReport.plannedDuration = duration < 0 ? -1 : duration / 1e9;
+    mTotalLateness = 0;
+    mWaiting.clear();
+
+    mIsRunning = true;
+    mHasNext = mSequence.next(mNext);
+    mCommunication->armProtection();
+    mStartTime = MonotonicClock::nsecs();
+    emit onStarted(fileName);
+    Tick();
+}
+
+void Sequencer::Stop() {
+    if (mIsRunning) {
+        finish(false);
+    }
+}
+
+void Sequencer::Tick() {
+    qint64 now = MonotonicClock::nsecs();
+    // everything due is sent right away, a late wakeup doesn't shift the following actions.
+    while (mHasNext && mStartTime + mNext.at <= now) {
+        execute(mNext);
+        mHasNext = mSequence.next(mNext);
+    }
+
+    if (!mHasNext) {
+        // the last WAIT of the program still counts.
+        qint64 end = mStartTime + qMax<qint64>(0, mSequence.duration());
+        if (end > now) {
+            mTimer.setTimerType(Qt::PreciseTimer);
+            mTimer.start(int(qCeil((end - now) / 1e6)));
+        } else if (mWaiting.isEmpty() || now >= end + DRAIN_TIMEOUT_MS * 1000000LL) {
+            finish(true);
+        } else {
+            // the last commands are still queued, their lateness is taken when they're written.
+            mTimer.setTimerType(Qt::PreciseTimer);
+            mTimer.start(DRAIN_TIMEOUT_MS);
+        }
+        return;
+    }
+    schedule();
+}
+
+void Sequencer::schedule() {
+    qint64 remaining = mStartTime + mNext.at - MonotonicClock::nsecs();
+    double ms = qMax(0.0, remaining / 1e6);
+    if (ms >= COARSE_WAIT_MIN_MS) {
+        mTimer.setTimerType(Qt::CoarseTimer);
+        mTimer.start(int(ms * COARSE_WAIT_PART));
+    } else {
+        mTimer.setTimerType(Qt::PreciseTimer);
+        mTimer.start(int(qCeil(ms)));
+    }
+}
+
+void Sequencer::execute(const Sequence::Action &action) {
+    qint64 tag = mCommunication->newCommandTag();
+    mWaiting.insert(tag, action);
+    mCommunication->setCommandTag(tag);
+    switch (action.command) {
+        case Sequence::SetVoltage:
+            mCommunication->SetVoltage(action.channel, action.value);
+            break;
+        case Sequence::SetCurrent:
+            mCommunication->SetCurrent(action.channel, action.value);
+            break;
+        case Sequence::SetOutput:
+            mCommunication->switchOutput(action.value != 0);
+            break;
+    }
+    mCommunication->setCommandTag(0);
+    mReport.actions++;
+}
+
+void Sequencer::CommandWritten(qint64 tag, qint64 sendTime) {
+    if (!mIsRunning || !mWaiting.contains(tag)) {
+        return;
+    }
+
+    auto action = mWaiting.take(tag);
+    double lateness = (sendTime - mStartTime - action.at) / 1e6;
+    mTotalLateness += lateness;
+    if (lateness > LATE_THRESHOLD_MS) {
+        mReport.lateActions++;
+    }
+    if (lateness > mReport.maxLateness) {
+        mReport.maxLateness = lateness;
+        mReport.maxLatenessLine = action.line;
+    }
+
+    if (!mHasNext && mWaiting.isEmpty()) {
+        Tick();
+    }
+}
+
+void Sequencer::finish(bool completed) {
+    mTimer.stop();
+    mIsRunning = false;
+    mHasNext = false;
+
+    mReport.isCompleted = completed;
+    mReport.elapsed = MonotonicClock::msecsSince(mStartTime) / 1e3;
+    mReport.unwrittenActions = mWaiting.size();
+    mWaiting.clear();
+    int written = mReport.actions - mReport.unwrittenActions;
+    mReport.meanLateness = written > 0 ? mTotalLateness / written : 0;
+    emit onFinished(mReport);
+}
@@ -0,0 +1,92 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_SEQUENCER_H
+#define PS_MANAGEMENT_SEQUENCER_H
+
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include "Communication.h"
+#include "Sequence.h"
+
+/**
+ * Plays a Sequence through Communication, on the I/O thread.
+ *
+ * Every action is due at the start time plus its planned offset, and the timer is armed again from that absolute
+ * time for each action, so the late wakeups don't add up over a long program as with chained intervals. A long
+ * wait is slept with a coarse timer and the rest with a precise one. The commands go through the message queue
+ * ahead of the pending queries, so the polling goes on between them.
+ *
+ * The lateness of each action is measured when its command is written to the serial port (onCommandWritten), so
+ * the wait behind the in-flight query counts; the report compares it with the plan. At the end the commands still
+ * in the queue are waited for a moment, an action whose command was dropped is reported unwritten.
+ */
+class Sequencer : public QObject {
+    Q_OBJECT
+public:
+    struct Report {
+        QString fileName;
+        int     actions = 0;
+        int     lateActions = 0;      // later than LATE_THRESHOLD_MS
+        double  meanLateness = 0;     // ms
+        double  maxLateness = 0;      // ms
+        int     maxLatenessLine = 0;
+        int     unwrittenActions = 0; // not written to the port, e.g. dropped with the queue
+        double  plannedDuration = 0;  // s, -1 -- endless
+        double  elapsed = 0;          // s
+        bool    isCompleted = false;
+    };
+
+    explicit Sequencer(Communication *communication, QObject *parent = nullptr);
+
+    bool isRunning() const { return mIsRunning; }
+    Report report() const { return mReport; }
+
+    static QString describe(const Report &report);
+
+signals:
+    void onStarted(const QString &fileName);
+    void onFinished(const Sequencer::Report &report);
+    void onErrorOccurred(QString error);
+
+public slots:
+    // the sequence is checked against the device ranges before it starts.
+    void Start(const QString &fileName, const Global::DeviceInfo &info);
+    void Stop();
+
+private slots:
+    void Tick();
+    void CommandWritten(qint64 tag, qint64 sendTime);
+
+private:
+    void schedule();
+    void execute(const Sequence::Action &action);
+    void finish(bool completed);
+
+private:
+    Communication      *mCommunication;
+    Sequence           mSequence;
+    QTimer             mTimer;
+    Sequence::Action   mNext;
+    bool               mHasNext = false;
+    bool               mIsRunning = false;
+    qint64             mStartTime = 0;    // ns, MonotonicClock
+    QHash<qint64, Sequence::Action> mWaiting; // by the tag, queued and not written yet
+    double             mTotalLateness = 0;
+    Report             mReport;
+};
+
+Q_DECLARE_METATYPE(Sequencer::Report)
+
+#endif //PS_MANAGEMENT_SEQUENCER_H
@@ -0,0 +1,151 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SetpointList.h"
+#include "protocol/Factory.h"
+#include <QFile>
+#include <cstring>
+
+bool SetpointList::load(const QString &fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        mErrorString = QString("%1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    if (file.size() == 0) {
+        mErrorString = QString("%1 is empty").arg(fileName);
+        return false;
+    }
+
+    // the points are parsed straight from the page cache, the file isn't copied into memory as a whole.
+    const uchar *data = file.map(0, file.size());
+    if (data == nullptr) {
+        return parse(file.readAll().constData(), file.size());
+    }
+    bool ok = parse(reinterpret_cast<const char*>(data), file.size());
+    file.unmap(const_cast<uchar*>(data));
+    return ok;
+}
+
+bool SetpointList::parse(const char *data, qint64 size) {
+    mPoints.clear();
+    mSourceCount = 0;
+    mErrorString.clear();
+
+    bool isHeaderRead = false;
+    int line = 0;
+    const char *end = data + size;
+    for (const char *begin = data; begin < end; ) {
+        auto newline = static_cast<const char*>(std::memchr(begin, '\n', size_t(end - begin)));
+        const char *lineEnd = newline != nullptr ? newline : end;
+        QByteArray text = QByteArray::fromRawData(begin, int(lineEnd - begin));
+        begin = lineEnd + 1;
+        line++;
+
+        int comment = text.indexOf('#');
+        text = (comment >= 0 ? text.left(comment) : text).trimmed();
+        if (text.isEmpty()) {
+            continue;
+        }
+
+        int comma = text.indexOf(',');
+        if (comma < 0) {
+            return fail(line, "expected <time>,<value>");
+        }
+        if (!isHeaderRead) {
+            if (!parseHeader(text.mid(comma + 1).trimmed())) {
+                return fail(line, "expected the header time,VSET<ch> or time,ISET<ch>");
+            }
+            isHeaderRead = true;
+            continue;
+        }
+
+        bool isTimeValid, isValueValid;
+        double time = text.left(comma).trimmed().toDouble(&isTimeValid);
+        double value = text.mid(comma + 1).trimmed().toDouble(&isValueValid);
+        if (!isTimeValid || !isValueValid || time < 0 || value < 0) {
+            return fail(line, "expected <time>,<value>");
+        }
+
+        Point point;
+        point.at = qRound64(time * 1e9);
+        point.value = value;
+        if (!mPoints.isEmpty() && point.at < mPoints.last().at) {
+            return fail(line, "the time goes back");
+        }
+        mPoints.append(point);
+    }
+
+    if (mPoints.isEmpty()) {
+        mErrorString = "no points";
+        return false;
+    }
+    mSourceCount = mPoints.size();
+    return true;
+}
+
+bool SetpointList::parseHeader(const QByteArray &column) {
+    QByteArray name = column.toUpper();
+    if (name.size() != 5 || !(name.startsWith("VSET") || name.startsWith("ISET"))) {
+        return false;
+    }
+    if (name.at(4) != '1' && name.at(4) != '2') {
+        return false;
+    }
+
+    mField = name.startsWith("VSET") ? DeviceShadow::VoltageSet : DeviceShadow::CurrentSet;
+    mChannel = name.at(4) == '1' ? Global::Channel1 : Global::Channel2;
+    return true;
+}
+
+bool SetpointList::encode(const Global::DeviceInfo &info) {
+    QScopedPointer<Protocol::BaseSCPI> protocol(Protocol::Factory::createByDeviceID(info.ID));
+    if (protocol.isNull()) {
+        mErrorString = QString("unknown device %1").arg(info.ID);
+        return false;
+    }
+    if (mChannel == Global::Channel2 && info.ActiveChannelsCount < 2) {
+        mErrorString = QString("%1 has one channel").arg(info.Name);
+        return false;
+    }
+
+    bool isVoltage = mField == DeviceShadow::VoltageSet;
+    double maximum = isVoltage ? info.MaxVoltage : info.MaxCurrent;
+    QVector<Point> encoded;
+    encoded.reserve(mPoints.size());
+    for (auto &point : mPoints) {
+        if (point.value > maximum) {
+            mErrorString = QString("%1 %2 is above the %3 %2 maximum")
+                    .arg(point.value).arg(isVoltage ? "V" : "A").arg(maximum);
+            return false;
+        }
+
+        QScopedPointer<Protocol::IMessage> message(isVoltage
+                ? protocol->createMessageSetVoltage(mChannel, point.value)
+                : protocol->createMessageSetCurrent(mChannel, point.value));
+        point.command = message->query();
+        // the same setpoint after the rounding of the device, nothing to send.
+        if (!encoded.isEmpty() && encoded.last().command == point.command) {
+            continue;
+        }
+        encoded.append(point);
+    }
+
+    mPoints = encoded;
+    return true;
+}
+
+bool SetpointList::fail(int line, const QString &error) {
+    mErrorString = QString("line %1: %2").arg(line).arg(error);
+    return false;
+}
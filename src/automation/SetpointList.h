@@ -0,0 +1,65 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_SETPOINTLIST_H
+#define PS_MANAGEMENT_SETPOINTLIST_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "Global.h"
+#include "DeviceShadow.h"
+
+/**
+ * Dense setpoint curve for ListPlayer, a CSV of the time (s) and the value of one set field:
+ *
+ *   time,VSET1
+ *   0.000,12.00
+ *   0.050,7.20
+ *
+ * The file is read through a memory map. encode() turns every point into the command bytes of the device ahead of
+ * time, and leaves out the points, which encode to the same command as the previous one.
+ */
+class SetpointList {
+public:
+    struct Point {
+        qint64     at = 0;     // ns since the start of the list
+        double     value = 0;
+        QByteArray command;
+    };
+
+    bool load(const QString &fileName);
+    bool parse(const char *data, qint64 size);
+    bool encode(const Global::DeviceInfo &info);
+    QString errorString() const { return mErrorString; }
+
+    Global::Channel channel() const { return mChannel; }
+    DeviceShadow::ChannelField field() const { return mField; }
+    const QVector<Point> &points() const { return mPoints; }
+    // points of the file, before the duplicates are left out.
+    int sourceCount() const { return mSourceCount; }
+    qint64 duration() const { return mPoints.isEmpty() ? 0 : mPoints.last().at; }
+
+private:
+    bool parseHeader(const QByteArray &column);
+    bool fail(int line, const QString &error);
+
+private:
+    Global::Channel            mChannel = Global::Channel1;
+    DeviceShadow::ChannelField mField = DeviceShadow::VoltageSet;
+    QVector<Point>             mPoints;
+    int                        mSourceCount = 0;
+    QString                    mErrorString;
+};
+
+#endif //PS_MANAGEMENT_SETPOINTLIST_H
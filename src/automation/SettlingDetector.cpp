@@ -0,0 +1,43 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SettlingDetector.h"
+
+SettlingDetector::SettlingDetector() : SettlingDetector(3, 0.01) {
+}
+
+SettlingDetector::SettlingDetector(int samples, double tolerance)
+        : mSamples(qBound(2, samples, WindowSize)), mTolerance(tolerance) {
+}
+
+void SettlingDetector::reset() {
+    mCount = 0;
+}
+
+void SettlingDetector::add(double value) {
+    mWindow[mCount % WindowSize] = value;
+    mCount++;
+}
+
+bool SettlingDetector::isSettled() const {
+    if (mCount < mSamples) {
+        return false;
+    }
+
+    double low = last(), high = last();
+    for (int i = mCount - mSamples; i < mCount; ++i) {
+        low = qMin(low, mWindow[i % WindowSize]);
+        high = qMax(high, mWindow[i % WindowSize]);
+    }
+    return high - low <= mTolerance;
+}
@@ -0,0 +1,44 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_SETTLINGDETECTOR_H
+#define PS_MANAGEMENT_SETTLINGDETECTOR_H
+
+#include <QtGlobal>
+
+/**
+ * Convergence of a reading after a setpoint change: settled when the last samples stay within the tolerance of
+ * each other. The wait is as long as the DUT needs, instead of a fixed delay sized for the slowest one.
+ */
+class SettlingDetector {
+public:
+    SettlingDetector();
+    SettlingDetector(int samples, double tolerance);
+
+    void reset();
+    void add(double value);
+
+    bool isSettled() const;
+    bool isEmpty() const { return mCount == 0; }
+    double last() const { return mCount > 0 ? mWindow[(mCount - 1) % WindowSize] : 0; }
+
+private:
+    static constexpr int WindowSize = 16;
+
+    double mWindow[WindowSize] = {};
+    int    mCount = 0;
+    int    mSamples;
+    double mTolerance;
+};
+
+#endif //PS_MANAGEMENT_SETTLINGDETECTOR_H
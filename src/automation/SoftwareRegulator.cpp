@@ -0,0 +1,282 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SoftwareRegulator.h"
+#include "MonotonicClock.h"
+#include "protocol/Factory.h"
+
+#include <QFileInfo>
+#include <QSettings>
+#include <QtMath>
+
+#define REPORT_INTERVAL_MS 1000
+// the readings are asked again, when they don't come, e.g. dropped by a reply timeout.
+#define REQUEST_TIMEOUT_MS 500
+// below that the power and the resistance aren't defined.
+#define MIN_CURRENT 0.001
+// cycles with VSET pinned at a limit, after which the loop is taken for running away.
+#define RUNAWAY_CYCLES 25
+
+SoftwareRegulator::SoftwareRegulator(Communication *communication, QObject *parent)
+        : QObject(parent), mCommunication(communication), mReportTimer(this), mRequestTimer(this) {
+    mReportTimer.setInterval(REPORT_INTERVAL_MS);
+    connect(&mReportTimer, &QTimer::timeout, this, &SoftwareRegulator::Report);
+
+    mRequestTimer.setSingleShot(true);
+    mRequestTimer.setInterval(REQUEST_TIMEOUT_MS);
+    connect(&mRequestTimer, &QTimer::timeout, this, &SoftwareRegulator::RequestTimeout);
+
+    connect(mCommunication, &Communication::onSerialPortClosed, this, &SoftwareRegulator::Stop);
+    connect(mCommunication, &Communication::onProtectionTripped, this, &SoftwareRegulator::Stop);
+    connect(mCommunication, &Communication::onTelemetryFrame, this, &SoftwareRegulator::UpdateTelemetry);
+    connect(mCommunication, &Communication::onMeasurement, this, &SoftwareRegulator::Measurement,
+            Qt::DirectConnection);
+}
+
+bool SoftwareRegulator::loadOptions(const QString &fileName, SoftwareRegulator::Options &options, QString &error) {
+    if (!QFileInfo::exists(fileName)) {
+        error = QString("%1 doesn't exist").arg(fileName);
+        return false;
+    }
+
+    QSettings settings(fileName, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        error = QString("%1 isn't a valid INI file").arg(fileName);
+        return false;
+    }
+
+    options = Options();
+    QString mode = settings.value("loop/mode", "power").toString();
+    if (mode != "power" && mode != "resistance") {
+        error = "loop/mode: expected power or resistance";
+        return false;
+    }
+    options.mode = mode == "resistance" ? ConstantResistance : ConstantPower;
+
+    int channel = settings.value("loop/channel", 1).toInt();
+    if (channel != 1 && channel != 2) {
+        error = "loop/channel: expected 1 or 2";
+        return false;
+    }
+    options.channel = Global::Channel(channel);
+
+    options.target = settings.value("loop/target", options.target).toDouble();
+    options.currentLimit = settings.value("loop/current-limit", options.currentLimit).toDouble();
+    options.maxVoltage = settings.value("loop/max-voltage", options.maxVoltage).toDouble();
+    options.startVoltage = settings.value("loop/start-voltage", options.startVoltage).toDouble();
+    options.gains.kp = settings.value("pid/kp", options.gains.kp).toDouble();
+    options.gains.ki = settings.value("pid/ki", options.gains.ki).toDouble();
+    options.gains.kd = settings.value("pid/kd", options.gains.kd).toDouble();
+
+    if (options.target <= 0 || options.currentLimit <= 0 || options.maxVoltage <= 0) {
+        error = "loop: target, current-limit and max-voltage must be positive";
+        return false;
+    }
+    // at 0 V no current flows, VOUT - R * I is 0 and the loop would stay there.
+    if (options.mode == ConstantResistance && options.startVoltage <= 0) {
+        error = "loop/start-voltage: must be positive for resistance";
+        return false;
+    }
+    return true;
+}
+
+double SoftwareRegulator::voltageError(const SoftwareRegulator::Options &options, double voltage, double current) {
+    if (options.mode == ConstantPower) {
+        double targetVoltage = current > MIN_CURRENT ? options.target / current : options.maxVoltage;
+        return qMin(targetVoltage, options.maxVoltage) - voltage;
+    }
+    // V / I above R: the voltage goes up, which lowers V / I of a load that conducts better at a higher voltage.
+    return voltage - options.target * current;
+}
+
+double SoftwareRegulator::actualValue(SoftwareRegulator::Mode mode, double voltage, double current) {
+    if (mode == ConstantPower) {
+        return voltage * current;
+    }
+    return current > MIN_CURRENT ? voltage / current : 0;
+}
+
+QString SoftwareRegulator::describe(const SoftwareRegulator::Status &status) {
+    const char *unit = status.mode == ConstantPower ? "W" : "Ohm";
+    return QString("%1 %2 %3: %4 %3, VSET %5 V, %6 Hz, error rms %7 %3 (%8%), max %9 %3%10")
+            .arg(status.mode == ConstantPower ? "CP" : "CR").arg(status.target).arg(unit)
+            .arg(status.actual, 0, 'f', 3).arg(status.voltageSet, 0, 'f', 2).arg(status.loopRate, 0, 'f', 1)
+            .arg(status.rmsError, 0, 'f', 3).arg(status.relativeError, 0, 'f', 1).arg(status.maxError, 0, 'f', 3)
+            .arg(status.isCurrentLimited ? ", current limited" : "");
+}
+
+void SoftwareRegulator::Start(const QString &fileName, const Global::DeviceInfo &info) {
+    Stop();
+
+    QString error;
+    if (!loadOptions(fileName, mOptions, error)) {
+        emit onErrorOccurred(QString("%1: %2").arg(fileName, error));
+        return;
+    }
+    if (mOptions.channel == Global::Channel2 && info.ActiveChannelsCount < 2) {
+        emit onErrorOccurred(QString("%1: %2 has one channel").arg(fileName, info.Name));
+        return;
+    }
+    mProtocol.reset(Protocol::Factory::createByDeviceID(info.ID));
+    if (mProtocol.isNull()) {
+        emit onErrorOccurred(QString("%1: unknown device %2").arg(fileName, info.ID));
+        return;
+    }
+
+    mOptions.maxVoltage = qMin(mOptions.maxVoltage, info.MaxVoltage);
+    mOptions.currentLimit = qMin(mOptions.currentLimit, info.MaxCurrent);
+    mController = PidController(mOptions.gains, 0, mOptions.maxVoltage);
+    mController.reset(mOptions.startVoltage);
+
+    mStatus = Status();
+    mStatus.fileName = fileName;
+    mStatus.mode = mOptions.mode;
+    mStatus.target = mOptions.target;
+    mStatus.isRunning = true;
+    mIsCurrentLimited = false;
+    mPinnedCycles = 0;
+    mLastCommand.clear();
+
+    mIsRunning = true;
+    emit onStarted(fileName);
+
+    mCommunication->SetCurrent(mOptions.channel, mOptions.currentLimit);
+    mCommunication->SetVoltage(mOptions.channel, mController.output());
+    mCommunication->armProtection();
+    mCommunication->switchOutput(true);
+
+    mWriteTime = mLastStep = mPeriodStart = MonotonicClock::nsecs();
+    mPeriodCycles = 0;
+    mErrorSum = mErrorSquareSum = mMaxError = 0;
+    mReportTimer.start();
+    request();
+}
+
+void SoftwareRegulator::Stop() {
+    if (!mIsRunning) {
+        return;
+    }
+
+    mIsRunning = false;
+    mReportTimer.stop();
+    mRequestTimer.stop();
+    if (mCommunication->isDeviceReady()) {
+        mCommunication->switchOutput(false);
+    }
+
+    updateStatus();
+    mStatus.isRunning = false;
+    emit onFinished(mStatus);
+}
+
+void SoftwareRegulator::request() {
+    mCommunication->GetActualVoltage(mOptions.channel);
+    mCommunication->GetActualCurrent(mOptions.channel);
+    mRequestTimer.start();
+}
+
+void SoftwareRegulator::RequestTimeout() {
+    if (mIsRunning) {
+        request();
+    }
+}
+
+void SoftwareRegulator::UpdateTelemetry(const Global::TelemetryFrame &frame) {
+    if (mIsRunning && frame.IsStatusUpdated) {
+        auto mode = mOptions.channel == Global::Channel1 ? frame.Status.ModeCh1 : frame.Status.ModeCh2;
+        mIsCurrentLimited = frame.Status.OutputSwitch && mode == Global::ConstantCurrent;
+    }
+}
+
+void SoftwareRegulator::Measurement(Global::Channel channel, Global::TelemetryFrame::Field field, double value,
+                                    const Global::SampleTime &time) {
+    // only the readings queried after the last VSET show its effect.
+    if (!mIsRunning || channel != mOptions.channel || time.Sent < mWriteTime) {
+        return;
+    }
+
+    if (field == Global::TelemetryFrame::ActualVoltage) {
+        mVoltage = value;
+        mVoltageSent = time.Sent;
+    } else if (field == Global::TelemetryFrame::ActualCurrent) {
+        mCurrent = value;
+        mCurrentSent = time.Sent;
+    }
+
+    if (mVoltageSent >= mWriteTime && mCurrentSent >= mWriteTime) {
+        step(time.Arrived);
+    }
+}
+
+void SoftwareRegulator::step(qint64 now) {
+    double dt = (now - mLastStep) / 1e9;
+    mLastStep = now;
+    // a cycle takes a fresh pair of readings.
+    mVoltageSent = mCurrentSent = 0;
+
+    double voltageError = SoftwareRegulator::voltageError(mOptions, mVoltage, mCurrent);
+    double actual = actualValue(mOptions.mode, mVoltage, mCurrent);
+    double voltageSet = mController.update(voltageError, mVoltage, dt, mIsCurrentLimited);
+
+    // at the lower end VSET only approaches 0, it's pinned once no current flows.
+    bool isPinned = !mIsCurrentLimited && ((voltageSet >= mOptions.maxVoltage && voltageError >= 0) ||
+                                           ((voltageSet <= 0 || mCurrent <= MIN_CURRENT) && voltageError <= 0));
+    mPinnedCycles = isPinned ? mPinnedCycles + 1 : 0;
+    if (mPinnedCycles >= RUNAWAY_CYCLES) {
+        emit onErrorOccurred(QString("%1: VSET stays at %2 V, the load doesn't reach %3 %4")
+                                     .arg(mStatus.fileName).arg(voltageSet)
+                                     .arg(mOptions.target).arg(mOptions.mode == ConstantPower ? "W" : "Ohm"));
+        Stop();
+        return;
+    }
+
+    double error = actual - mOptions.target;
+    mErrorSum += error;
+    mErrorSquareSum += error * error;
+    mMaxError = qMax(mMaxError, qAbs(error));
+    mPeriodCycles++;
+    mStatus.cycles++;
+    mStatus.actual = actual;
+    mStatus.voltageSet = voltageSet;
+
+    // VSET is written only when it changes after the rounding of the device.
+    QScopedPointer<Protocol::IMessage> message(mProtocol->createMessageSetVoltage(mOptions.channel, voltageSet));
+    QByteArray command = message->query();
+    if (command != mLastCommand) {
+        mCommunication->WriteStreamed(mOptions.channel, DeviceShadow::VoltageSet, command);
+        mLastCommand = command;
+        mWriteTime = MonotonicClock::nsecs();
+    }
+    request();
+}
+
+void SoftwareRegulator::Report() {
+    updateStatus();
+    emit onStatus(mStatus);
+
+    mPeriodStart = MonotonicClock::nsecs();
+    mPeriodCycles = 0;
+    mErrorSum = mErrorSquareSum = mMaxError = 0;
+}
+
+void SoftwareRegulator::updateStatus() {
+    double period = (MonotonicClock::nsecs() - mPeriodStart) / 1e9;
+    mStatus.loopRate = period > 0 ? mPeriodCycles / period : 0;
+    if (mPeriodCycles > 0) {
+        mStatus.meanError = mErrorSum / mPeriodCycles;
+        mStatus.rmsError = qSqrt(mErrorSquareSum / mPeriodCycles);
+        mStatus.maxError = mMaxError;
+        mStatus.relativeError = mStatus.rmsError / mOptions.target * 100;
+    }
+    mStatus.isCurrentLimited = mIsCurrentLimited;
+}
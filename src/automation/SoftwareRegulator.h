@@ -0,0 +1,137 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_SOFTWAREREGULATOR_H
+#define PS_MANAGEMENT_SOFTWAREREGULATOR_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QTimer>
+#include "Communication.h"
+#include "PidController.h"
+#include "protocol/BaseSCPI.h"
+
+/**
+ * Constant power or constant resistance output, which the device doesn't have, emulated by a host side loop on the
+ * I/O thread: VOUT and IOUT of the channel are read, a PidController moves VSET, the next readings are requested
+ * right away. The loop runs as fast as the serial link answers.
+ *
+ * The error is expressed as a voltage for both modes, positive when VSET should go up, so the same gains fit both:
+ * P / I - VOUT for constant power and VOUT - R * I for constant resistance. CP converges on any load, whose current
+ * grows with the voltage. CR converges only on a load, whose resistance V / I falls as the voltage rises (LEDs,
+ * diodes, batteries); a plain resistor doesn't change V / I with VSET at all. When VSET stays pinned at the maximum
+ * voltage, or so low that no current flows, with the error pushing it there, the loop is stopped with an error. While the device reports the
+ * channel in CC mode (DeviceStatus), the current limit holds the output and the integrator is held.
+ *
+ * The loop frequency and the tracking error are reported every second. The loop is described by an INI file (see
+ * loadOptions) and runs until it's stopped, then the output is switched off.
+ */
+class SoftwareRegulator : public QObject {
+    Q_OBJECT
+public:
+    enum Mode {
+        ConstantPower,
+        ConstantResistance,
+    };
+
+    struct Options {
+        Mode                mode = ConstantPower;
+        Global::Channel     channel = Global::Channel1;
+        double              target = 1;         // W or Ohm
+        double              currentLimit = 1;   // A, ISET while the loop runs
+        double              maxVoltage = 5;     // V, VSET isn't moved above
+        double              startVoltage = 0;   // V
+        PidController::Gains gains;
+    };
+
+    struct Status {
+        QString fileName;
+        Mode    mode = ConstantPower;
+        double  target = 0;         // W or Ohm
+        double  actual = 0;         // W or Ohm, the last cycle
+        double  voltageSet = 0;     // V
+        double  loopRate = 0;       // Hz, over the last report period
+        double  meanError = 0;      // W or Ohm, actual - target, over the last report period
+        double  rmsError = 0;
+        double  maxError = 0;       // absolute
+        double  relativeError = 0;  // %, rms of the target
+        qint64  cycles = 0;         // since the start
+        bool    isCurrentLimited = false;
+        bool    isRunning = false;
+    };
+
+    explicit SoftwareRegulator(Communication *communication, QObject *parent = nullptr);
+
+    bool isRunning() const { return mIsRunning; }
+
+    static bool loadOptions(const QString &fileName, Options &options, QString &error);
+    static QString describe(const Status &status);
+
+    // the error of one cycle in volts, positive when VSET should go up.
+    static double voltageError(const Options &options, double voltage, double current);
+    // the power or the resistance of the readings.
+    static double actualValue(Mode mode, double voltage, double current);
+
+signals:
+    void onStarted(const QString &fileName);
+    void onStatus(const SoftwareRegulator::Status &status);
+    void onFinished(const SoftwareRegulator::Status &status);
+    void onErrorOccurred(QString error);
+
+public slots:
+    void Start(const QString &fileName, const Global::DeviceInfo &info);
+    void Stop();
+
+    void UpdateTelemetry(const Global::TelemetryFrame &frame);
+
+private slots:
+    void Measurement(Global::Channel channel, Global::TelemetryFrame::Field field, double value,
+                     const Global::SampleTime &time);
+    void Report();
+    void RequestTimeout();
+
+private:
+    void request();
+    void step(qint64 now);
+    void updateStatus();
+
+private:
+    Communication       *mCommunication;
+    QScopedPointer<Protocol::BaseSCPI> mProtocol;   // encodes VSET
+    Options             mOptions;
+    PidController       mController;
+    QTimer              mReportTimer;
+    QTimer              mRequestTimer;
+    bool                mIsRunning = false;
+
+    double              mVoltage = 0;
+    double              mCurrent = 0;
+    qint64              mVoltageSent = 0;   // ns, MonotonicClock
+    qint64              mCurrentSent = 0;
+    qint64              mWriteTime = 0;     // ns, MonotonicClock, the last VSET
+    qint64              mLastStep = 0;
+    QByteArray          mLastCommand;
+    bool                mIsCurrentLimited = false;
+    int                 mPinnedCycles = 0;  // in a row with VSET at a limit and the error pushing it there
+
+    qint64              mPeriodStart = 0;   // ns, MonotonicClock
+    qint64              mPeriodCycles = 0;
+    double              mErrorSum = 0;
+    double              mErrorSquareSum = 0;
+    double              mMaxError = 0;
+    Status              mStatus;
+};
+
+Q_DECLARE_METATYPE(SoftwareRegulator::Status)
+
+#endif //PS_MANAGEMENT_SOFTWAREREGULATOR_H
@@ -0,0 +1,375 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "SweepEngine.h"
+#include "MonotonicClock.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+#include <algorithm>
+
+#define FRONTIER_POINTS 3
+
+SweepEngine::SweepEngine(Communication *communication, QObject *parent)
+        : QObject(parent), mCommunication(communication), mSettleTimer(this) {
+    mSettleTimer.setSingleShot(true);
+    connect(&mSettleTimer, &QTimer::timeout, this, &SweepEngine::SettleTimeout);
+    connect(mCommunication, &Communication::onSerialPortClosed, this, &SweepEngine::Stop);
+    connect(mCommunication, &Communication::onProtectionTripped, this, &SweepEngine::Stop);
+    connect(mCommunication, &Communication::onTelemetryFrame, this, &SweepEngine::UpdateTelemetry);
+}
+
+bool SweepEngine::loadOptions(const QString &fileName, SweepEngine::Options &options, QString &error) {
+    if (!QFileInfo::exists(fileName)) {
+        error = QString("%1 doesn't exist").arg(fileName);
+        return false;
+    }
+
+    QSettings settings(fileName, QSettings::IniFormat);
+    if (settings.status() != QSettings::NoError) {
+        error = QString("%1 isn't a valid INI file").arg(fileName);
+        return false;
+    }
+
+    options = Options();
+    options.channels.clear();
+    for (const auto &channel : settings.value("sweep/channels", "1").toStringList()) {
+        if (channel.trimmed() == "1") {
+            options.channels.append(Global::Channel1);
+        } else if (channel.trimmed() == "2") {
+            options.channels.append(Global::Channel2);
+        } else {
+            error = QString("sweep/channels: unknown channel %1").arg(channel);
+            return false;
+        }
+    }
+
+    QString quantity = settings.value("sweep/quantity", "voltage").toString();
+    if (quantity != "voltage" && quantity != "current") {
+        error = QString("sweep/quantity: expected voltage or current");
+        return false;
+    }
+    options.quantity = quantity == "current" ? Current : Voltage;
+
+    options.from = settings.value("sweep/from", options.from).toDouble();
+    options.to = settings.value("sweep/to", options.to).toDouble();
+    options.step = settings.value("sweep/step", options.step).toDouble();
+    options.minStep = settings.value("sweep/min-step", qMin(options.minStep, options.step)).toDouble();
+    options.maxStep = settings.value("sweep/max-step", qMax(options.maxStep, options.step)).toDouble();
+    options.limit = settings.value("sweep/limit", options.limit).toDouble();
+    options.bendThreshold = settings.value("sweep/bend-threshold", options.bendThreshold).toDouble();
+    options.settleSamples = settings.value("settling/samples", options.settleSamples).toInt();
+    options.voltageTolerance = settings.value("settling/voltage-tolerance", options.voltageTolerance).toDouble();
+    options.currentTolerance = settings.value("settling/current-tolerance", options.currentTolerance).toDouble();
+    options.settleTimeout = settings.value("settling/timeout-ms", options.settleTimeout).toInt();
+
+    if (options.step <= 0 || options.minStep <= 0 || options.minStep > options.step || options.maxStep < options.step) {
+        error = "sweep: expected 0 < min-step <= step <= max-step";
+        return false;
+    }
+    return true;
+}
+
+QString SweepEngine::describe(const SweepEngine::Result &result) {
+    return QString("%1 %2 after %3 s: %4 points (%5 refined, %6 unsettled, %7 without readings), settling mean %8 ms, "
+                   "table %9")
+            .arg(result.fileName, result.isCompleted ? "completed" : "stopped")
+            .arg(result.elapsed, 0, 'f', 1).arg(result.points.size()).arg(result.refinedCount)
+            .arg(result.unsettledCount).arg(result.missingCount).arg(result.meanSettleTime, 0, 'f', 0)
+            .arg(result.tableFileName.isEmpty() ? "not written" : result.tableFileName);
+}
+
+bool SweepEngine::validate(const Global::DeviceInfo &info, QString &error) const {
+    for (auto channel : mOptions.channels) {
+        if (channel == Global::Channel2 && info.ActiveChannelsCount < 2) {
+            error = QString("%1 has one channel").arg(info.Name);
+            return false;
+        }
+    }
+
+    bool isVoltage = mOptions.quantity == Voltage;
+    double maxSet = isVoltage ? info.MaxVoltage : info.MaxCurrent;
+    double maxLimit = isVoltage ? info.MaxCurrent : info.MaxVoltage;
+    if (mOptions.from < 0 || mOptions.to < 0 || qMax(mOptions.from, mOptions.to) > maxSet) {
+        error = QString("the sweep range is outside 0..%1").arg(maxSet);
+        return false;
+    }
+    if (mOptions.limit <= 0 || mOptions.limit > maxLimit) {
+        error = QString("the limit is outside 0..%1").arg(maxLimit);
+        return false;
+    }
+    return true;
+}
+
+void SweepEngine::Start(const QString &fileName, const Global::DeviceInfo &info) {
+    Stop();
+
+    QString error;
+    if (!loadOptions(fileName, mOptions, error) || !validate(info, error)) {
+        emit onErrorOccurred(QString("%1: %2").arg(fileName, error));
+        return;
+    }
+
+    mResult = Result();
+    mResult.fileName = fileName;
+    for (auto &state : mChannels) {
+        state.voltage = SettlingDetector(mOptions.settleSamples, mOptions.voltageTolerance);
+        state.current = SettlingDetector(mOptions.settleSamples, mOptions.currentTolerance);
+        state.frontier.clear();
+    }
+    mPending.clear();
+    mStep = mOptions.to >= mOptions.from ? mOptions.step : -mOptions.step;
+
+    mIsRunning = true;
+    mStartTime = MonotonicClock::nsecs();
+    emit onStarted(fileName);
+
+    for (auto channel : qAsConst(mOptions.channels)) {
+        if (mOptions.quantity == Voltage) {
+            mCommunication->SetCurrent(channel, mOptions.limit);
+        } else {
+            mCommunication->SetVoltage(channel, mOptions.limit);
+        }
+    }
+    apply(mOptions.from, false);
+    mCommunication->armProtection();
+    mCommunication->switchOutput(true);
+}
+
+void SweepEngine::Stop() {
+    if (mIsRunning) {
+        finish(false);
+    }
+}
+
+void SweepEngine::apply(double set, bool refined) {
+    mSet = set;
+    mIsRefined = refined;
+    if (!refined) {
+        mFrontier = set;
+    }
+
+    for (auto channel : qAsConst(mOptions.channels)) {
+        if (mOptions.quantity == Voltage) {
+            mCommunication->SetVoltage(channel, set);
+        } else {
+            mCommunication->SetCurrent(channel, set);
+        }
+        state(channel).voltage.reset();
+        state(channel).current.reset();
+    }
+    // the queries sent after this moment are written after the set commands, see Communication::enqueueMessage.
+    mSetTime = MonotonicClock::nsecs();
+    mSettleTimer.start(mOptions.settleTimeout);
+    requestReadings();
+}
+
+void SweepEngine::requestReadings() {
+    mRequestTime = MonotonicClock::nsecs();
+    for (auto channel : qAsConst(mOptions.channels)) {
+        state(channel).hasVoltage = state(channel).hasCurrent = false;
+        mCommunication->GetActualVoltage(channel);
+        mCommunication->GetActualCurrent(channel);
+    }
+}
+
+void SweepEngine::UpdateTelemetry(const Global::TelemetryFrame &frame) {
+    if (!mIsRunning) {
+        return;
+    }
+
+    bool isUpdated = false;
+    bool isSettled = true;
+    bool isRoundComplete = true;
+    for (auto channel : qAsConst(mOptions.channels)) {
+        const auto &values = frame.channel(channel);
+        auto &channelState = state(channel);
+        if (frame.isUpdated(Global::TelemetryFrame::ActualVoltage, channel)) {
+            qint64 sent = values.Time[Global::TelemetryFrame::ActualVoltage].Sent;
+            if (sent > mSetTime) {
+                channelState.voltage.add(values.ActualVoltage);
+                isUpdated = true;
+            }
+            channelState.hasVoltage = channelState.hasVoltage || sent >= mRequestTime;
+        }
+        if (frame.isUpdated(Global::TelemetryFrame::ActualCurrent, channel)) {
+            qint64 sent = values.Time[Global::TelemetryFrame::ActualCurrent].Sent;
+            if (sent > mSetTime) {
+                channelState.current.add(values.ActualCurrent);
+                isUpdated = true;
+            }
+            channelState.hasCurrent = channelState.hasCurrent || sent >= mRequestTime;
+        }
+        isSettled = isSettled && channelState.voltage.isSettled() && channelState.current.isSettled();
+        isRoundComplete = isRoundComplete && channelState.hasVoltage && channelState.hasCurrent;
+    }
+
+    if (isSettled) {
+        record(true);
+    } else if (isUpdated && isRoundComplete) {
+        // one round of readings in flight, the link is shared with the polling: the readings of the polling count,
+        // but don't add rounds of their own.
+        requestReadings();
+    }
+}
+
+void SweepEngine::SettleTimeout() {
+    record(false);
+}
+
+void SweepEngine::record(bool settled) {
+    mSettleTimer.stop();
+    double settleTime = MonotonicClock::msecsSince(mSetTime);
+
+    double maxBend = 0;
+    for (auto channel : qAsConst(mOptions.channels)) {
+        auto &channelState = state(channel);
+        // no reading arrived before the timeout: a row from the empty detectors would read 0 V / 0 A.
+        if (channelState.voltage.isEmpty() || channelState.current.isEmpty()) {
+            mResult.missingCount++;
+            continue;
+        }
+
+        Point point;
+        point.channel = channel;
+        point.set = mSet;
+        point.voltage = channelState.voltage.last();
+        point.current = channelState.current.last();
+        point.settleTime = settleTime;
+        point.isSettled = settled;
+        point.isRefined = mIsRefined;
+        mResult.points.append(point);
+        mResult.unsettledCount += settled ? 0 : 1;
+        mResult.refinedCount += mIsRefined ? 1 : 0;
+
+        if (!mIsRefined) {
+            channelState.frontier.append(point);
+            if (channelState.frontier.size() > FRONTIER_POINTS) {
+                channelState.frontier.removeFirst();
+            }
+            maxBend = qMax(maxBend, bend(channelState.frontier));
+        }
+    }
+
+    // the step follows the curve: finer where it bends, coarser along a straight part.
+    if (!mIsRefined) {
+        double step = qAbs(mStep);
+        if (maxBend > mOptions.bendThreshold) {
+            const auto &frontier = state(mOptions.channels.first()).frontier;
+            // the first channel may have missed this set point, then there's no segment to split.
+            bool hasSegment = frontier.size() >= 2 && frontier.last().set == mSet;
+            double previous = hasSegment ? frontier.at(frontier.size() - 2).set : mSet;
+            if (hasSegment && qAbs(mSet - previous) >= 2 * mOptions.minStep) {
+                mPending.append((previous + mSet) / 2);
+            }
+            step = qMax(mOptions.minStep, step / 2);
+        } else if (maxBend < mOptions.bendThreshold / 4) {
+            step = qMin(mOptions.maxStep, step * 1.5);
+        }
+        mStep = mStep < 0 ? -step : step;
+    }
+
+    if (!next()) {
+        finish(true);
+    }
+}
+
+bool SweepEngine::next() {
+    if (!mPending.isEmpty()) {
+        apply(mPending.takeFirst(), true);
+        return true;
+    }
+
+    bool isAscending = mOptions.to >= mOptions.from;
+    if (isAscending ? mFrontier >= mOptions.to : mFrontier <= mOptions.to) {
+        return false;
+    }
+    double set = mFrontier + mStep;
+    apply(isAscending ? qMin(set, mOptions.to) : qMax(set, mOptions.to), false);
+    return true;
+}
+
+double SweepEngine::response(const SweepEngine::Point &point) const {
+    return mOptions.quantity == Voltage ? point.current : point.voltage;
+}
+
+/**
+ * Relative change of the slope over the last two segments. Slopes below the reading tolerance don't count, so the
+ * noise of a flat part isn't taken for a bend.
+ */
+double SweepEngine::bend(const QVector<Point> &frontier) const {
+    if (frontier.size() < FRONTIER_POINTS) {
+        return 0;
+    }
+
+    const auto &p0 = frontier.at(0), &p1 = frontier.at(1), &p2 = frontier.at(2);
+    double dx1 = p1.set - p0.set, dx2 = p2.set - p1.set;
+    if (dx1 == 0 || dx2 == 0) {
+        return 0;
+    }
+    double s1 = (response(p1) - response(p0)) / dx1;
+    double s2 = (response(p2) - response(p1)) / dx2;
+    double tolerance = mOptions.quantity == Voltage ? mOptions.currentTolerance : mOptions.voltageTolerance;
+    double floor = tolerance / qMin(qAbs(dx1), qAbs(dx2));
+    return qAbs(s2 - s1) / qMax(floor, qMax(qAbs(s1), qAbs(s2)));
+}
+
+bool SweepEngine::writeTable() {
+    QFileInfo info(mResult.fileName);
+    QString fileName = QString("%1/%2-%3.csv").arg(info.absolutePath(), info.completeBaseName(),
+                                                  QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        emit onErrorOccurred(QString("%1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+
+    auto points = mResult.points;
+    std::stable_sort(points.begin(), points.end(), [] (const Point &a, const Point &b) {
+        return a.channel != b.channel ? a.channel < b.channel : a.set < b.set;
+    });
+
+    QTextStream out(&file);
+    out << "channel,set,voltage,current,power,settle_ms,settled,refined\n";
+    for (const auto &point : qAsConst(points)) {
+        out << int(point.channel) << ',' << point.set << ',' << point.voltage << ',' << point.current << ','
+            << point.voltage * point.current << ',' << qRound(point.settleTime) << ',' << int(point.isSettled) << ','
+            << int(point.isRefined) << '\n';
+    }
+    mResult.tableFileName = fileName;
+    return true;
+}
+
+void SweepEngine::finish(bool completed) {
+    mSettleTimer.stop();
+    mIsRunning = false;
+    mPending.clear();
+    if (mCommunication->isDeviceReady()) {
+        mCommunication->switchOutput(false);
+    }
+
+    double settleTime = 0;
+    for (const auto &point : qAsConst(mResult.points)) {
+        settleTime += point.settleTime;
+    }
+    mResult.meanSettleTime = mResult.points.isEmpty() ? 0 : settleTime / mResult.points.size();
+    mResult.elapsed = MonotonicClock::msecsSince(mStartTime) / 1e3;
+    mResult.isCompleted = completed;
+    if (!mResult.points.isEmpty()) {
+        writeTable();
+    }
+    emit onFinished(mResult);
+}
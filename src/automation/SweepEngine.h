@@ -0,0 +1,141 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_SWEEPENGINE_H
+#define PS_MANAGEMENT_SWEEPENGINE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+#include "Communication.h"
+#include "SettlingDetector.h"
+
+/**
+ * I-V characterization of a DUT, on the I/O thread: steps VSET (or ISET) of one or both channels across a range and
+ * records the settled VOUT and IOUT of every point.
+ *
+ * A point is recorded when the readings converge (SettlingDetector), or unsettled after the settle timeout. The step
+ * follows the curve: where the slope of the response changes more than the bend threshold, the midpoint of the last
+ * segment is measured as well and the step is halved down to the minimum; along a straight part it grows up to
+ * the maximum.
+ *
+ * The sweep is described by an INI file (see loadOptions), the table is written next to it as CSV.
+ * The output is switched on for the sweep and off after it.
+ */
+class SweepEngine : public QObject {
+    Q_OBJECT
+public:
+    enum Quantity {
+        Voltage,
+        Current,
+    };
+
+    struct Options {
+        QVector<Global::Channel> channels = {Global::Channel1};
+        Quantity quantity = Voltage;    // the swept set value
+        double   from = 0;
+        double   to = 1;
+        double   step = 0.1;
+        double   minStep = 0.01;
+        double   maxStep = 0.5;
+        double   limit = 0.1;           // the other set value, e.g. the current limit of a voltage sweep
+        double   bendThreshold = 0.25;  // relative change of the slope, which refines the step
+        double   voltageTolerance = 0.01;   // V
+        double   currentTolerance = 0.002;  // A
+        int      settleSamples = 3;
+        int      settleTimeout = 3000;  // ms
+    };
+
+    struct Point {
+        Global::Channel channel = Global::Channel1;
+        double          set = 0;
+        double          voltage = 0;
+        double          current = 0;
+        double          settleTime = 0; // ms
+        bool            isSettled = false;
+        bool            isRefined = false;  // a midpoint added where the curve bends
+    };
+
+    struct Result {
+        QString        fileName;
+        QString        tableFileName;
+        QVector<Point> points;
+        int            refinedCount = 0;
+        int            unsettledCount = 0;
+        int            missingCount = 0;   // set points without a reading before the timeout, not in the table
+        double         meanSettleTime = 0; // ms
+        double         elapsed = 0;        // s
+        bool           isCompleted = false;
+    };
+
+    explicit SweepEngine(Communication *communication, QObject *parent = nullptr);
+
+    bool isRunning() const { return mIsRunning; }
+
+    static bool loadOptions(const QString &fileName, Options &options, QString &error);
+    static QString describe(const Result &result);
+
+signals:
+    void onStarted(const QString &fileName);
+    void onFinished(const SweepEngine::Result &result);
+    void onErrorOccurred(QString error);
+
+public slots:
+    void Start(const QString &fileName, const Global::DeviceInfo &info);
+    void Stop();
+
+    void UpdateTelemetry(const Global::TelemetryFrame &frame);
+
+private slots:
+    void SettleTimeout();
+
+private:
+    struct ChannelState {
+        SettlingDetector voltage;
+        SettlingDetector current;
+        QVector<Point>   frontier;      // the last points of the frontier, for the bend
+        bool             hasVoltage = false;  // a reading since mRequestTime
+        bool             hasCurrent = false;
+    };
+
+    bool validate(const Global::DeviceInfo &info, QString &error) const;
+    void apply(double set, bool refined);
+    void requestReadings();
+    void record(bool settled);
+    bool next();
+    double response(const Point &point) const;
+    double bend(const QVector<Point> &frontier) const;
+    ChannelState &state(Global::Channel channel) { return mChannels[channel == Global::Channel1 ? 0 : 1]; }
+    bool writeTable();
+    void finish(bool completed);
+
+private:
+    Communication   *mCommunication;
+    Options         mOptions;
+    QTimer          mSettleTimer;
+    ChannelState    mChannels[2];
+    bool            mIsRunning = false;
+    qint64          mStartTime = 0;     // ns, MonotonicClock
+    qint64          mSetTime = 0;       // ns, MonotonicClock, the set commands of the current point
+    qint64          mRequestTime = 0;   // ns, MonotonicClock, the round of readings in flight
+    double          mSet = 0;
+    bool            mIsRefined = false;
+    double          mStep = 0;
+    double          mFrontier = 0;      // the furthest set value measured
+    QVector<double> mPending;           // midpoints waiting to be measured
+    Result          mResult;
+};
+
+Q_DECLARE_METATYPE(SweepEngine::Result)
+
+#endif //PS_MANAGEMENT_SWEEPENGINE_H
@@ -0,0 +1,124 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CliSession.h"
+#include "protocol/Factory.h"
+
+#include <QDeadlineTimer>
+#include <QScopedPointer>
+#include <QThread>
+
+// The same pause Communication keeps after a command without reply.
+#define DELAY_BETWEEN_REQUESTS_MS 60
+
+CliSession::CliSession(const Options &options) : mOptions(options) {
+    mSerialPort.setDataBits(QSerialPort::Data8);
+    mSerialPort.setParity(QSerialPort::NoParity);
+    mSerialPort.setStopBits(QSerialPort::OneStop);
+    mSerialPort.setFlowControl(QSerialPort::NoFlowControl);
+    mClock.start();
+}
+
+CliSession::~CliSession() {
+    if (mSerialPort.isOpen()) {
+        mSerialPort.waitForBytesWritten(mOptions.timeout);
+        mSerialPort.close();
+    }
+    delete mProtocol;
+}
+
+bool CliSession::open() {
+    mSerialPort.setPortName(mOptions.portName);
+    mSerialPort.setBaudRate(mOptions.baudRate);
+    if (!mSerialPort.open(QIODevice::ReadWrite)) {
+        mErrorString = mSerialPort.errorString();
+        return false;
+    }
+    mSerialPort.clear();
+
+    if (mOptions.useCache) {
+        mCacheKey = Protocol::DeviceProfileCache::key(mOptions.portName);
+        mProtocol = Protocol::Factory::createByDeviceID(mCache.deviceID(mCacheKey));
+        mIsProfileCached = mProtocol != nullptr;
+        if (mIsProfileCached) {
+            return true;
+        }
+    }
+
+    return identify();
+}
+
+bool CliSession::identify() {
+    delete mProtocol;
+    mIsProfileCached = false;
+
+    Protocol::Factory factory(mSerialPort);
+    mProtocol = factory.createInstance();
+    if (mProtocol == nullptr) {
+        mErrorString = factory.errorString();
+        return false;
+    }
+
+    if (mOptions.useCache) {
+        mCache.store(mCacheKey, factory.deviceID());
+    }
+    return true;
+}
+
+bool CliSession::execute(Protocol::IMessage *pMessage, QByteArray *reply) {
+    QScopedPointer<Protocol::IMessage> message(pMessage);
+    if (transact(*message, reply)) {
+        return true;
+    }
+
+    // the cached profile may belong to another device plugged into the port, though the key has its USB serial number.
+    if (mIsProfileCached) {
+        mCache.remove(mCacheKey);
+        mSerialPort.clear();
+        return identify() && transact(*message, reply);
+    }
+    return false;
+}
+
+bool CliSession::transact(const Protocol::IMessage &message, QByteArray *reply) {
+    qint64 wait = mNextWriteAt - mClock.elapsed();
+    if (wait > 0) {
+        QThread::msleep(wait);
+    }
+
+    mSerialPort.write(message.query());
+    if (!mSerialPort.waitForBytesWritten(mOptions.timeout)) {
+        mErrorString = QObject::tr("Write timeout");
+        return false;
+    }
+
+    if (!message.isCommandWithReply()) {
+        mNextWriteAt = mClock.elapsed() + DELAY_BETWEEN_REQUESTS_MS;
+        return true;
+    }
+
+    QByteArray data;
+    QDeadlineTimer deadline(mOptions.timeout);
+    while (data.size() < message.replySize()) {
+        if (mSerialPort.bytesAvailable() == 0 && !mSerialPort.waitForReadyRead(int(deadline.remainingTime()))) {
+            mErrorString = QObject::tr("Reply timeout");
+            return false;
+        }
+        data += mSerialPort.read(message.replySize() - data.size());
+    }
+
+    if (reply != nullptr) {
+        *reply = data;
+    }
+    return true;
+}
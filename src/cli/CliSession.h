@@ -0,0 +1,63 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_CLISESSION_H
+#define PS_MANAGEMENT_CLISESSION_H
+
+#include <QSerialPort>
+#include <QElapsedTimer>
+#include "protocol/BaseSCPI.h"
+#include "protocol/DeviceProfileCache.h"
+
+/**
+ * Synchronous device access for psm-cli: no event loop, no message queue, no polling. The protocol is taken from
+ * the cached device profile when there is one; if a query or a command then fails, the device is identified and it
+ * is retried once.
+ */
+class CliSession {
+public:
+    struct Options {
+        QString portName;
+        int     baudRate = 9600;
+        bool    useCache = true;
+        int     timeout = 200; // ms, per transaction
+    };
+
+    explicit CliSession(const Options &options);
+    ~CliSession();
+
+    bool open();
+    // takes the ownership of the message.
+    bool execute(Protocol::IMessage *pMessage, QByteArray *reply = nullptr);
+
+    Protocol::BaseSCPI *protocol() const { return mProtocol; }
+    bool isProfileCached() const { return mIsProfileCached; }
+    QString errorString() const { return mErrorString; }
+
+private:
+    bool identify();
+    bool transact(const Protocol::IMessage &message, QByteArray *reply);
+
+private:
+    Options                         mOptions;
+    QSerialPort                     mSerialPort;
+    Protocol::BaseSCPI              *mProtocol = nullptr;
+    Protocol::DeviceProfileCache    mCache;
+    QString                         mCacheKey;
+    bool                            mIsProfileCached = false;
+    QString                         mErrorString;
+    QElapsedTimer                   mClock;
+    qint64                          mNextWriteAt = 0; // ms, mClock, the device is busy with the previous command
+};
+
+#endif //PS_MANAGEMENT_CLISESSION_H
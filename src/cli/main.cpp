@@ -0,0 +1,236 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CliSession.h"
+#include "Settings.h"
+#include <config.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#define EXIT_USAGE 1
+#define EXIT_DEVICE_ERROR 2
+
+static QTextStream &out() {
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+static QTextStream &err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+static int fail(int code, const QString &message) {
+    err() << "psm-cli: " << message << Qt::endl;
+    return code;
+}
+
+static QList<Global::Channel> selectedChannels(const QCommandLineParser &parser, const Protocol::BaseSCPI *protocol,
+                                               bool *ok) {
+    *ok = true;
+    if (!parser.isSet("ch")) {
+        QList<Global::Channel> channels{Global::Channel1};
+        if (protocol->activeChannelsCount() > 1) {
+            channels << Global::Channel2;
+        }
+        return channels;
+    }
+
+    int channel = parser.value("ch").toInt(ok);
+    *ok = *ok && channel >= 1 && channel <= protocol->activeChannelsCount();
+    return {Global::Channel(channel)};
+}
+
+static bool query(CliSession &session, Protocol::IMessage *pMessage, double *value) {
+    QByteArray reply;
+    if (!session.execute(pMessage, &reply)) {
+        return false;
+    }
+    *value = reply.toDouble();
+    return true;
+}
+
+static int set(CliSession &session, const QCommandLineParser &parser) {
+    auto protocol = session.protocol();
+    bool ok;
+    auto channels = selectedChannels(parser, protocol, &ok);
+    if (!ok || (channels.size() > 1 && (parser.isSet("volt") || parser.isSet("curr")))) {
+        return fail(EXIT_USAGE, "set: --ch 1.." + QString::number(protocol->activeChannelsCount()) + " is required");
+    }
+
+    QList<Protocol::IMessage*> messages;
+    if (parser.isSet("volt")) {
+        double voltage = parser.value("volt").toDouble(&ok);
+        if (!ok || voltage < protocol->minChannelVoltage() || voltage > protocol->maxChannelVoltage()) {
+            return fail(EXIT_USAGE, QString("set: --volt must be %1..%2 V")
+                    .arg(protocol->minChannelVoltage()).arg(protocol->maxChannelVoltage()));
+        }
+        messages << protocol->createMessageSetVoltage(channels.first(), voltage);
+    }
+    if (parser.isSet("curr")) {
+        double current = parser.value("curr").toDouble(&ok);
+        if (!ok || current < protocol->minChannelCurrent() || current > protocol->maxChannelCurrent()) {
+            qDeleteAll(messages);
+            return fail(EXIT_USAGE, QString("set: --curr must be %1..%2 A")
+                    .arg(protocol->minChannelCurrent()).arg(protocol->maxChannelCurrent()));
+        }
+        messages << protocol->createMessageSetCurrent(channels.first(), current);
+    }
+    if (parser.isSet("out")) {
+        QString state = parser.value("out").toLower();
+        if (state != "on" && state != "off") {
+            qDeleteAll(messages);
+            return fail(EXIT_USAGE, "set: --out must be on or off");
+        }
+        // the output is switched last, after the new set values.
+        messages << protocol->createMessageSetEnableOutputSwitch(state == "on");
+    }
+    if (messages.isEmpty()) {
+        return fail(EXIT_USAGE, "set: nothing to set, use --volt, --curr or --out");
+    }
+
+    while (!messages.isEmpty()) {
+        if (!session.execute(messages.takeFirst())) {
+            qDeleteAll(messages);
+            return fail(EXIT_DEVICE_ERROR, session.errorString());
+        }
+    }
+    return 0;
+}
+
+static int read(CliSession &session, const QCommandLineParser &parser) {
+    auto protocol = session.protocol();
+    bool ok;
+    auto channels = selectedChannels(parser, protocol, &ok);
+    if (!ok) {
+        return fail(EXIT_USAGE, "read: --ch must be 1.." + QString::number(protocol->activeChannelsCount()));
+    }
+    bool all = parser.isSet("all");
+
+    QJsonObject values;
+    if (all) {
+        QByteArray reply;
+        if (!session.execute(protocol->createMessageGetDeviceStatus(), &reply) || reply.isEmpty()) {
+            return fail(EXIT_DEVICE_ERROR, session.errorString());
+        }
+        auto status = session.protocol()->processDeviceStatusReply(reply);
+        values["output"] = status.OutputSwitch ? "on" : "off";
+        values["tracking"] = status.Tracking == Global::Serial ? "serial"
+                           : status.Tracking == Global::Parallel ? "parallel" : "independent";
+        values["ch1.mode"] = status.ModeCh1 == Global::ConstantVoltage ? "CV" : "CC";
+        values["ch2.mode"] = status.ModeCh2 == Global::ConstantVoltage ? "CV" : "CC";
+    }
+
+    for (auto channel : channels) {
+        // a failed query with a cached profile identifies the device again and replaces the protocol.
+        protocol = session.protocol();
+        QString prefix = QString("ch%1.").arg(channel);
+        QList<QPair<QString, Protocol::IMessage*>> queries{
+                {"vout", protocol->createMessageGetActualVoltage(channel)},
+                {"iout", protocol->createMessageGetActualCurrent(channel)},
+        };
+        if (all) {
+            queries << qMakePair(QString("vset"), protocol->createMessageGetVoltageSet(channel))
+                    << qMakePair(QString("iset"), protocol->createMessageGetCurrentSet(channel))
+                    << qMakePair(QString("ovp"), protocol->createMessageGetOverVoltageProtectionValue(channel))
+                    << qMakePair(QString("ocp"), protocol->createMessageGetOverCurrentProtectionValue(channel));
+        }
+
+        for (int i = 0; i < queries.size(); ++i) {
+            double value;
+            if (!query(session, queries.at(i).second, &value)) {
+                for (int j = i + 1; j < queries.size(); ++j) {
+                    delete queries.at(j).second;
+                }
+                return fail(EXIT_DEVICE_ERROR, session.errorString());
+            }
+            values[prefix + queries.at(i).first] = value;
+        }
+    }
+
+    if (parser.isSet("json")) {
+        out() << QJsonDocument(values).toJson(QJsonDocument::Compact) << Qt::endl;
+    } else {
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            out() << it.key() << "=" << it.value().toVariant().toString() << Qt::endl;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // the same names as the GUI, so the last used serial port is the default.
+    QCoreApplication::setOrganizationName("vitark");
+    QCoreApplication::setApplicationName("power-supply-management");
+    QCoreApplication::setApplicationVersion(QString("%1.%2.%3").arg(VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH));
+
+    QCoreApplication app(argc, argv);
+    QElapsedTimer clock;
+    clock.start();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("One-shot commands for a PS-Management supported power supply.\n\n"
+                                     "  psm-cli set --ch 1 --volt 5.0 --curr 0.5 --out on\n"
+                                     "  psm-cli read --all");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "set or read");
+    parser.addOptions({
+            {{"p", "port"}, "Serial port, the last one used by the GUI by default.", "name"},
+            {{"b", "baud"}, "Baud rate.", "rate"},
+            {"no-cache", "Always identify the device, don't use the cached device profile."},
+            {"ch", "Channel.", "n"},
+            {"volt", "set: voltage, V.", "value"},
+            {"curr", "set: current, A.", "value"},
+            {"out", "set: output on or off.", "state"},
+            {"all", "read: status, set values and protection values as well."},
+            {"json", "read: print one JSON object."},
+            {"timing", "Print the connection and total time to stderr."},
+    });
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1 || (args.first() != "set" && args.first() != "read")) {
+        parser.showHelp(EXIT_USAGE);
+    }
+
+    Settings settings;
+    CliSession::Options options;
+    options.portName = parser.isSet("port") ? parser.value("port") : settings.serialPortName();
+    options.baudRate = parser.isSet("baud") ? parser.value("baud").toInt() : settings.serialPortBaudRate();
+    options.useCache = !parser.isSet("no-cache");
+    if (options.portName.isEmpty()) {
+        return fail(EXIT_USAGE, "no serial port, use --port");
+    }
+
+    CliSession session(options);
+    if (!session.open()) {
+        return fail(EXIT_DEVICE_ERROR, QString("%1: %2").arg(options.portName, session.errorString()));
+    }
+    qint64 openTime = clock.elapsed();
+
+    int result = args.first() == "set" ? set(session, parser) : read(session, parser);
+
+    if (parser.isSet("timing")) {
+        err() << QString("open %1 ms (%2), total %3 ms")
+                .arg(openTime)
+                .arg(session.isProfileCached() ? "cached profile" : "identified")
+                .arg(clock.elapsed()) << Qt::endl;
+    }
+    return result;
+}
@@ -0,0 +1,204 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Daemon.h"
+#include <QDebug>
+
+#define DEFAULT_RECONNECT_INTERVAL_S 5
+
+Daemon::Daemon(const QString &configFile, QObject *parent) : QObject(parent),
+        mSettings(configFile), mCommunication(this), mPoller(&mCommunication, this), mTelemetryLogger(this),
+        mTelemetryStream(this), mSequencer(&mCommunication, this),
+        mListPlayer(&mCommunication, this), mSweepEngine(&mCommunication, this),
+        mRegulator(&mCommunication, this), mChargeEngine(&mCommunication, this), mReconnectTimer(this) {
+    auto protectionRules = mSettings.protectionRules();
+    mCommunication.setProtectionRules(protectionRules);
+    mCommunication.setWatchdogOptions(mSettings.watchdogOptions());
+    mPoller.setRateControllerOptions(mSettings.pollRateControllerOptions());
+    // nothing is shown, but the protection rules still need their measurements, see Poller.
+    mPoller.setProtectionRules(protectionRules);
+    mPoller.SetVisible(false);
+
+    mReconnectTimer.setSingleShot(true);
+    mReconnectTimer.setTimerType(Qt::VeryCoarseTimer);
+    connect(&mReconnectTimer, &QTimer::timeout, this, &Daemon::Connect);
+
+    connect(&mCommunication, &Communication::onDeviceReady, this, &Daemon::DeviceReady);
+    connect(&mCommunication, &Communication::onSerialPortClosed, this, &Daemon::SerialPortClosed);
+    connect(&mCommunication, &Communication::onSerialPortErrorOccurred, this, &Daemon::SerialPortErrorOccurred);
+    connect(&mCommunication, &Communication::onUnknownDevice, this, &Daemon::UnknownDevice);
+    connect(&mCommunication, &Communication::onProtectionTripped, this, &Daemon::ProtectionTripped);
+    connect(&mCommunication, &Communication::onMetricsReady, &mPoller, &Poller::UpdateMetrics);
+    connect(&mCommunication, &Communication::onTelemetryFrame, &mPoller, &Poller::UpdateTelemetry);
+    connect(&mCommunication, &Communication::onTelemetryFrame, &mTelemetryLogger, &TelemetryLogger::UpdateTelemetry);
+    connect(&mTelemetryLogger, &TelemetryLogger::onErrorOccurred, this, &Daemon::TelemetryLogErrorOccurred);
+    connect(&mCommunication, &Communication::onTelemetryFrame, &mTelemetryStream, &TelemetryStream::UpdateTelemetry);
+    connect(&mTelemetryStream, &TelemetryStream::onErrorOccurred, this, &Daemon::TelemetryStreamErrorOccurred);
+    connect(&mSequencer, &Sequencer::onFinished, this, &Daemon::SequenceFinished);
+    connect(&mSequencer, &Sequencer::onErrorOccurred, this, &Daemon::SequenceErrorOccurred);
+    connect(&mListPlayer, &ListPlayer::onFinished, this, &Daemon::ListFinished);
+    connect(&mListPlayer, &ListPlayer::onErrorOccurred, this, &Daemon::SequenceErrorOccurred);
+    connect(&mSweepEngine, &SweepEngine::onFinished, this, &Daemon::SweepFinished);
+    connect(&mSweepEngine, &SweepEngine::onErrorOccurred, this, &Daemon::SequenceErrorOccurred);
+    connect(&mRegulator, &SoftwareRegulator::onFinished, this, &Daemon::RegulatorStatus);
+    connect(&mRegulator, &SoftwareRegulator::onErrorOccurred, this, &Daemon::SequenceErrorOccurred);
+    connect(&mChargeEngine, &ChargeEngine::onPhaseChanged, this, &Daemon::ChargeStatus);
+    connect(&mChargeEngine, &ChargeEngine::onFinished, this, &Daemon::ChargeStatus);
+    connect(&mChargeEngine, &ChargeEngine::onErrorOccurred, this, &Daemon::SequenceErrorOccurred);
+    connect(&mChargeEngine, &ChargeEngine::onSamplingChanged, &mPoller, &Poller::SetExternallySampled);
+}
+
+void Daemon::setStreamPath(const QString &path) {
+    mStreamPath = path;
+}
+
+void Daemon::setSequenceFile(const QString &fileName) {
+    mSequenceFile = fileName;
+}
+
+bool Daemon::start() {
+    if (mSettings.status() != QSettings::NoError) {
+        qCritical().noquote() << "Can't read the configuration" << mSettings.fileName();
+        return false;
+    }
+
+    mPortName = mSettings.serialPortName();
+    mBaudRate = mSettings.serialPortBaudRate();
+    if (mPortName.isEmpty()) {
+        qCritical().noquote() << "serial-port/name is not set in" << mSettings.fileName();
+        return false;
+    }
+
+    int interval = mSettings.daemonReconnectInterval();
+    mReconnectTimer.setInterval((interval > 0 ? interval : DEFAULT_RECONNECT_INTERVAL_S) * 1000);
+
+    Connect();
+    return true;
+}
+
+void Daemon::Stop() {
+    mReconnectTimer.stop();
+    mSequencer.Stop();
+    mListPlayer.Stop();
+    mSweepEngine.Stop();
+    mRegulator.Stop();
+    mChargeEngine.Stop();
+    mPoller.Stop();
+    mTelemetryLogger.Stop();
+    mTelemetryStream.Stop();
+    mCommunication.CloseSerialPort();
+}
+
+void Daemon::Connect() {
+    qInfo().noquote() << "Opening" << mPortName << "at" << mBaudRate << "baud";
+    mCommunication.OpenSerialPort(mPortName, mBaudRate);
+}
+
+void Daemon::DeviceReady(const Global::DeviceInfo &info) {
+    qInfo().noquote() << "Device ready:" << info.Name << info.ID;
+
+    if (mSettings.isTelemetryLogEnabled()) {
+        mTelemetryLogger.Start(mSettings.telemetryLogOptions());
+    }
+    if (!mStreamPath.isEmpty() || mSettings.isTelemetryStreamEnabled()) {
+        auto options = mSettings.telemetryStreamOptions();
+        if (!mStreamPath.isEmpty()) {
+            options.path = mStreamPath;
+        }
+        mTelemetryStream.Start(options);
+    }
+    mPoller.SetRecording(mTelemetryLogger.isRunning() || mTelemetryStream.isRunning());
+    mPoller.Start();
+
+    // not replayed after a reconnect, the device may be in the middle of the program.
+    if (!mSequenceFile.isEmpty()) {
+        qInfo().noquote() << "Running the sequence" << mSequenceFile;
+        if (mSequenceFile.endsWith(".csv", Qt::CaseInsensitive)) {
+            mListPlayer.Start(mSequenceFile, info);
+        } else if (mSequenceFile.endsWith(".sweep", Qt::CaseInsensitive)) {
+            mSweepEngine.Start(mSequenceFile, info);
+        } else if (mSequenceFile.endsWith(".loop", Qt::CaseInsensitive)) {
+            mRegulator.Start(mSequenceFile, info);
+        } else if (mSequenceFile.endsWith(".charge", Qt::CaseInsensitive)) {
+            mChargeEngine.Start(mSequenceFile, info);
+        } else {
+            mSequencer.Start(mSequenceFile, info);
+        }
+        mSequenceFile.clear();
+    }
+}
+
+void Daemon::SerialPortClosed() {
+    mPoller.Stop();
+    mTelemetryLogger.Stop();
+
+    auto stats = mTelemetryStream.stats();
+    if (mTelemetryStream.isRunning() && stats.dropped > 0) {
+        qWarning().noquote() << QString("Telemetry stream: %1 frames written, %2 dropped by a slow consumer")
+                .arg(stats.written).arg(stats.dropped);
+    }
+    mTelemetryStream.Stop();
+}
+
+void Daemon::SerialPortErrorOccurred(const QString &error) {
+    qCritical().noquote() << "Serial port error:" << error;
+    scheduleReconnect();
+}
+
+void Daemon::UnknownDevice(const QString &deviceID) {
+    qCritical().noquote() << "Unknown device:" << deviceID;
+    mCommunication.CloseSerialPort();
+    scheduleReconnect();
+}
+
+void Daemon::TelemetryLogErrorOccurred(const QString &error) {
+    qCritical().noquote() << "Telemetry log error:" << error;
+}
+
+void Daemon::TelemetryStreamErrorOccurred(const QString &error) {
+    qCritical().noquote() << "Telemetry stream error:" << error;
+}
+
+void Daemon::SequenceFinished(const Sequencer::Report &report) {
+    qInfo().noquote() << "Sequence" << Sequencer::describe(report);
+}
+
+void Daemon::ListFinished(const ListPlayer::Report &report) {
+    qInfo().noquote() << "List" << ListPlayer::describe(report);
+}
+
+void Daemon::SweepFinished(const SweepEngine::Result &result) {
+    qInfo().noquote() << "Sweep" << SweepEngine::describe(result);
+}
+
+void Daemon::RegulatorStatus(const SoftwareRegulator::Status &status) {
+    qInfo().noquote() << "Loop stopped after" << status.cycles << "cycles," << SoftwareRegulator::describe(status);
+}
+
+void Daemon::ChargeStatus(const ChargeEngine::Status &status) {
+    qInfo().noquote() << "Charge" << ChargeEngine::describe(status);
+}
+
+void Daemon::SequenceErrorOccurred(const QString &error) {
+    qCritical().noquote() << "Sequence error:" << error;
+}
+
+void Daemon::ProtectionTripped(const QString &description, double latency) {
+    qWarning().noquote() << QString("Protection tripped: %1 (%2 ms)").arg(description).arg(latency, 0, 'f', 2);
+}
+
+void Daemon::scheduleReconnect() {
+    if (!mReconnectTimer.isActive()) {
+        mReconnectTimer.start();
+    }
+}
@@ -0,0 +1,89 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_DAEMON_H
+#define PS_MANAGEMENT_DAEMON_H
+
+#include <QObject>
+#include <QTimer>
+#include "Global.h"
+#include "Communication.h"
+#include "Poller.h"
+#include "Settings.h"
+#include "telemetry/TelemetryLogger.h"
+#include "telemetry/TelemetryStream.h"
+#include "automation/Sequencer.h"
+#include "automation/ListPlayer.h"
+#include "automation/SweepEngine.h"
+#include "automation/SoftwareRegulator.h"
+#include "automation/ChargeEngine.h"
+
+/**
+ * Headless counterpart of Application: opens the configured serial port, polls the device and records the telemetry
+ * log, with the host side protection and the watchdog of the configuration file. There is nobody to look at the set
+ * values, so only the status and the recorded measurements are polled. A lost device is reopened periodically.
+ * The frames can also be streamed as NDJSON to stdout or a FIFO for other processes, and a Sequence, a
+ * SetpointList, an I-V sweep, a CP/CR loop or a charge profile can be run once the device is ready for the first time.
+ */
+class Daemon : public QObject {
+    Q_OBJECT
+public:
+    explicit Daemon(const QString &configFile, QObject *parent = nullptr);
+
+    // overrides telemetry-stream/path of the configuration and enables the stream.
+    void setStreamPath(const QString &path);
+    void setSequenceFile(const QString &fileName);
+
+    bool start();
+
+public slots:
+    void Stop();
+
+private slots:
+    void Connect();
+    void DeviceReady(const Global::DeviceInfo &info);
+    void SerialPortClosed();
+    void SerialPortErrorOccurred(const QString &error);
+    void UnknownDevice(const QString &deviceID);
+    void TelemetryLogErrorOccurred(const QString &error);
+    void TelemetryStreamErrorOccurred(const QString &error);
+    void SequenceFinished(const Sequencer::Report &report);
+    void SequenceErrorOccurred(const QString &error);
+    void ListFinished(const ListPlayer::Report &report);
+    void SweepFinished(const SweepEngine::Result &result);
+    void RegulatorStatus(const SoftwareRegulator::Status &status);
+    void ChargeStatus(const ChargeEngine::Status &status);
+    void ProtectionTripped(const QString &description, double latency);
+
+private:
+    void scheduleReconnect();
+
+private:
+    Settings        mSettings;
+    Communication   mCommunication;
+    Poller          mPoller;
+    TelemetryLogger mTelemetryLogger;
+    TelemetryStream mTelemetryStream;
+    Sequencer       mSequencer;
+    ListPlayer      mListPlayer;
+    SweepEngine     mSweepEngine;
+    SoftwareRegulator mRegulator;
+    ChargeEngine    mChargeEngine;
+    QTimer          mReconnectTimer;
+    QString         mPortName;
+    int             mBaudRate = 9600;
+    QString         mStreamPath;
+    QString         mSequenceFile;
+};
+
+#endif //PS_MANAGEMENT_DAEMON_H
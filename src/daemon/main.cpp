@@ -0,0 +1,116 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Daemon.h"
+#include <config.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_CONFIG_FILE "/etc/ps-management/psm-daemon.conf"
+
+#ifdef Q_OS_UNIX
+static int signalSockets[2];
+
+static void signalHandler(int) {
+    int savedErrno = errno;
+    char data = 1;
+    // a failed write can't be reported from a signal handler; the socket buffer holds far more than the pending
+    // signals, only an interrupted write is retried.
+    while (::write(signalSockets[0], &data, sizeof(data)) < 0 && errno == EINTR) {
+    }
+    errno = savedErrno;
+}
+
+/**
+ * SIGTERM (systemctl stop) and SIGINT quit the event loop, so the telemetry log is flushed and closed. The handler
+ * only writes to a socket, the rest is done by the event loop.
+ */
+static void installSignalHandlers() {
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalSockets) != 0) {
+        return;
+    }
+
+    auto notifier = new QSocketNotifier(signalSockets[1], QSocketNotifier::Read, QCoreApplication::instance());
+    QObject::connect(notifier, &QSocketNotifier::activated, [notifier] () {
+        char data;
+        ssize_t size;
+        do {
+            size = ::read(signalSockets[1], &data, sizeof(data));
+        } while (size < 0 && errno == EINTR);
+        if (size <= 0) {
+            qWarning() << "Signal socket read failed:" << (size < 0 ? strerror(errno) : "closed");
+        }
+        notifier->setEnabled(false);
+        QCoreApplication::quit();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = signalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    QCoreApplication::setOrganizationName("vitark");
+    QCoreApplication::setApplicationName("psm-daemon");
+    QCoreApplication::setApplicationVersion(QString("%1.%2.%3").arg(VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH));
+
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless PS-Management: polls a power supply and records its telemetry.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption configOption({"c", "config"}, "Configuration file (INI).", "file", DEFAULT_CONFIG_FILE);
+    parser.addOption(configOption);
+    QCommandLineOption streamOption("stream", "Stream the telemetry as NDJSON to a FIFO or a file, \"-\" for stdout.",
+                                    "path");
+    parser.addOption(streamOption);
+    QCommandLineOption sequenceOption("sequence", "Run the sequence file (or the setpoint list *.csv, the I-V sweep "
+                                                  "*.sweep, the CP/CR loop *.loop, the charge profile *.charge) once "
+                                                  "the device is ready.", "file");
+    parser.addOption(sequenceOption);
+    parser.process(app);
+
+#ifdef Q_OS_UNIX
+    // once for the process: a telemetry stream consumer gone is reported by write() as EPIPE, instead of a kill.
+    ::signal(SIGPIPE, SIG_IGN);
+#endif
+    Daemon daemon(parser.value(configOption));
+    daemon.setStreamPath(parser.value(streamOption));
+    daemon.setSequenceFile(parser.value(sequenceOption));
+    if (!daemon.start()) {
+        return 1;
+    }
+
+#ifdef Q_OS_UNIX
+    installSignalHandlers();
+#endif
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, &daemon, &Daemon::Stop);
+
+    return QCoreApplication::exec();
+}
@@ -0,0 +1,69 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DeviceProfileCache.h"
+
+#include <QSerialPortInfo>
+#include <QStandardPaths>
+#include <QUrl>
+
+namespace Protocol {
+    DeviceProfileCache::DeviceProfileCache()
+            : DeviceProfileCache(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+                                 "/ps-management/device-profiles.ini") {
+    }
+
+    DeviceProfileCache::DeviceProfileCache(const QString &fileName) : mSettings(fileName, QSettings::IniFormat) {
+    }
+
+    QString DeviceProfileCache::key(const QString &portName) {
+        QSerialPortInfo info(portName);
+        if (info.isNull() || info.serialNumber().isEmpty()) {
+            return "";
+        }
+
+        return QString("%1|%2:%3|%4")
+                .arg(info.systemLocation())
+                .arg(info.vendorIdentifier(), 4, 16, QChar('0'))
+                .arg(info.productIdentifier(), 4, 16, QChar('0'))
+                .arg(info.serialNumber());
+    }
+
+    QString DeviceProfileCache::deviceID(const QString &key) const {
+        if (key.isEmpty()) {
+            return "";
+        }
+        return mSettings.value(settingsKey(key)).toString();
+    }
+
+    void DeviceProfileCache::store(const QString &key, const QString &id) {
+        if (key.isEmpty() || deviceID(key) == id) {
+            return;
+        }
+        mSettings.setValue(settingsKey(key), id);
+        mSettings.sync();
+    }
+
+    void DeviceProfileCache::remove(const QString &key) {
+        if (key.isEmpty()) {
+            return;
+        }
+        mSettings.remove(settingsKey(key));
+        mSettings.sync();
+    }
+
+    QString DeviceProfileCache::settingsKey(const QString &key) {
+        // the port names contain '/', the group separator of QSettings.
+        return "profiles/" + QString::fromLatin1(QUrl::toPercentEncoding(key));
+    }
+}
@@ -0,0 +1,46 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PSM_DEVICEPROFILECACHE_H
+#define PSM_DEVICEPROFILECACHE_H
+
+#include <QString>
+#include <QSettings>
+
+namespace Protocol {
+    /**
+     * Device IDs of the identified devices by serial port and USB serial number, so a short-lived tool can skip
+     * the identification round trip. A port without a USB serial number can't be told from another device plugged
+     * into it later and is never cached.
+     */
+    class DeviceProfileCache {
+    public:
+        DeviceProfileCache();
+        explicit DeviceProfileCache(const QString &fileName);
+
+        // empty, if the port has no USB serial number.
+        static QString key(const QString &portName);
+
+        QString deviceID(const QString &key) const;
+        void store(const QString &key, const QString &id);
+        void remove(const QString &key);
+
+    private:
+        static QString settingsKey(const QString &key);
+
+    private:
+        QSettings mSettings;
+    };
+}
+
+#endif //PSM_DEVICEPROFILECACHE_H
@@ -29,14 +29,20 @@ namespace Protocol {
             return nullptr;
         }
 
-        if (UTP3305C().isRecognized(mDeviceID)) {
+        auto instance = createByDeviceID(mDeviceID);
+        if (instance == nullptr) {
+            mErrorString = QObject::tr("Unknown or unsupported device (ID: %1)").arg(mDeviceID);
+        }
+        return instance;
+    }
+
+    BaseSCPI *Factory::createByDeviceID(const QString &deviceID) {
+        if (UTP3305C().isRecognized(deviceID)) {
             return new UTP3305C();
         }
-        if (UTP3303C().isRecognized(mDeviceID)) {
+        if (UTP3303C().isRecognized(deviceID)) {
             return new UTP3303C();
         }
-
-        mErrorString = QObject::tr("Unknown or unsupported device (ID: %1)").arg(mDeviceID);
         return nullptr;
     }
 
@@ -31,6 +31,8 @@ namespace Protocol {
         explicit Factory(QSerialPort &serialPort);
         ~Factory();
         BaseSCPI *createInstance();
+        // without asking the device, e.g. from a cached profile; nullptr if the ID is unknown.
+        static BaseSCPI *createByDeviceID(const QString &deviceID);
 
         QString errorString() const;
         QString deviceID() const;
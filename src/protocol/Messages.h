@@ -32,8 +32,59 @@ namespace Protocol {
         virtual bool isCommandWithReply() const { return replySize() > 0; }
         // messages that return true, will be dropped in case overflowing messages queue.
         virtual bool allowToDrop() const { return false; }
+        // commands of a setpoint stream wait the command gap learned by Communication instead of the fixed delay.
+        virtual bool isStreamed() const { return false; }
+
+        // MonotonicClock time (ns) when the message was put into the queue.
+        qint64 enqueueTime() const { return mEnqueueTime; }
+        void setEnqueueTime(qint64 time) { mEnqueueTime = time; }
+        // MonotonicClock time (ns) when the query was written to the serial port.
+        qint64 sendTime() const { return mSendTime; }
+        void setSendTime(qint64 time) { mSendTime = time; }
+        // the writing of a tagged command is reported by Communication::onCommandWritten, 0 -- untagged.
+        qint64 tag() const { return mTag; }
+        void setTag(qint64 tag) { mTag = tag; }
     protected:
         Global::Channel mChannel = Global::Channel1;
+        qint64          mEnqueueTime = 0;
+        qint64          mSendTime = 0;
+        qint64          mTag = 0;
+    };
+
+    /**
+     * A command encoded ahead of time, e.g. VSET1:12.00 of a list mode point. Written as is, no reply. The readback,
+     * e.g. VSET1?, reads the set value back, when it has to be checked that the device took the command.
+     */
+    class MessageRaw : public IMessage {
+        Q_DISABLE_COPY(MessageRaw)
+    public:
+        explicit MessageRaw(const QByteArray &command, bool streamed = true, IMessage *pReadback = nullptr)
+                : mCommand(command), mStreamed(streamed), mReadback(pReadback) {
+        }
+
+        ~MessageRaw() override {
+            delete mReadback;
+        }
+
+        QByteArray query() const override {
+            return mCommand;
+        }
+
+        bool isStreamed() const override {
+            return mStreamed;
+        }
+
+        // the caller owns the returned query, nullptr if there is none.
+        IMessage *takeReadback() {
+            auto pReadback = mReadback;
+            mReadback = nullptr;
+            return pReadback;
+        }
+
+    private:
+        QByteArray mCommand;
+        bool       mStreamed;
+        IMessage   *mReadback;
     };
 
     /**
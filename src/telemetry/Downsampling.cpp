@@ -0,0 +1,75 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Downsampling.h"
+#include <cmath>
+
+namespace Telemetry {
+    QVector<int> lttb(const qint64 *time, const float *value, int count, int threshold) {
+        QVector<int> indices;
+        if (count <= 0) {
+            return indices;
+        }
+
+        if (threshold >= count || threshold < 3) {
+            indices.resize(count);
+            for (int i = 0; i < count; ++i) {
+                indices[i] = i;
+            }
+            return indices;
+        }
+
+        indices.reserve(threshold);
+        // Work with times relative to the first point, so doubles keep full precision.
+        const qint64 origin = time[0];
+        const double every = double(count - 2) / (threshold - 2);
+
+        int a = 0;
+        indices.append(a);
+        for (int i = 0; i < threshold - 2; ++i) {
+            // average point of the next bucket
+            int avgStart = int(std::floor((i + 1) * every)) + 1;
+            int avgEnd = qMin(int(std::floor((i + 2) * every)) + 1, count);
+            double avgX = 0.0;
+            double avgY = 0.0;
+            for (int j = avgStart; j < avgEnd; ++j) {
+                avgX += double(time[j] - origin);
+                avgY += value[j];
+            }
+            int avgCount = qMax(avgEnd - avgStart, 1);
+            avgX /= avgCount;
+            avgY /= avgCount;
+
+            // point of the current bucket forming the largest triangle with the previous selected and the average
+            int rangeStart = int(std::floor(i * every)) + 1;
+            int rangeEnd = int(std::floor((i + 1) * every)) + 1;
+            double ax = double(time[a] - origin);
+            double ay = value[a];
+            double maxArea = -1.0;
+            int next = rangeStart;
+            for (int j = rangeStart; j < rangeEnd; ++j) {
+                double area = std::fabs((ax - avgX) * (value[j] - ay) - (ax - double(time[j] - origin)) * (avgY - ay));
+                if (area > maxArea) {
+                    maxArea = area;
+                    next = j;
+                }
+            }
+
+            indices.append(next);
+            a = next;
+        }
+        indices.append(count - 1);
+
+        return indices;
+    }
+}
@@ -0,0 +1,28 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_DOWNSAMPLING_H
+#define PS_MANAGEMENT_DOWNSAMPLING_H
+
+#include <QVector>
+
+namespace Telemetry {
+    /**
+     * Largest-Triangle-Three-Buckets downsampling (S. Steinarsson, 2013).
+     * Picks `threshold` points out of `count` keeping the visual shape of the series; first and last points
+     * are always kept. Returns indices into the source arrays, in ascending order. O(count).
+     */
+    QVector<int> lttb(const qint64 *time, const float *value, int count, int threshold);
+}
+
+#endif //PS_MANAGEMENT_DOWNSAMPLING_H
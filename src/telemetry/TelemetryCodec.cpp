@@ -0,0 +1,413 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TelemetryCodec.h"
+#include <cstring>
+
+#define STREAM_MAGIC "PSMT"
+#define STREAM_VERSION 3
+// without the times of the readings.
+#define STREAM_VERSION_NO_TIMES 2
+// without the block CRC either.
+#define STREAM_VERSION_NO_CRC 1
+#define BLOCK_TAG 'B'
+#define MASK_STATUS_CHANGED 0x10
+#define MASK_AGES_CHANGED 0x20
+#define CRC_SIZE 4
+// bounds of a sane block header, a damaged one is not waited for: a timestamp varint and the mask at least, the four
+// fields, the status and the four ages with their mask at most.
+#define MIN_SAMPLE_SIZE 2
+#define MAX_SAMPLE_SIZE 93
+#define MAX_BLOCK_SAMPLES (1 << 20)
+
+namespace Telemetry {
+    static inline quint64 zigzag(qint64 value) {
+        return (quint64(value) << 1) ^ quint64(value >> 63);
+    }
+
+    static inline qint64 unzigzag(quint64 value) {
+        return qint64(value >> 1) ^ -qint64(value & 1);
+    }
+
+    static inline void putVarint(QByteArray &out, quint64 value) {
+        char buffer[10];
+        int size = 0;
+        while (value >= 0x80) {
+            buffer[size++] = char((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        buffer[size++] = char(value);
+        out.append(buffer, size);
+    }
+
+    static inline bool getVarint(const char *&p, const char *end, quint64 &value) {
+        value = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            auto byte = quint8(*p++);
+            value |= quint64(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // CRC-32 (IEEE 802.3).
+    static quint32 crc32(const char *data, const char *end) {
+        static const auto table = [] () {
+            QVector<quint32> table(256);
+            for (quint32 i = 0; i < 256; ++i) {
+                quint32 value = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    value = value & 1 ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+                }
+                table[int(i)] = value;
+            }
+            return table;
+        }();
+
+        quint32 crc = 0xFFFFFFFFu;
+        for (; data < end; ++data) {
+            crc = table.at(int((crc ^ quint8(*data)) & 0xFF)) ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    static inline void putUint32(QByteArray &out, quint32 value) {
+        for (int i = 0; i < CRC_SIZE; ++i) {
+            out.append(char((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    static inline quint32 getUint32(const char *p) {
+        quint32 value = 0;
+        for (int i = 0; i < CRC_SIZE; ++i) {
+            value |= quint32(quint8(p[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    static inline void toFixedPoint(const Record &record, qint32 *fields) {
+        fields[0] = qRound(record.Ch1.Voltage * 100);  // 10 mV
+        fields[1] = qRound(record.Ch1.Current * 1000); // 1 mA
+        fields[2] = qRound(record.Ch2.Voltage * 100);
+        fields[3] = qRound(record.Ch2.Current * 1000);
+    }
+
+    // age of the readings at the row time (ms), small and steady while every cycle reads them.
+    static inline void toAges(const Record &record, qint64 *ages) {
+        ages[0] = record.Timestamp - record.Ch1.VoltageTime;
+        ages[1] = record.Timestamp - record.Ch1.CurrentTime;
+        ages[2] = record.Timestamp - record.Ch2.VoltageTime;
+        ages[3] = record.Timestamp - record.Ch2.CurrentTime;
+    }
+
+    quint8 statusToByte(const Global::DeviceStatus &status) {
+        quint8 data = 0;
+        data |= status.ModeCh1 == Global::ConstantVoltage ? 0x01 : 0;
+        data |= status.ModeCh2 == Global::ConstantVoltage ? 0x02 : 0;
+        data |= status.Tracking == Global::Serial ? 0x04 : 0;
+        data |= status.Tracking == Global::Parallel ? 0x08 : 0;
+        data |= status.Protection == Global::OverVoltageProtectionOnly ? 0x10 : 0;
+        data |= status.Protection == Global::OverCurrentProtectionOnly ? 0x20 : 0;
+        data |= status.Protection == Global::OutputProtectionAllEnabled ? 0x30 : 0;
+        data |= status.OutputSwitch ? 0x40 : 0;
+        return data;
+    }
+
+    Global::DeviceStatus statusFromByte(quint8 data) {
+        auto status = Global::DeviceStatus();
+        status.ModeCh1 = Global::OutputMode(bool(data & 0x01));
+        status.ModeCh2 = Global::OutputMode(bool(data & 0x02));
+        status.Tracking = Global::Independent;
+        status.Tracking = bool(data & 0x04) ? Global::Serial : status.Tracking;
+        status.Tracking = bool(data & 0x08) ? Global::Parallel : status.Tracking;
+        status.Protection = Global::OutputProtectionAllDisabled;
+        status.Protection = bool(data & 0x10) ? Global::OverVoltageProtectionOnly : status.Protection;
+        status.Protection = bool(data & 0x20) ? Global::OverCurrentProtectionOnly : status.Protection;
+        status.Protection = (data & 0x30) == 0x30 ? Global::OutputProtectionAllEnabled : status.Protection;
+        status.OutputSwitch = bool(data & 0x40);
+        return status;
+    }
+
+    Encoder::Encoder(int blockSize) : mBlockSize(qMax(1, blockSize)) {
+        mBlock.reserve(mBlockSize * 4);
+    }
+
+    QByteArray Encoder::streamHeader() {
+        return QByteArray(STREAM_MAGIC).append(char(STREAM_VERSION));
+    }
+
+    void Encoder::resetState() {
+        mPrevTimestamp = 0;
+        mPrevDelta = 0;
+        std::memset(mPrevFields, 0, sizeof(mPrevFields));
+        std::memset(mPrevAges, 0, sizeof(mPrevAges));
+        mPrevStatus = 0;
+    }
+
+    void Encoder::append(const Record &record) {
+        if (mBlockCount == 0) {
+            putVarint(mBlock, zigzag(record.Timestamp));
+        } else {
+            qint64 delta = record.Timestamp - mPrevTimestamp;
+            putVarint(mBlock, zigzag(delta - mPrevDelta));
+            mPrevDelta = delta;
+        }
+        mPrevTimestamp = record.Timestamp;
+
+        qint32 fields[4];
+        toFixedPoint(record, fields);
+        quint8 status = statusToByte(record.Status);
+        quint8 statusXor = status ^ mPrevStatus;
+
+        qint64 ages[4];
+        toAges(record, ages);
+        quint8 agesMask = 0;
+        for (int i = 0; i < 4; ++i) {
+            agesMask |= ages[i] != mPrevAges[i] ? (1 << i) : 0;
+        }
+
+        quint8 mask = statusXor ? MASK_STATUS_CHANGED : 0;
+        mask |= agesMask ? MASK_AGES_CHANGED : 0;
+        for (int i = 0; i < 4; ++i) {
+            mask |= fields[i] != mPrevFields[i] ? (1 << i) : 0;
+        }
+
+        mBlock.append(char(mask));
+        if (statusXor) {
+            mBlock.append(char(statusXor));
+        }
+        for (int i = 0; i < 4; ++i) {
+            if (mask & (1 << i)) {
+                putVarint(mBlock, zigzag(qint64(fields[i]) - mPrevFields[i]));
+                mPrevFields[i] = fields[i];
+            }
+        }
+        if (agesMask) {
+            mBlock.append(char(agesMask));
+            for (int i = 0; i < 4; ++i) {
+                if (agesMask & (1 << i)) {
+                    putVarint(mBlock, zigzag(ages[i] - mPrevAges[i]));
+                    mPrevAges[i] = ages[i];
+                }
+            }
+        }
+        mPrevStatus = status;
+
+        ++mSamplesCount;
+        if (++mBlockCount >= mBlockSize) {
+            flush();
+        }
+    }
+
+    void Encoder::flush() {
+        if (mBlockCount == 0) {
+            return;
+        }
+
+        int size = mEncoded.size();
+        mEncoded.append(BLOCK_TAG);
+        putVarint(mEncoded, quint64(mBlockCount));
+        putVarint(mEncoded, quint64(mBlock.size()));
+        putUint32(mEncoded, crc32(mBlock.constData(), mBlock.constData() + mBlock.size()));
+        putUint32(mEncoded, crc32(mEncoded.constData() + size + 1, mEncoded.constData() + mEncoded.size()));
+        mEncoded.append(mBlock);
+        mEncodedSize += mEncoded.size() - size;
+
+        mBlock.resize(0);
+        mBlockCount = 0;
+        resetState();
+    }
+
+    QByteArray Encoder::takeEncoded() {
+        QByteArray encoded;
+        encoded.swap(mEncoded);
+        return encoded;
+    }
+
+    void Decoder::feed(const QByteArray &data) {
+        if (mError) {
+            return;
+        }
+        if (mReadyIndex >= mReady.size()) {
+            mReady.clear();
+            mReadyIndex = 0;
+        }
+
+        mBuffer.append(data);
+        const char *begin = mBuffer.constData();
+        const char *end = begin + mBuffer.size();
+        const char *p = begin;
+
+        if (!mHeaderParsed) {
+            const int headerSize = sizeof(STREAM_MAGIC); // magic + version
+            if (end - p < headerSize) {
+                return;
+            }
+            int version = p[headerSize - 1];
+            if (std::memcmp(p, STREAM_MAGIC, headerSize - 1) != 0 ||
+                version < STREAM_VERSION_NO_CRC || version > STREAM_VERSION) {
+                mError = true;
+                mBuffer.clear();
+                return;
+            }
+            mHasCrc = version != STREAM_VERSION_NO_CRC;
+            mHasAges = version == STREAM_VERSION;
+            p += headerSize;
+            mHeaderParsed = true;
+        }
+
+        while (p < end) {
+            if (*p != BLOCK_TAG) {
+                lostSync();
+                auto tag = static_cast<const char *>(std::memchr(p, BLOCK_TAG, size_t(end - p)));
+                p = tag ? tag : end;
+                continue;
+            }
+
+            const char *blockStart = p++;
+            quint64 count, payloadSize;
+            bool isHeaderValid = getVarint(p, end, count) && getVarint(p, end, payloadSize);
+            if (!isHeaderValid && p >= end) {
+                p = blockStart; // incomplete block, wait for more data
+                break;
+            }
+            isHeaderValid = isHeaderValid && count > 0 && count <= MAX_BLOCK_SAMPLES &&
+                            payloadSize >= count * MIN_SAMPLE_SIZE && payloadSize <= count * MAX_SAMPLE_SIZE;
+            if (!isHeaderValid) {
+                lostSync();
+                p = blockStart + 1;
+                continue;
+            }
+            quint32 payloadCrc = 0;
+            if (mHasCrc) {
+                if (end - p < 2 * CRC_SIZE) {
+                    p = blockStart;
+                    break;
+                }
+                payloadCrc = getUint32(p);
+                if (crc32(blockStart + 1, p + CRC_SIZE) != getUint32(p + CRC_SIZE)) {
+                    lostSync();
+                    p = blockStart + 1;
+                    continue;
+                }
+                p += 2 * CRC_SIZE;
+            }
+            if (quint64(end - p) < payloadSize) {
+                p = blockStart;
+                break;
+            }
+            if (mHasCrc && crc32(p, p + payloadSize) != payloadCrc) {
+                lostSync();
+                p = blockStart + 1;
+                continue;
+            }
+
+            // a block is taken whole or not at all, a damaged one doesn't leave half decoded records.
+            if (!decodeBlock(p, p + payloadSize, int(count))) {
+                lostSync();
+                p = blockStart + 1;
+                continue;
+            }
+            mReady += mBlock;
+            mIsSyncLost = false;
+            p += payloadSize;
+        }
+
+        mBuffer.remove(0, int(p - begin));
+    }
+
+    void Decoder::lostSync() {
+        if (!mIsSyncLost) {
+            mIsSyncLost = true;
+            mBadBlocksCount++;
+        }
+    }
+
+    bool Decoder::decodeBlock(const char *p, const char *end, int count) {
+        qint64 timestamp = 0;
+        qint64 delta = 0;
+        qint32 fields[4] = {};
+        qint64 ages[4] = {};
+        quint8 status = 0;
+        quint64 value;
+
+        Record record;
+        mBlock.resize(0);
+        mBlock.reserve(count);
+        for (int n = 0; n < count; ++n) {
+            if (!getVarint(p, end, value) || p >= end) {
+                return false;
+            }
+            if (n == 0) {
+                timestamp = unzigzag(value);
+            } else {
+                delta += unzigzag(value);
+                timestamp += delta;
+            }
+
+            auto mask = quint8(*p++);
+            if (mask & MASK_STATUS_CHANGED) {
+                if (p >= end) {
+                    return false;
+                }
+                status ^= quint8(*p++);
+            }
+            for (int i = 0; i < 4; ++i) {
+                if (mask & (1 << i)) {
+                    if (!getVarint(p, end, value)) {
+                        return false;
+                    }
+                    fields[i] += qint32(unzigzag(value));
+                }
+            }
+            if (mask & MASK_AGES_CHANGED) {
+                if (!mHasAges || p >= end) {
+                    return false;
+                }
+                auto agesMask = quint8(*p++);
+                for (int i = 0; i < 4; ++i) {
+                    if (agesMask & (1 << i)) {
+                        if (!getVarint(p, end, value)) {
+                            return false;
+                        }
+                        ages[i] += unzigzag(value);
+                    }
+                }
+            }
+
+            record.Timestamp   = timestamp;
+            record.Ch1.Voltage = fields[0] / 100.0;
+            record.Ch1.Current = fields[1] / 1000.0;
+            record.Ch2.Voltage = fields[2] / 100.0;
+            record.Ch2.Current = fields[3] / 1000.0;
+            // older streams have no ages, their readings are taken at the row time.
+            record.Ch1.VoltageTime = timestamp - ages[0];
+            record.Ch1.CurrentTime = timestamp - ages[1];
+            record.Ch2.VoltageTime = timestamp - ages[2];
+            record.Ch2.CurrentTime = timestamp - ages[3];
+            record.Status      = statusFromByte(status);
+            mBlock.append(record);
+        }
+        return p == end;
+    }
+
+    bool Decoder::next(Record &record) {
+        if (mReadyIndex < mReady.size()) {
+            record = mReady.at(mReadyIndex++);
+            return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,100 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_TELEMETRYCODEC_H
+#define PS_MANAGEMENT_TELEMETRYCODEC_H
+
+#include <QByteArray>
+#include <QVector>
+#include "TelemetryFormat.h"
+
+/**
+ * Compact encoding of the telemetry records for long recordings.
+ *
+ * Stream:  "PSMT" <version:u8> block*
+ * Block:   'B' <count:varint> <payload size:varint> <payload crc:u32 le> <header crc:u32 le> payload
+ * Sample:  <timestamp delta-of-delta:zigzag varint> <mask:u8> [status xor:u8] [field delta:zigzag varint]*
+ *          [<ages mask:u8> [age delta:zigzag varint]*]
+ *
+ * Voltages are stored in 10 mV units and currents in 1 mA units (the device resolution). The mask tells which
+ * of the four fields (ch1 V, ch1 I, ch2 V, ch2 I) and the status byte changed since the previous sample, so
+ * a steady reading costs two bytes. The ages of the readings at the sample time (ms) are stored the same way, behind
+ * a flag of the mask and a mask of their own. Every block starts from a clean state and can be decoded on its own:
+ * the decoder skips a damaged block and resumes at the next block tag. The CRC-32 of the header (count, size and
+ * payload CRC) is checked before the payload is waited for, so a 'B' in damaged data isn't taken for a block, nor
+ * does a bogus size hold up the decoding. Version 2 streams have no ages and version 1 streams no CRCs either, both
+ * are still read.
+ */
+namespace Telemetry {
+    quint8 statusToByte(const Global::DeviceStatus &status);
+    Global::DeviceStatus statusFromByte(quint8 data);
+
+    class Encoder {
+    public:
+        explicit Encoder(int blockSize = 1024);
+
+        static QByteArray streamHeader();
+
+        void append(const Record &record);
+        void flush();
+        QByteArray takeEncoded();
+
+        qint64 samplesCount() const { return mSamplesCount; }
+        qint64 encodedSize() const { return mEncodedSize; }
+
+    private:
+        void resetState();
+
+    private:
+        int         mBlockSize;
+        int         mBlockCount = 0;
+        QByteArray  mBlock;
+        QByteArray  mEncoded;
+
+        qint64      mPrevTimestamp = 0;
+        qint64      mPrevDelta = 0;
+        qint32      mPrevFields[4] = {};
+        qint64      mPrevAges[4] = {};
+        quint8      mPrevStatus = 0;
+
+        qint64      mSamplesCount = 0;
+        qint64      mEncodedSize = 0;
+    };
+
+    class Decoder {
+    public:
+        void feed(const QByteArray &data);
+        bool next(Record &record);
+        // not a telemetry stream, or damaged blocks were skipped.
+        bool hasError() const { return mError || mBadBlocksCount > 0; }
+        int badBlocksCount() const { return mBadBlocksCount; }
+
+    private:
+        bool decodeBlock(const char *data, const char *end, int count);
+        void lostSync();
+
+    private:
+        QByteArray      mBuffer;
+        bool            mHeaderParsed = false;
+        bool            mHasCrc = true;
+        bool            mHasAges = true;
+        bool            mError = false;         // the stream header is wrong, nothing is decoded
+        bool            mIsSyncLost = false;    // looking for the next block after a damaged one
+        int             mBadBlocksCount = 0;
+        QVector<Record> mBlock;
+        QVector<Record> mReady;
+        int             mReadyIndex = 0;
+    };
+}
+
+#endif //PS_MANAGEMENT_TELEMETRYCODEC_H
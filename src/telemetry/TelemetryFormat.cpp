@@ -0,0 +1,108 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TelemetryFormat.h"
+
+namespace Telemetry {
+    static const char *modeName(Global::OutputMode mode) {
+        return mode == Global::ConstantVoltage ? "CV" : "CC";
+    }
+
+    static const char *trackingName(Global::ChannelsTracking tracking) {
+        switch (tracking) {
+            case Global::Serial:
+                return "serial";
+            case Global::Parallel:
+                return "parallel";
+            case Global::Independent:
+            default:
+                return "independent";
+        }
+    }
+
+    static const char *protectionName(Global::OutputProtection protection) {
+        switch (protection) {
+            case Global::OutputProtectionAllEnabled:
+                return "ovp+ocp";
+            case Global::OverVoltageProtectionOnly:
+                return "ovp";
+            case Global::OverCurrentProtectionOnly:
+                return "ocp";
+            case Global::OutputProtectionAllDisabled:
+            default:
+                return "off";
+        }
+    }
+
+    QByteArray csvHeader() {
+        return "timestamp,ch1_voltage,ch1_voltage_time,ch1_current,ch1_current_time,ch1_mode,"
+               "ch2_voltage,ch2_voltage_time,ch2_current,ch2_current_time,ch2_mode,tracking,protection,output\n";
+    }
+
+    void appendCsv(QByteArray &out, const Record &record) {
+        out.append(QByteArray::number(record.Timestamp)).append(',')
+           .append(QByteArray::number(record.Ch1.Voltage, 'f', 2)).append(',')
+           .append(QByteArray::number(record.Ch1.VoltageTime)).append(',')
+           .append(QByteArray::number(record.Ch1.Current, 'f', 3)).append(',')
+           .append(QByteArray::number(record.Ch1.CurrentTime)).append(',')
+           .append(modeName(record.Status.ModeCh1)).append(',')
+           .append(QByteArray::number(record.Ch2.Voltage, 'f', 2)).append(',')
+           .append(QByteArray::number(record.Ch2.VoltageTime)).append(',')
+           .append(QByteArray::number(record.Ch2.Current, 'f', 3)).append(',')
+           .append(QByteArray::number(record.Ch2.CurrentTime)).append(',')
+           .append(modeName(record.Status.ModeCh2)).append(',')
+           .append(trackingName(record.Status.Tracking)).append(',')
+           .append(protectionName(record.Status.Protection)).append(',')
+           .append(record.Status.OutputSwitch ? '1' : '0').append('\n');
+    }
+
+    void appendJson(QByteArray &out, const Record &record) {
+        out.append("{\"t\":").append(QByteArray::number(record.Timestamp))
+           .append(",\"ch1\":{\"v\":").append(QByteArray::number(record.Ch1.Voltage, 'f', 2))
+           .append(",\"vt\":").append(QByteArray::number(record.Ch1.VoltageTime))
+           .append(",\"i\":").append(QByteArray::number(record.Ch1.Current, 'f', 3))
+           .append(",\"it\":").append(QByteArray::number(record.Ch1.CurrentTime))
+           .append(",\"mode\":\"").append(modeName(record.Status.ModeCh1))
+           .append("\"},\"ch2\":{\"v\":").append(QByteArray::number(record.Ch2.Voltage, 'f', 2))
+           .append(",\"vt\":").append(QByteArray::number(record.Ch2.VoltageTime))
+           .append(",\"i\":").append(QByteArray::number(record.Ch2.Current, 'f', 3))
+           .append(",\"it\":").append(QByteArray::number(record.Ch2.CurrentTime))
+           .append(",\"mode\":\"").append(modeName(record.Status.ModeCh2))
+           .append("\"},\"tracking\":\"").append(trackingName(record.Status.Tracking))
+           .append("\",\"protection\":\"").append(protectionName(record.Status.Protection))
+           .append("\",\"output\":").append(record.Status.OutputSwitch ? "true" : "false")
+           .append("}\n");
+    }
+
+    static void appendChannelJson(QByteArray &out, const Global::ChannelFrame &channel, Global::OutputMode mode) {
+        out.append("{\"vset\":").append(QByteArray::number(channel.VoltageSet, 'f', 2))
+           .append(",\"iset\":").append(QByteArray::number(channel.CurrentSet, 'f', 3))
+           .append(",\"v\":").append(QByteArray::number(channel.ActualVoltage, 'f', 2))
+           .append(",\"i\":").append(QByteArray::number(channel.ActualCurrent, 'f', 3))
+           .append(",\"mode\":\"").append(modeName(mode)).append("\"}");
+    }
+
+    void appendFrameJson(QByteArray &out, const Global::TelemetryFrame &frame) {
+        out.append("{\"t\":").append(QByteArray::number(frame.WallTime))
+           .append(",\"mono\":").append(QByteArray::number(frame.Timestamp))
+           .append(",\"upd\":").append(QByteArray::number(frame.Updated | (frame.IsStatusUpdated ? 0x100 : 0)))
+           .append(",\"ch1\":");
+        appendChannelJson(out, frame.Ch1, frame.Status.ModeCh1);
+        out.append(",\"ch2\":");
+        appendChannelJson(out, frame.Ch2, frame.Status.ModeCh2);
+        out.append(",\"tracking\":\"").append(trackingName(frame.Status.Tracking))
+           .append("\",\"protection\":\"").append(protectionName(frame.Status.Protection))
+           .append("\",\"output\":").append(frame.Status.OutputSwitch ? "true" : "false")
+           .append("}\n");
+    }
+}
@@ -0,0 +1,45 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_TELEMETRYFORMAT_H
+#define PS_MANAGEMENT_TELEMETRYFORMAT_H
+
+#include <QByteArray>
+#include "Global.h"
+
+namespace Telemetry {
+    struct ChannelRecord {
+        double Voltage = 0.0;
+        double Current = 0.0;
+        qint64 VoltageTime = 0; // ms since epoch, arrival of the reading
+        qint64 CurrentTime = 0;
+    };
+
+    // One row of the telemetry log: latest measurements of both channels and the decoded STATUS? byte. A measurement
+    // not read again since the previous row keeps its own, earlier time.
+    struct Record {
+        qint64                  Timestamp = 0; // ms since epoch, arrival of the STATUS? reply
+        ChannelRecord           Ch1;
+        ChannelRecord           Ch2;
+        Global::DeviceStatus    Status = {};
+    };
+
+    QByteArray csvHeader();
+    void appendCsv(QByteArray &out, const Record &record);
+    void appendJson(QByteArray &out, const Record &record);
+    // one line per frame for TelemetryStream: set and actual values of both channels, the status, the timestamps
+    // and the Updated bits of the frame.
+    void appendFrameJson(QByteArray &out, const Global::TelemetryFrame &frame);
+}
+
+#endif //PS_MANAGEMENT_TELEMETRYFORMAT_H
@@ -0,0 +1,259 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TelemetryLogger.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// The writer is woken up earlier than the flush interval only when this many records are waiting,
+// so the producer side never pays for a context switch per record.
+#define WAKEUP_PENDING_RECORDS 256
+// About a minute of samples at the fastest poll rate; bounds what is lost if the application is killed.
+#define COMPRESSED_BLOCK_SIZE 256
+
+TelemetryLogger::TelemetryLogger(QObject *parent) : QObject(parent) {
+}
+
+TelemetryLogger::~TelemetryLogger() {
+    Stop();
+}
+
+bool TelemetryLogger::isRunning() const {
+    return mWriter != nullptr && mWriter->isRunning();
+}
+
+void TelemetryLogger::Start(const TelemetryLogger::Options &options) {
+    Stop();
+
+    mWriter = new TelemetryLogWriter(this, options);
+    mWriter->start(QThread::LowPriority);
+}
+
+void TelemetryLogger::Stop() {
+    if (mWriter == nullptr) {
+        return;
+    }
+
+    mWriter->stop();
+    mWriter->wait();
+    delete mWriter, mWriter = nullptr;
+}
+
+void TelemetryLogger::UpdateTelemetry(const Global::TelemetryFrame &frame) {
+    if (mWriter == nullptr || !frame.IsStatusUpdated) {
+        return;
+    }
+
+    // the frame is published after the last reply of the cycle, each value is stamped with the arrival of its own.
+    auto wallTime = [&frame] (const Global::SampleTime &time) {
+        return time.Arrived > 0 ? frame.WallTime - (frame.Timestamp - time.Arrived) / 1000000 : 0;
+    };
+    auto channelRecord = [&wallTime] (const Global::ChannelFrame &channel) {
+        return Telemetry::ChannelRecord {
+            channel.ActualVoltage, channel.ActualCurrent,
+            wallTime(channel.Time[Global::TelemetryFrame::ActualVoltage]),
+            wallTime(channel.Time[Global::TelemetryFrame::ActualCurrent])
+        };
+    };
+
+    Telemetry::Record record;
+    record.Timestamp = wallTime(frame.StatusTime);
+    record.Ch1 = channelRecord(frame.Ch1);
+    record.Ch2 = channelRecord(frame.Ch2);
+    record.Status = frame.Status;
+    mWriter->append(record);
+}
+
+TelemetryLogWriter::TelemetryLogWriter(TelemetryLogger *logger, const TelemetryLogger::Options &options)
+        : mLogger(logger), mOptions(options), mEncoder(COMPRESSED_BLOCK_SIZE) {
+    mPending.reserve(WAKEUP_PENDING_RECORDS * 2);
+}
+
+TelemetryLogWriter::~TelemetryLogWriter() {
+    stop();
+    wait();
+}
+
+void TelemetryLogWriter::append(const Telemetry::Record &record) {
+    if (!isRunning()) {
+        return;
+    }
+
+    QMutexLocker locker(&mMutex);
+    mPending.append(record);
+    if (mPending.size() >= WAKEUP_PENDING_RECORDS) {
+        mCondition.wakeOne();
+    }
+}
+
+void TelemetryLogWriter::stop() {
+    QMutexLocker locker(&mMutex);
+    mStopRequested = true;
+    mCondition.wakeOne();
+}
+
+void TelemetryLogWriter::run() {
+    if (!openFile()) {
+        return;
+    }
+
+    QVector<Telemetry::Record> records;
+    records.reserve(WAKEUP_PENDING_RECORDS * 2);
+    QByteArray batch;
+    batch.reserve(mOptions.batchSize * 2);
+
+    QElapsedTimer sinceFlush;
+    sinceFlush.start();
+
+    bool stopping = false;
+    while (!stopping) {
+        {
+            QMutexLocker locker(&mMutex);
+            if (mPending.isEmpty() && !mStopRequested) {
+                mCondition.wait(&mMutex, mOptions.flushInterval);
+            }
+            records.swap(mPending);
+            stopping = mStopRequested;
+        }
+
+        for (const auto &record : qAsConst(records)) {
+            formatRecord(batch, record);
+        }
+        records.clear();
+
+        if (stopping && mOptions.format == TelemetryLogger::Compressed) {
+            mEncoder.flush();
+            batch.append(mEncoder.takeEncoded());
+        }
+
+        if (batch.size() >= mOptions.batchSize || sinceFlush.elapsed() >= mOptions.flushInterval || stopping) {
+            if (!writeBatch(batch)) {
+                break;
+            }
+            sinceFlush.restart();
+        }
+    }
+
+    closeFile();
+}
+
+void TelemetryLogWriter::formatRecord(QByteArray &batch, const Telemetry::Record &record) {
+    switch (mOptions.format) {
+        case TelemetryLogger::CSV:
+            Telemetry::appendCsv(batch, record);
+            break;
+        case TelemetryLogger::NDJSON:
+            Telemetry::appendJson(batch, record);
+            break;
+        case TelemetryLogger::Compressed:
+            // Only complete blocks are written, the rest of the block stays in the encoder until it is full.
+            mEncoder.append(record);
+            batch.append(mEncoder.takeEncoded());
+            break;
+    }
+}
+
+bool TelemetryLogWriter::openFile() {
+    QDir dir(mOptions.directory);
+    if (!dir.mkpath(".")) {
+        reportError(QObject::tr("Unable to create telemetry log directory %1").arg(mOptions.directory));
+        return false;
+    }
+
+    const char *suffix = "csv";
+    if (mOptions.format == TelemetryLogger::NDJSON) {
+        suffix = "ndjson";
+    } else if (mOptions.format == TelemetryLogger::Compressed) {
+        suffix = "psmt";
+    }
+    QString baseName = QString("telemetry-%1").arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"));
+    QString fileName = dir.filePath(QString("%1.%2").arg(baseName, suffix));
+    for (int i = 1; QFile::exists(fileName); ++i) {
+        fileName = dir.filePath(QString("%1-%2.%3").arg(baseName).arg(i).arg(suffix));
+    }
+
+    mFile.setFileName(fileName);
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        reportError(QObject::tr("Unable to open telemetry log %1: %2").arg(fileName, mFile.errorString()));
+        return false;
+    }
+    mFileOpenedAt = QDateTime::currentSecsSinceEpoch();
+
+    if (mOptions.format == TelemetryLogger::CSV) {
+        mFile.write(Telemetry::csvHeader());
+    } else if (mOptions.format == TelemetryLogger::Compressed) {
+        mFile.write(Telemetry::Encoder::streamHeader());
+    }
+    return true;
+}
+
+void TelemetryLogWriter::closeFile() {
+    if (mFile.isOpen()) {
+        mFile.close();
+    }
+}
+
+bool TelemetryLogWriter::isRotationRequired() const {
+    if (mOptions.rotateSize > 0 && mFile.size() >= mOptions.rotateSize) {
+        return true;
+    }
+    if (mOptions.rotateInterval > 0 && QDateTime::currentSecsSinceEpoch() - mFileOpenedAt >= mOptions.rotateInterval) {
+        return true;
+    }
+    return false;
+}
+
+bool TelemetryLogWriter::writeBatch(QByteArray &batch) {
+    if (batch.isEmpty()) {
+        return true;
+    }
+
+    if (isRotationRequired()) {
+        closeFile();
+        if (!openFile()) {
+            batch.clear();
+            return false;
+        }
+    }
+
+    if (mFile.write(batch) != batch.size()) {
+        reportError(QObject::tr("Unable to write telemetry log %1: %2").arg(mFile.fileName(), mFile.errorString()));
+    }
+    batch.clear();
+
+    mFile.flush();
+    if (mOptions.fsync) {
+#ifdef Q_OS_WIN
+        _commit(mFile.handle());
+#else
+        ::fsync(mFile.handle());
+#endif
+    }
+    return true;
+}
+
+void TelemetryLogWriter::reportError(const QString &error) {
+    auto logger = mLogger;
+    QMetaObject::invokeMethod(logger, [logger, error] () {
+        emit logger->onErrorOccurred(error);
+    }, Qt::QueuedConnection);
+}
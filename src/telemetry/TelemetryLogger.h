@@ -0,0 +1,104 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_TELEMETRYLOGGER_H
+#define PS_MANAGEMENT_TELEMETRYLOGGER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QFile>
+#include "Global.h"
+#include "TelemetryFormat.h"
+#include "TelemetryCodec.h"
+
+class TelemetryLogWriter;
+
+/**
+ * Telemetry log pipeline stage. The producer side (slot) only queues a record per telemetry frame with
+ * a device status reply; formatting, batching, rotation and fsync are done by a background thread,
+ * so neither the GUI nor the serial port timing is affected by a slow disk.
+ */
+class TelemetryLogger : public QObject {
+    Q_OBJECT
+public:
+    enum Format {
+        CSV,
+        NDJSON,
+        Compressed, // see TelemetryCodec.h
+    };
+
+    struct Options {
+        QString directory;
+        Format  format = CSV;
+        qint64  rotateSize = 0;        // bytes, 0 -- disabled
+        int     rotateInterval = 0;    // seconds, 0 -- disabled
+        int     flushInterval = 1000;  // ms
+        int     batchSize = 64 * 1024; // bytes
+        bool    fsync = false;
+    };
+
+    explicit TelemetryLogger(QObject *parent = nullptr);
+    ~TelemetryLogger() override;
+
+    bool isRunning() const;
+
+signals:
+    void onErrorOccurred(QString error);
+
+public slots:
+    void Start(const TelemetryLogger::Options &options);
+    void Stop();
+
+    void UpdateTelemetry(const Global::TelemetryFrame &frame);
+
+private:
+    TelemetryLogWriter  *mWriter = nullptr;
+};
+
+class TelemetryLogWriter : public QThread {
+public:
+    TelemetryLogWriter(TelemetryLogger *logger, const TelemetryLogger::Options &options);
+    ~TelemetryLogWriter() override;
+
+    void append(const Telemetry::Record &record);
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    bool openFile();
+    void closeFile();
+    bool isRotationRequired() const;
+    void formatRecord(QByteArray &batch, const Telemetry::Record &record);
+    bool writeBatch(QByteArray &batch);
+    void reportError(const QString &error);
+
+private:
+    TelemetryLogger             *mLogger;
+    TelemetryLogger::Options    mOptions;
+
+    QMutex                      mMutex;
+    QWaitCondition              mCondition;
+    QVector<Telemetry::Record>  mPending;
+    bool                        mStopRequested = false;
+
+    Telemetry::Encoder          mEncoder;
+    QFile                       mFile;
+    qint64                      mFileOpenedAt = 0;
+};
+
+#endif //PS_MANAGEMENT_TELEMETRYLOGGER_H
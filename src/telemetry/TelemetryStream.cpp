@@ -0,0 +1,280 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TelemetryStream.h"
+#include "TelemetryFormat.h"
+
+#include <QMutexLocker>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The writer checks this often whether it is asked to stop, while it waits for a consumer.
+#define STOP_CHECK_INTERVAL_MS 200
+#define MAX_DECIMATION 64
+
+TelemetryStream::TelemetryStream(QObject *parent) : QObject(parent) {
+}
+
+TelemetryStream::~TelemetryStream() {
+    Stop();
+}
+
+bool TelemetryStream::isRunning() const {
+    return mWriter != nullptr && mWriter->isRunning();
+}
+
+TelemetryStream::Stats TelemetryStream::stats() const {
+    return mWriter != nullptr ? mWriter->stats() : Stats();
+}
+
+TelemetryStream::Policy TelemetryStream::policyFromString(const QString &name) {
+    if (name == "block") {
+        return Block;
+    }
+    if (name == "decimate") {
+        return Decimate;
+    }
+    return DropOldest;
+}
+
+void TelemetryStream::Start(const TelemetryStream::Options &options) {
+    Stop();
+
+    mWriter = new TelemetryStreamWriter(this, options);
+    mWriter->start(QThread::LowPriority);
+}
+
+void TelemetryStream::Stop() {
+    if (mWriter == nullptr) {
+        return;
+    }
+
+    mWriter->stop();
+    mWriter->wait();
+    delete mWriter, mWriter = nullptr;
+}
+
+void TelemetryStream::UpdateTelemetry(const Global::TelemetryFrame &frame) {
+    if (mWriter != nullptr) {
+        mWriter->append(frame);
+    }
+}
+
+TelemetryStreamWriter::TelemetryStreamWriter(TelemetryStream *stream, const TelemetryStream::Options &options)
+        : mStream(stream), mOptions(options) {
+    mOptions.queueSize = qMax(1, mOptions.queueSize);
+    mOptions.maxQueueSize = qMax(mOptions.queueSize, mOptions.maxQueueSize);
+}
+
+TelemetryStreamWriter::~TelemetryStreamWriter() {
+    stop();
+    wait();
+}
+
+void TelemetryStreamWriter::append(const Global::TelemetryFrame &frame) {
+    QMutexLocker locker(&mMutex);
+    if (mStopRequested) {
+        return;
+    }
+
+    if (mOptions.policy == TelemetryStream::Decimate && mSequence++ % mStats.decimation != 0) {
+        mStats.dropped++;
+        return;
+    }
+
+    int limit = mOptions.policy == TelemetryStream::Block ? mOptions.maxQueueSize : mOptions.queueSize;
+    if (mPending.size() >= limit) {
+        mPending.dequeue();
+        mStats.dropped++;
+        if (mOptions.policy == TelemetryStream::Decimate) {
+            mStats.decimation = qMin(mStats.decimation * 2, MAX_DECIMATION);
+        }
+    }
+
+    mPending.enqueue(frame);
+    mCondition.wakeOne();
+}
+
+void TelemetryStreamWriter::stop() {
+    QMutexLocker locker(&mMutex);
+    mStopRequested = true;
+    mCondition.wakeOne();
+}
+
+bool TelemetryStreamWriter::isStopRequested() const {
+    QMutexLocker locker(&mMutex);
+    return mStopRequested;
+}
+
+TelemetryStream::Stats TelemetryStreamWriter::stats() const {
+    QMutexLocker locker(&mMutex);
+    return mStats;
+}
+
+void TelemetryStreamWriter::run() {
+    QQueue<Global::TelemetryFrame> frames;
+    QByteArray batch;
+
+    while (!isStopRequested()) {
+        if (!openOutput()) {
+            return;
+        }
+
+        while (true) {
+            {
+                QMutexLocker locker(&mMutex);
+                if (mPending.isEmpty() && !mStopRequested) {
+                    mCondition.wait(&mMutex);
+                }
+                if (mStopRequested) {
+                    break;
+                }
+                // the consumer keeps up, take more frames again.
+                if (mStats.decimation > 1 && mPending.size() < mOptions.queueSize / 4) {
+                    mStats.decimation /= 2;
+                }
+                frames.swap(mPending);
+            }
+
+            batch.clear();
+            for (const auto &frame : qAsConst(frames)) {
+                Telemetry::appendFrameJson(batch, frame);
+            }
+            int count = frames.size();
+            frames.clear();
+
+            if (!writeAll(batch)) {
+                break;
+            }
+            QMutexLocker locker(&mMutex);
+            mStats.written += count;
+        }
+
+        closeOutput();
+        // stdout or a regular file is gone for good, a FIFO gets the next consumer.
+        if (mOptions.path == "-" || !mIsFifo) {
+            return;
+        }
+    }
+}
+
+#ifdef Q_OS_UNIX
+bool TelemetryStreamWriter::openOutput() {
+    mIsBlocking = mOptions.path == "-";
+    if (mIsBlocking) {
+        // shared with stderr and the terminal, so it isn't switched to O_NONBLOCK, see writeAll().
+        mFd = ::dup(STDOUT_FILENO);
+    } else {
+        // O_NONBLOCK: opening a FIFO without a reader fails instead of blocking, so stop() is noticed meanwhile.
+        // A path, which doesn't exist, becomes a regular file; a file is appended to.
+        while ((mFd = ::open(mOptions.path.toLocal8Bit().constData(),
+                             O_WRONLY | O_CREAT | O_APPEND | O_NONBLOCK | O_CLOEXEC, 0644)) < 0) {
+            if (errno != ENXIO) {
+                reportError(QObject::tr("Unable to open telemetry stream %1: %2")
+                                    .arg(mOptions.path, QString::fromLocal8Bit(::strerror(errno))));
+                return false;
+            }
+            if (isStopRequested()) {
+                return false;
+            }
+            QThread::msleep(STOP_CHECK_INTERVAL_MS);
+        }
+    }
+
+    if (mFd < 0) {
+        reportError(QObject::tr("Unable to open telemetry stream %1").arg(mOptions.path));
+        return false;
+    }
+    struct stat info = {};
+    mIsFifo = ::fstat(mFd, &info) == 0 && S_ISFIFO(info.st_mode);
+    return true;
+}
+
+void TelemetryStreamWriter::closeOutput() {
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+/**
+ * Blocks until the consumer takes everything, but wakes up regularly to see whether it is asked to stop. A blocking
+ * descriptor is only written when poll() says it takes PIPE_BUF bytes, and at most that many at once.
+ */
+bool TelemetryStreamWriter::writeAll(const QByteArray &data) {
+    const char *begin = data.constData();
+    qint64 left = data.size();
+    while (left > 0) {
+        if (mIsBlocking) {
+            pollfd descriptor = {mFd, POLLOUT, 0};
+            // an error or a hangup is ready too, the write reports it.
+            if (::poll(&descriptor, 1, STOP_CHECK_INTERVAL_MS) <= 0) {
+                if (isStopRequested()) {
+                    return false;
+                }
+                continue;
+            }
+        }
+
+        ssize_t written = ::write(mFd, begin, size_t(mIsBlocking ? qMin<qint64>(left, PIPE_BUF) : left));
+        if (written > 0) {
+            begin += written;
+            left -= written;
+            continue;
+        }
+        if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return false; // EPIPE: the consumer is gone
+        }
+
+        pollfd descriptor = {mFd, POLLOUT, 0};
+        ::poll(&descriptor, 1, STOP_CHECK_INTERVAL_MS);
+        if (isStopRequested()) {
+            return false;
+        }
+    }
+    return true;
+}
+#else
+bool TelemetryStreamWriter::openOutput() {
+    bool opened = mOptions.path == "-"
+            ? mFile.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered)
+            : (mFile.setFileName(mOptions.path), mFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered));
+    if (!opened) {
+        reportError(QObject::tr("Unable to open telemetry stream %1: %2").arg(mOptions.path, mFile.errorString()));
+    }
+    return opened;
+}
+
+void TelemetryStreamWriter::closeOutput() {
+    mFile.close();
+}
+
+bool TelemetryStreamWriter::writeAll(const QByteArray &data) {
+    return mFile.write(data) == data.size();
+}
+#endif
+
+void TelemetryStreamWriter::reportError(const QString &error) {
+    auto stream = mStream;
+    QMetaObject::invokeMethod(stream, [stream, error] () {
+        emit stream->onErrorOccurred(error);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,118 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_TELEMETRYSTREAM_H
+#define PS_MANAGEMENT_TELEMETRYSTREAM_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QFile>
+#include "Global.h"
+
+class TelemetryStreamWriter;
+
+/**
+ * Live telemetry for other processes: one NDJSON line per telemetry frame to stdout, a FIFO or a file, which is
+ * appended to. The process has to ignore SIGPIPE, so a consumer gone is reported as EPIPE.
+ *
+ * The frames wait in a bounded queue for a background writer, UpdateTelemetry() never waits for the consumer.
+ * When a slow consumer lets the queue fill up, the policy decides:
+ *   DropOldest -- the oldest frame is dropped;
+ *   Block      -- nothing is dropped, the writer blocks on the consumer and the queue grows up to maxQueueSize,
+ *                 only then the oldest frames are dropped;
+ *   Decimate   -- only every 2nd, 4th ... frame is queued until the consumer catches up.
+ * A FIFO consumer may come and go, the writer waits for the next one.
+ */
+class TelemetryStream : public QObject {
+    Q_OBJECT
+public:
+    enum Policy {
+        DropOldest,
+        Block,
+        Decimate,
+    };
+
+    struct Options {
+        QString path = "-";             // "-" -- stdout
+        Policy  policy = DropOldest;
+        int     queueSize = 256;        // frames
+        int     maxQueueSize = 65536;   // frames, Block
+    };
+
+    struct Stats {
+        quint64 written = 0;
+        quint64 dropped = 0;     // dropped and decimated frames
+        int     decimation = 1;  // every n-th frame is queued
+    };
+
+    explicit TelemetryStream(QObject *parent = nullptr);
+    ~TelemetryStream() override;
+
+    bool isRunning() const;
+    Stats stats() const;
+
+    static Policy policyFromString(const QString &name);
+
+signals:
+    void onErrorOccurred(QString error);
+
+public slots:
+    void Start(const TelemetryStream::Options &options);
+    void Stop();
+
+    void UpdateTelemetry(const Global::TelemetryFrame &frame);
+
+private:
+    TelemetryStreamWriter *mWriter = nullptr;
+};
+
+class TelemetryStreamWriter : public QThread {
+public:
+    TelemetryStreamWriter(TelemetryStream *stream, const TelemetryStream::Options &options);
+    ~TelemetryStreamWriter() override;
+
+    void append(const Global::TelemetryFrame &frame);
+    void stop();
+    TelemetryStream::Stats stats() const;
+
+protected:
+    void run() override;
+
+private:
+    bool isStopRequested() const;
+    bool openOutput();
+    void closeOutput();
+    bool writeAll(const QByteArray &data);
+    void reportError(const QString &error);
+
+private:
+    TelemetryStream                 *mStream;
+    TelemetryStream::Options        mOptions;
+
+    mutable QMutex                  mMutex;
+    QWaitCondition                  mCondition;
+    QQueue<Global::TelemetryFrame>  mPending;
+    TelemetryStream::Stats          mStats;
+    quint64                         mSequence = 0;
+    bool                            mStopRequested = false;
+
+    int                             mFd = -1;
+    bool                            mIsFifo = false;
+    bool                            mIsBlocking = false;  // stdout, its file description isn't ours to change
+    QFile                           mFile;
+};
+
+#endif //PS_MANAGEMENT_TELEMETRYSTREAM_H
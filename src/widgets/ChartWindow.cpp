@@ -0,0 +1,73 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ChartWindow.h"
+#include <QVBoxLayout>
+#include <QGroupBox>
+#include <QCloseEvent>
+
+ChartWindow::ChartWindow(QWidget *parent) : QWidget(parent, Qt::Tool) {
+    setupUI();
+}
+
+void ChartWindow::setupUI() {
+    setWindowTitle(tr("Charts"));
+    resize(QSize(560, 542));
+
+    auto layout = new QVBoxLayout(this);
+    mPlots[Global::Channel1] = createPlot(tr("CH1"));
+    mPlots[Global::Channel2] = createPlot(tr("CH2"));
+    layout->addWidget(mPlots[Global::Channel1]->parentWidget());
+    layout->addWidget(mPlots[Global::Channel2]->parentWidget());
+
+    mLastVoltage[Global::Channel1] = 0.0;
+    mLastVoltage[Global::Channel2] = 0.0;
+}
+
+PlotWidget *ChartWindow::createPlot(const QString &title) {
+    auto groupBox = new QGroupBox(title, this);
+    auto layout = new QVBoxLayout(groupBox);
+    layout->setContentsMargins(4, 4, 4, 4);
+
+    auto plot = new PlotWidget(groupBox);
+    plot->addSeries(tr("V"), tr("V"), 2, QColor(0, 160, 0));
+    plot->addSeries(tr("I"), tr("A"), 3, QColor(210, 0, 0));
+    plot->addSeries(tr("P"), tr("W"), 2, QColor(0, 90, 210));
+    layout->addWidget(plot);
+
+    return plot;
+}
+
+void ChartWindow::appendVoltage(Global::Channel channel, qint64 timestamp, double voltage) {
+    mLastVoltage[channel] = voltage;
+    mPlots[channel]->append(Voltage, timestamp, voltage);
+}
+
+void ChartWindow::appendCurrent(Global::Channel channel, qint64 timestamp, double current) {
+    auto plot = mPlots[channel];
+    plot->append(Current, timestamp, current);
+    plot->append(Power, timestamp, mLastVoltage[channel] * current);
+}
+
+void ChartWindow::clear() {
+    for (auto plot : qAsConst(mPlots)) {
+        plot->clear();
+    }
+    mLastVoltage[Global::Channel1] = 0.0;
+    mLastVoltage[Global::Channel2] = 0.0;
+}
+
+void ChartWindow::closeEvent(QCloseEvent *event) {
+    QWidget::closeEvent(event);
+    emit onClosed();
+}
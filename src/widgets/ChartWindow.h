@@ -0,0 +1,53 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_CHARTWINDOW_H
+#define PS_MANAGEMENT_CHARTWINDOW_H
+
+#include <QWidget>
+#include <QMap>
+#include "Global.h"
+#include "PlotWidget.h"
+
+class ChartWindow : public QWidget {
+Q_OBJECT
+public:
+    explicit ChartWindow(QWidget *parent);
+
+    void appendVoltage(Global::Channel channel, qint64 timestamp, double voltage);
+    void appendCurrent(Global::Channel channel, qint64 timestamp, double current);
+    void clear();
+
+signals:
+    void onClosed();
+
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
+private:
+    void setupUI();
+    PlotWidget *createPlot(const QString &title);
+
+private:
+    enum Series {
+        Voltage,
+        Current,
+        Power,
+    };
+
+    QMap<Global::Channel, PlotWidget*>  mPlots;
+    QMap<Global::Channel, double>       mLastVoltage;
+};
+
+
+#endif //PS_MANAGEMENT_CHARTWINDOW_H
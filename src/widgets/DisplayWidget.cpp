@@ -25,7 +25,10 @@ const char* const STYLE_BG_RED = "background-color: rgb(210, 0, 0)";
 const char* const STYLE_BG_GREEN = "background-color: rgb(0, 210, 0)";
 const char* const STYLE_BG_NONE = "";
 
+const int DEFAULT_REFRESH_RATE = 25; // fps
+
 DisplayWidget::DisplayWidget(QWidget *parent) : QWidget(parent) {
+    setMaximumRefreshRate(DEFAULT_REFRESH_RATE);
     setupUI();
 }
 
@@ -81,19 +84,68 @@ QLCDNumber *DisplayWidget::createLCD() {
 }
 
 void DisplayWidget::displayCurrent(double value) {
-    mDisplayCurrent->display(QString::asprintf("%05.03f", value));
+    mCurrent = qRound(value * 1000);
+    scheduleRefresh();
 }
 
 void DisplayWidget::displayVoltage(double value) {
-    mDisplayVoltage->display(QString::asprintf("%05.02f", value));
+    mVoltage = qRound(value * 100);
+    scheduleRefresh();
 }
 
 void DisplayWidget::constantCurrent() {
-    mLabelCC->setStyleSheet(STYLE_BG_RED);
-    mLabelCV->setStyleSheet(STYLE_BG_NONE);
+    mMode = ModeConstantCurrent;
+    scheduleRefresh();
 }
 
 void DisplayWidget::constantVoltage() {
-    mLabelCV->setStyleSheet(STYLE_BG_GREEN);
-    mLabelCC->setStyleSheet(STYLE_BG_NONE);
+    mMode = ModeConstantVoltage;
+    scheduleRefresh();
+}
+
+void DisplayWidget::setMaximumRefreshRate(int fps) {
+    mRefreshInterval = 1000 / qBound(1, fps, 120);
+}
+
+void DisplayWidget::scheduleRefresh() {
+    if (mRefreshTimer.isActive()) {
+        return;
+    }
+    if (mVoltage == mShownVoltage && mCurrent == mShownCurrent && mMode == mShownMode) {
+        return;
+    }
+    mRefreshTimer.start(mRefreshInterval, this);
+}
+
+void DisplayWidget::timerEvent(QTimerEvent *event) {
+    if (event->timerId() != mRefreshTimer.timerId()) {
+        QWidget::timerEvent(event);
+        return;
+    }
+
+    mRefreshTimer.stop();
+    refresh();
+}
+
+void DisplayWidget::refresh() {
+    if (mVoltage != mShownVoltage) {
+        mShownVoltage = mVoltage;
+        mDisplayVoltage->display(QString::asprintf("%05.02f", mVoltage / 100.0));
+    }
+
+    if (mCurrent != mShownCurrent) {
+        mShownCurrent = mCurrent;
+        mDisplayCurrent->display(QString::asprintf("%05.03f", mCurrent / 1000.0));
+    }
+
+    if (mMode != mShownMode) {
+        mShownMode = mMode;
+        if (mMode == ModeConstantCurrent) {
+            mLabelCC->setStyleSheet(STYLE_BG_RED);
+            mLabelCV->setStyleSheet(STYLE_BG_NONE);
+        } else {
+            mLabelCV->setStyleSheet(STYLE_BG_GREEN);
+            mLabelCC->setStyleSheet(STYLE_BG_NONE);
+        }
+    }
 }
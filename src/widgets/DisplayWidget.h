@@ -22,7 +22,12 @@
 #include <QLabel>
 #include <QVBoxLayout>
 #include <QFormLayout>
+#include <QBasicTimer>
 
+/**
+ * Values passed to display*() and constant*() are only remembered; they are applied to the LCDs and
+ * mode labels at most once per refresh interval, and only if they differ from what is already shown.
+ */
 class DisplayWidget : public QWidget {
 Q_OBJECT
 public:
@@ -33,16 +38,40 @@ public:
     void constantVoltage();
     void constantCurrent();
 
+    void setMaximumRefreshRate(int fps);
+    void refresh();
+
+protected:
+    void timerEvent(QTimerEvent *event) override;
+
 private:
     void setupUI();
     QLabel *createLabel(const QString &text, int fontSize);
     QLCDNumber *createLCD();
+    void scheduleRefresh();
 
 private:
+    enum Mode {
+        ModeUnknown,
+        ModeConstantVoltage,
+        ModeConstantCurrent,
+    };
+
     QLCDNumber* mDisplayVoltage;
     QLCDNumber* mDisplayCurrent;
     QLabel*     mLabelCV;
     QLabel*     mLabelCC;
+
+    QBasicTimer mRefreshTimer;
+    int         mRefreshInterval;
+
+    // in display units: 10 mV and 1 mA
+    int         mVoltage = 0;
+    int         mCurrent = 0;
+    Mode        mMode = ModeUnknown;
+    int         mShownVoltage = -1;
+    int         mShownCurrent = -1;
+    Mode        mShownMode = ModeUnknown;
 };
 
 
@@ -34,7 +34,8 @@ void OutputSwitch::setupUI() {
     setCheckable(true);
     setChecked(false);
     applyStyle(customStyle(mBackgroundColorDefault));
-    connect(this, &QPushButton::clicked, this, &OutputSwitch::SetSwitchOn);
+    // queued, so the style update doesn't delay the output switch command.
+    connect(this, &QPushButton::clicked, this, &OutputSwitch::SetSwitchOn, Qt::QueuedConnection);
 }
 
 void OutputSwitch::SetSwitchOn(bool on) {
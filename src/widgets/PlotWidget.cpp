@@ -0,0 +1,294 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PlotWidget.h"
+#include "telemetry/Downsampling.h"
+
+#include <QPainter>
+#include <QPolygonF>
+#include <QMenu>
+#include <QContextMenuEvent>
+#include <algorithm>
+#include <cmath>
+
+const qint64 HISTORY_LIMIT_MS = 24 * 3600 * 1000LL;
+const qint64 DEFAULT_TIME_SPAN_MS = 5 * 60 * 1000LL;
+const double RANGE_MARGIN = 0.1;
+const double RANGE_MIN_SPAN = 0.05;
+const int LEGEND_MARGIN = 4;
+
+PlotWidget::PlotWidget(QWidget *parent) : QWidget(parent), mTimeSpan(DEFAULT_TIME_SPAN_MS) {
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(QSize(240, 120));
+}
+
+int PlotWidget::addSeries(const QString &name, const QString &unit, int decimals, const QColor &color) {
+    Series series;
+    series.name = name;
+    series.unit = unit;
+    series.decimals = decimals;
+    series.color = color;
+    mSeries.append(series);
+    mFullRedraw = true;
+
+    return mSeries.size() - 1;
+}
+
+void PlotWidget::append(int index, qint64 timestamp, double value) {
+    auto &series = mSeries[index];
+    if (!series.time.isEmpty() && timestamp < series.time.last()) {
+        return; // keep the history sorted, lower_bound relies on it
+    }
+
+    series.time.append(timestamp);
+    series.value.append(float(value));
+    mLastTime = qMax(mLastTime, timestamp);
+
+    if (fitRange(series, value)) {
+        mFullRedraw = true;
+    }
+    trimHistory(series);
+    update();
+}
+
+void PlotWidget::clear() {
+    for (auto &series : mSeries) {
+        series.time.clear();
+        series.value.clear();
+        series.min = series.max = 0.0;
+        series.drawn = 0;
+    }
+    mLastTime = 0;
+    mViewEnd = 0.0;
+    mFullRedraw = true;
+    update();
+}
+
+void PlotWidget::setTimeSpan(qint64 ms) {
+    mTimeSpan = qMax(ms, qint64(1000));
+    mFullRedraw = true;
+    update();
+}
+
+qint64 PlotWidget::timeSpan() const {
+    return mTimeSpan;
+}
+
+QRect PlotWidget::plotRect() const {
+    int legendHeight = fontMetrics().height() + LEGEND_MARGIN * 2;
+    return rect().adjusted(1, legendHeight, -1, -1);
+}
+
+double PlotWidget::mapX(qint64 time) const {
+    QRect r = plotRect();
+    double msPerPixel = double(mTimeSpan) / r.width();
+    return r.right() - (mViewEnd - double(time)) / msPerPixel;
+}
+
+double PlotWidget::mapY(const Series &series, double value) const {
+    QRect r = plotRect();
+    double span = series.max - series.min;
+    if (span <= 0.0) {
+        return r.center().y();
+    }
+    return r.bottom() - (value - series.min) / span * r.height();
+}
+
+void PlotWidget::setRange(Series &series, double low, double high) {
+    double margin = qMax((high - low) * RANGE_MARGIN, RANGE_MIN_SPAN);
+    series.min = low - margin;
+    series.max = high + margin;
+}
+
+bool PlotWidget::fitRange(Series &series, double value) {
+    if (series.value.size() == 1) {
+        setRange(series, value, value);
+        return true;
+    }
+    if (value >= series.min && value <= series.max) {
+        return false;
+    }
+
+    setRange(series, qMin(series.min, value), qMax(series.max, value));
+    return true;
+}
+
+void PlotWidget::trimHistory(Series &series) {
+    qint64 oldest = series.time.last() - HISTORY_LIMIT_MS;
+    if (series.time.first() >= oldest) {
+        return;
+    }
+
+    // remove in chunks, so the cost is amortized over many samples
+    int cut = int(std::lower_bound(series.time.begin(), series.time.end(), oldest) - series.time.begin());
+    if (cut < series.time.size() / 8) {
+        return;
+    }
+    series.time.remove(0, cut);
+    series.value.remove(0, cut);
+    series.drawn = qMax(series.drawn - cut, 0);
+}
+
+void PlotWidget::drawBackground(QPainter &painter, const QRect &rect) {
+    QRect r = plotRect();
+    painter.fillRect(rect, palette().color(QPalette::Base));
+    painter.setPen(QPen(palette().color(QPalette::Midlight), 1, Qt::DotLine));
+    for (int i = 1; i < 4; ++i) {
+        int y = r.top() + r.height() * i / 4;
+        painter.drawLine(rect.left(), y, rect.right(), y);
+    }
+}
+
+void PlotWidget::redrawAll() {
+    if (mCache.size() != size()) {
+        mCache = QPixmap(size());
+    }
+    mCache.fill(palette().color(QPalette::Window));
+    mViewEnd = double(mLastTime);
+
+    QRect r = plotRect();
+    QPainter painter(&mCache);
+    drawBackground(painter, r);
+    painter.setClipRect(r);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    qint64 start = mLastTime - mTimeSpan;
+    for (auto &series : mSeries) {
+        series.drawn = series.value.size();
+        int first = int(std::lower_bound(series.time.begin(), series.time.end(), start) - series.time.begin());
+        first = qMax(first - 1, 0); // let the line enter from the left edge
+        int count = series.value.size() - first;
+        if (count <= 0) {
+            continue;
+        }
+
+        // shrink the range to what is visible now
+        const float *value = series.value.constData() + first;
+        auto minmax = std::minmax_element(value, value + count);
+        setRange(series, *minmax.first, *minmax.second);
+
+        auto indices = Telemetry::lttb(series.time.constData() + first, value, count, r.width() * 2);
+        QPolygonF polyline;
+        polyline.reserve(indices.size());
+        for (int i : qAsConst(indices)) {
+            polyline << QPointF(mapX(series.time.at(first + i)), mapY(series, value[i]));
+        }
+        painter.setPen(QPen(series.color, 1.5));
+        painter.drawPolyline(polyline);
+    }
+
+    mFullRedraw = false;
+}
+
+void PlotWidget::drawPending() {
+    QRect r = plotRect();
+    double msPerPixel = double(mTimeSpan) / r.width();
+    if (mLastTime > mViewEnd) {
+        int pixels = int(std::ceil((mLastTime - mViewEnd) / msPerPixel));
+        if (pixels >= r.width()) {
+            redrawAll();
+            return;
+        }
+
+        mCache.scroll(-pixels, 0, r);
+        mViewEnd += pixels * msPerPixel;
+        QPainter painter(&mCache);
+        drawBackground(painter, QRect(r.right() - pixels + 1, r.top(), pixels, r.height()));
+    }
+
+    QPainter painter(&mCache);
+    painter.setClipRect(r);
+    painter.setRenderHint(QPainter::Antialiasing);
+    for (auto &series : mSeries) {
+        int size = series.value.size();
+        if (series.drawn >= size) {
+            continue;
+        }
+
+        QPolygonF polyline;
+        polyline.reserve(size - series.drawn + 1);
+        for (int i = qMax(series.drawn - 1, 0); i < size; ++i) {
+            polyline << QPointF(mapX(series.time.at(i)), mapY(series, series.value.at(i)));
+        }
+        painter.setPen(QPen(series.color, 1.5));
+        painter.drawPolyline(polyline);
+        series.drawn = size;
+    }
+}
+
+void PlotWidget::drawLegend(QPainter &painter) {
+    int x = LEGEND_MARGIN;
+    int y = LEGEND_MARGIN + fontMetrics().ascent();
+    for (const auto &series : qAsConst(mSeries)) {
+        QString text = series.name;
+        if (!series.value.isEmpty()) {
+            text = QString("%1 %2 %3  [%4..%5]").arg(series.name)
+                    .arg(double(series.value.last()), 0, 'f', series.decimals).arg(series.unit)
+                    .arg(series.min, 0, 'f', series.decimals).arg(series.max, 0, 'f', series.decimals);
+        }
+        painter.setPen(series.color);
+        painter.drawText(x, y, text);
+        x += fontMetrics().horizontalAdvance(text) + LEGEND_MARGIN * 4;
+    }
+
+    QString span = mTimeSpan >= 3600 * 1000 ? tr("%1 h").arg(mTimeSpan / (3600 * 1000))
+                                            : tr("%1 min").arg(mTimeSpan / (60 * 1000));
+    painter.setPen(palette().color(QPalette::WindowText));
+    painter.drawText(width() - fontMetrics().horizontalAdvance(span) - LEGEND_MARGIN, y, span);
+    painter.setPen(palette().color(QPalette::Mid));
+    painter.drawRect(plotRect().adjusted(-1, -1, 0, 0));
+}
+
+void PlotWidget::paintEvent(QPaintEvent *) {
+    if (mFullRedraw || mCache.size() != size()) {
+        redrawAll();
+    } else {
+        drawPending();
+    }
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, mCache);
+    drawLegend(painter);
+}
+
+void PlotWidget::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    mFullRedraw = true;
+}
+
+void PlotWidget::contextMenuEvent(QContextMenuEvent *event) {
+    const QList<QPair<QString, qint64>> spans = {
+            {tr("1 min"),  60 * 1000LL},
+            {tr("5 min"),  5 * 60 * 1000LL},
+            {tr("30 min"), 30 * 60 * 1000LL},
+            {tr("1 h"),    3600 * 1000LL},
+            {tr("24 h"),   HISTORY_LIMIT_MS},
+    };
+
+    QMenu menu(this);
+    for (const auto &span : spans) {
+        auto action = menu.addAction(span.first);
+        action->setCheckable(true);
+        action->setChecked(span.second == mTimeSpan);
+        action->setData(span.second);
+    }
+    menu.addSeparator();
+    auto clearAction = menu.addAction(tr("Clear"));
+
+    auto chosen = menu.exec(event->globalPos());
+    if (chosen == clearAction) {
+        clear();
+    } else if (chosen != nullptr) {
+        setTimeSpan(chosen->data().toLongLong());
+    }
+}
@@ -0,0 +1,79 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PS_MANAGEMENT_PLOTWIDGET_H
+#define PS_MANAGEMENT_PLOTWIDGET_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <QVector>
+#include <QColor>
+
+/**
+ * Time-series plot. The plot area is cached in a pixmap of the widget size: new points are drawn
+ * as segments on top of the cache, which is scrolled by whole pixels when time advances. The whole
+ * plot is redrawn only on resize, time span or range change, with the history reduced by LTTB
+ * to the plot width, so even a 24 hours history is a few thousand line segments.
+ */
+class PlotWidget : public QWidget {
+Q_OBJECT
+public:
+    explicit PlotWidget(QWidget *parent);
+
+    int addSeries(const QString &name, const QString &unit, int decimals, const QColor &color);
+    void append(int series, qint64 timestamp, double value);
+    void clear();
+
+    void setTimeSpan(qint64 ms);
+    qint64 timeSpan() const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+
+private:
+    struct Series {
+        QString         name;
+        QString         unit;
+        int             decimals = 2;
+        QColor          color;
+        QVector<qint64> time;  // ms
+        QVector<float>  value;
+        double          min = 0.0;
+        double          max = 0.0;
+        int             drawn = 0; // points already rendered into the cache
+    };
+
+    QRect plotRect() const;
+    double mapX(qint64 time) const;
+    double mapY(const Series &series, double value) const;
+    static void setRange(Series &series, double low, double high);
+    bool fitRange(Series &series, double value);
+    void trimHistory(Series &series);
+    void redrawAll();
+    void drawPending();
+    void drawBackground(QPainter &painter, const QRect &rect);
+    void drawLegend(QPainter &painter);
+
+private:
+    QVector<Series> mSeries;
+    QPixmap         mCache;
+    qint64          mTimeSpan;
+    qint64          mLastTime = 0;
+    double          mViewEnd = 0.0; // ms, time at the right edge of the plot
+    bool            mFullRedraw = true;
+};
+
+
+#endif //PS_MANAGEMENT_PLOTWIDGET_H
@@ -0,0 +1,71 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include "AdaptiveSampler.h"
+
+class AdaptiveSamplerTest : public QObject {
+    Q_OBJECT
+private slots:
+    void startsAtActiveRate();
+    void flatReadingsDecayToIdleRate();
+    void changeRestoresActiveRate();
+};
+
+void AdaptiveSamplerTest::startsAtActiveRate() {
+    AdaptiveSampler sampler;
+    sampler.reset(1000);
+
+    QCOMPARE(sampler.rate(), 10.0);
+    QVERIFY(sampler.isDue(AdaptiveSampler::Voltage, 1000));
+
+    sampler.sampled(AdaptiveSampler::Voltage, 1000);
+    QVERIFY(!sampler.isDue(AdaptiveSampler::Voltage, 1050));
+    QVERIFY(sampler.isDue(AdaptiveSampler::Voltage, 1100));
+    QVERIFY(sampler.isDue(AdaptiveSampler::Current, 1000));
+}
+
+void AdaptiveSamplerTest::flatReadingsDecayToIdleRate() {
+    AdaptiveSampler sampler;
+    sampler.reset(0);
+
+    for (qint64 now = 0; now <= 1000; now += 100) {
+        sampler.update(AdaptiveSampler::Voltage, 12.0, now);
+    }
+    QCOMPARE(sampler.rate(), 5.0);
+
+    for (qint64 now = 1100; now <= 6000; now += 100) {
+        sampler.update(AdaptiveSampler::Voltage, 12.0, now);
+    }
+    QCOMPARE(sampler.rate(), 1.0);
+}
+
+void AdaptiveSamplerTest::changeRestoresActiveRate() {
+    AdaptiveSampler sampler;
+    sampler.reset(0);
+    for (qint64 now = 0; now <= 5000; now += 100) {
+        sampler.update(AdaptiveSampler::Current, 0.5, now);
+    }
+    QCOMPARE(sampler.rate(), 1.0);
+
+    // below the threshold, still flat.
+    sampler.update(AdaptiveSampler::Current, 0.503, 5100);
+    QCOMPARE(sampler.rate(), 1.0);
+
+    sampler.update(AdaptiveSampler::Current, 0.6, 5200);
+    QCOMPARE(sampler.rate(), 10.0);
+}
+
+QTEST_APPLESS_MAIN(AdaptiveSamplerTest)
+
+#include "AdaptiveSamplerTest.moc"
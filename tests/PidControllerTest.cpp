@@ -0,0 +1,79 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include "automation/PidController.h"
+
+class PidControllerTest : public QObject {
+    Q_OBJECT
+private slots:
+    void proportional();
+    void outputIsClamped();
+    void integratorDoesntWindUp();
+    void integratorIsHeld();
+    void derivativeOnMeasurement();
+};
+
+static PidController::Gains makeGains(double kp, double ki, double kd) {
+    PidController::Gains gains;
+    gains.kp = kp;
+    gains.ki = ki;
+    gains.kd = kd;
+    return gains;
+}
+
+void PidControllerTest::proportional() {
+    PidController controller(makeGains(1, 0, 0), 0, 10);
+    controller.reset(2);
+    QCOMPARE(controller.update(1, 2, 0.1), 3.0);
+    QCOMPARE(controller.update(-0.5, 3, 0.1), 1.5);
+}
+
+void PidControllerTest::outputIsClamped() {
+    PidController controller(makeGains(100, 0, 0), 0, 10);
+    controller.reset(20);
+    QCOMPARE(controller.output(), 10.0);
+    QCOMPARE(controller.update(1, 5, 0.1), 10.0);
+    QCOMPARE(controller.update(-1, 5, 0.1), 0.0);
+}
+
+void PidControllerTest::integratorDoesntWindUp() {
+    PidController controller(makeGains(0, 10, 0), 0, 1);
+    controller.reset(0);
+    for (int i = 0; i < 10; i++) {
+        controller.update(1, 0, 1);
+    }
+    QCOMPARE(controller.output(), 1.0);
+
+    // the output leaves the limit with the first error of the other sign.
+    QVERIFY(qAbs(controller.update(-0.5, 1, 0.1) - 0.5) < 1e-9);
+}
+
+void PidControllerTest::integratorIsHeld() {
+    PidController controller(makeGains(0, 1, 0), 0, 10);
+    controller.reset(1);
+    QCOMPARE(controller.update(1, 1, 1, true), 1.0);
+    QCOMPARE(controller.update(1, 1, 1), 2.0);
+}
+
+void PidControllerTest::derivativeOnMeasurement() {
+    PidController controller(makeGains(0, 0, 1), 0, 10);
+    controller.reset(5);
+    QCOMPARE(controller.update(0, 1, 0.5), 5.0);
+    // the measurement rises by 2/s, the output goes down by kd * 2.
+    QCOMPARE(controller.update(0, 2, 0.5), 3.0);
+}
+
+QTEST_APPLESS_MAIN(PidControllerTest)
+
+#include "PidControllerTest.moc"
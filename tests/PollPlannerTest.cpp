@@ -0,0 +1,83 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include "PollPlanner.h"
+
+class PollPlannerTest : public QObject {
+    Q_OBJECT
+private slots:
+    void periodIsNearestPowerOfTwo();
+    void channelFieldsArePolledOnBothChannels();
+    void equalPeriodsAreSpreadOverSlots();
+    void lowPriorityIsSlowedFirst();
+};
+
+void PollPlannerTest::periodIsNearestPowerOfTwo() {
+    PollPlanner planner;
+    planner.setTickInterval(100);
+    planner.setRate(PollPlanner::DeviceStatus, 10, PollPlanner::PriorityHigh);
+    planner.setRate(PollPlanner::VoltageSet, 3, PollPlanner::PriorityNormal);
+    planner.setRate(PollPlanner::Preset, 0, PollPlanner::PriorityLow);
+    planner.compile();
+
+    QCOMPARE(planner.scheduledRate(PollPlanner::DeviceStatus), 10.0);
+    QCOMPARE(planner.scheduledRate(PollPlanner::VoltageSet), 2.5);
+    QCOMPARE(planner.scheduledRate(PollPlanner::Preset), 0.0);
+    QCOMPARE(planner.schedule().size(), 4);
+}
+
+void PollPlannerTest::channelFieldsArePolledOnBothChannels() {
+    PollPlanner planner;
+    planner.setTickInterval(100);
+    planner.setRate(PollPlanner::ActualVoltage, 10, PollPlanner::PriorityHigh);
+    planner.compile();
+
+    QCOMPARE(planner.schedule().size(), 1);
+    const auto &slot = planner.schedule().first();
+    QCOMPARE(slot.size(), 2);
+    QCOMPARE(slot.at(0).channel, Global::Channel1);
+    QCOMPARE(slot.at(1).channel, Global::Channel2);
+    QCOMPARE(planner.scheduledLoad(), 20.0);
+}
+
+void PollPlannerTest::equalPeriodsAreSpreadOverSlots() {
+    PollPlanner planner;
+    planner.setTickInterval(100);
+    planner.setRate(PollPlanner::DeviceStatus, 5, PollPlanner::PriorityNormal);
+    planner.setRate(PollPlanner::Locked, 5, PollPlanner::PriorityNormal);
+    planner.compile();
+
+    QCOMPARE(planner.schedule().size(), 2);
+    QCOMPARE(planner.schedule().at(0).size(), 1);
+    QCOMPARE(planner.schedule().at(1).size(), 1);
+}
+
+void PollPlannerTest::lowPriorityIsSlowedFirst() {
+    PollPlanner planner;
+    planner.setTickInterval(100);
+    planner.setRate(PollPlanner::DeviceStatus, 10, PollPlanner::PriorityHigh);
+    planner.setRate(PollPlanner::ActualVoltage, 10, PollPlanner::PriorityNormal);
+    planner.setRate(PollPlanner::Preset, 10, PollPlanner::PriorityLow);
+    planner.setLinkCapacity(35);
+    planner.compile();
+
+    QCOMPARE(planner.scheduledRate(PollPlanner::DeviceStatus), 10.0);
+    QCOMPARE(planner.scheduledRate(PollPlanner::ActualVoltage), 10.0);
+    QCOMPARE(planner.scheduledRate(PollPlanner::Preset), 5.0);
+    QVERIFY(planner.scheduledLoad() <= planner.linkCapacity());
+}
+
+QTEST_APPLESS_MAIN(PollPlannerTest)
+
+#include "PollPlannerTest.moc"
@@ -0,0 +1,96 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include "ProtectionEngine.h"
+
+#define SECOND 1000000000LL
+
+class ProtectionEngineTest : public QObject {
+    Q_OBJECT
+private slots:
+    void powerTripsOnce();
+    void currentSlewRate();
+    void energy();
+    void otherChannelIsIgnored();
+};
+
+static ProtectionEngine::Rule makeRule(ProtectionEngine::Condition condition, double threshold,
+                                       Global::Channel channel = Global::Channel1) {
+    ProtectionEngine::Rule rule;
+    rule.condition = condition;
+    rule.channel = channel;
+    rule.threshold = threshold;
+    return rule;
+}
+
+void ProtectionEngineTest::powerTripsOnce() {
+    ProtectionEngine engine;
+    engine.setRules({makeRule(ProtectionEngine::PowerAbove, 10)});
+
+    // the power isn't known before both readings.
+    QVERIFY(engine.updateVoltage(Global::Channel1, 5, SECOND).isEmpty());
+
+    auto trips = engine.updateCurrent(Global::Channel1, 3, SECOND);
+    QCOMPARE(trips.size(), 1);
+    QCOMPARE(trips.first().rule, 0);
+    QCOMPARE(trips.first().value, 15.0);
+
+    QVERIFY(engine.updateCurrent(Global::Channel1, 4, 2 * SECOND).isEmpty());
+
+    engine.arm();
+    engine.updateVoltage(Global::Channel1, 5, 3 * SECOND);
+    QCOMPARE(engine.updateCurrent(Global::Channel1, 4, 3 * SECOND).size(), 1);
+}
+
+void ProtectionEngineTest::currentSlewRate() {
+    ProtectionEngine engine;
+    engine.setRules({makeRule(ProtectionEngine::CurrentSlewRateAbove, 5)});
+
+    QVERIFY(engine.updateCurrent(Global::Channel1, 0, SECOND).isEmpty());
+    QVERIFY(engine.updateCurrent(Global::Channel1, 0.4, 2 * SECOND).isEmpty());
+
+    auto trips = engine.updateCurrent(Global::Channel1, 1.4, 2 * SECOND + SECOND / 10);
+    QCOMPARE(trips.size(), 1);
+    QCOMPARE(trips.first().value, 10.0);
+}
+
+void ProtectionEngineTest::energy() {
+    ProtectionEngine engine;
+    engine.setRules({makeRule(ProtectionEngine::EnergyAbove, 5)});
+
+    engine.updateVoltage(Global::Channel1, 10, 1);
+    QVERIFY(engine.updateCurrent(Global::Channel1, 1, 1).isEmpty());
+
+    // 10 W for half an hour.
+    QVERIFY(engine.updateVoltage(Global::Channel1, 10, 1 + 1800 * SECOND).isEmpty());
+
+    auto trips = engine.updateVoltage(Global::Channel1, 10, 1 + 3600 * SECOND);
+    QCOMPARE(trips.size(), 1);
+    QCOMPARE(trips.first().value, 10.0);
+}
+
+void ProtectionEngineTest::otherChannelIsIgnored() {
+    ProtectionEngine engine;
+    engine.setRules({makeRule(ProtectionEngine::PowerAbove, 1, Global::Channel2)});
+
+    engine.updateVoltage(Global::Channel1, 30, SECOND);
+    QVERIFY(engine.updateCurrent(Global::Channel1, 3, SECOND).isEmpty());
+
+    engine.updateVoltage(Global::Channel2, 30, SECOND);
+    QCOMPARE(engine.updateCurrent(Global::Channel2, 3, SECOND).size(), 1);
+}
+
+QTEST_APPLESS_MAIN(ProtectionEngineTest)
+
+#include "ProtectionEngineTest.moc"
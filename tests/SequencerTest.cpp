@@ -0,0 +1,60 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include <QTemporaryFile>
+#include "automation/Sequencer.h"
+
+class SequencerTest : public QObject {
+    Q_OBJECT
+private slots:
+    void protectionTripStops();
+};
+
+void SequencerTest::protectionTripStops() {
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    // nothing is due at the start, so nothing is written to the closed port.
+    file.write("WAIT 10s\n"
+               "LOOP\n"
+               "  VSET 1 5\n"
+               "  OUT on\n"
+               "  WAIT 1s\n"
+               "END\n");
+    file.close();
+
+    Global::DeviceInfo info {};
+    info.Name = "test";
+    info.ActiveChannelsCount = 1;
+    info.MaxVoltage = 30;
+    info.MaxCurrent = 3;
+
+    Communication communication;
+    Sequencer sequencer(&communication);
+    QVector<Sequencer::Report> reports;
+    connect(&sequencer, &Sequencer::onFinished, this, [&reports] (const Sequencer::Report &report) {
+        reports << report;
+    });
+
+    sequencer.Start(file.fileName(), info);
+    QVERIFY(sequencer.isRunning());
+
+    emit communication.onProtectionTripped("P 12 W above 10 W", 1.5);
+    QVERIFY(!sequencer.isRunning());
+    QCOMPARE(reports.size(), 1);
+    QVERIFY(!reports.first().isCompleted);
+}
+
+QTEST_GUILESS_MAIN(SequencerTest)
+
+#include "SequencerTest.moc"
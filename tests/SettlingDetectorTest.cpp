@@ -0,0 +1,67 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include "automation/SettlingDetector.h"
+
+class SettlingDetectorTest : public QObject {
+    Q_OBJECT
+private slots:
+    void emptyIsNotSettled();
+    void settlesWithinTolerance();
+    void windowWrapsAround();
+};
+
+void SettlingDetectorTest::emptyIsNotSettled() {
+    SettlingDetector detector(3, 0.01);
+    QVERIFY(detector.isEmpty());
+    QVERIFY(!detector.isSettled());
+
+    detector.add(1.0);
+    detector.add(1.0);
+    QVERIFY(!detector.isEmpty());
+    QVERIFY(!detector.isSettled());
+}
+
+void SettlingDetectorTest::settlesWithinTolerance() {
+    SettlingDetector detector(3, 0.01);
+    for (double value : {0.0, 0.5, 0.9, 0.995, 1.0}) {
+        detector.add(value);
+    }
+    QVERIFY(!detector.isSettled());
+
+    detector.add(1.002);
+    QVERIFY(detector.isSettled());
+    QCOMPARE(detector.last(), 1.002);
+
+    detector.reset();
+    QVERIFY(detector.isEmpty());
+    QVERIFY(!detector.isSettled());
+}
+
+void SettlingDetectorTest::windowWrapsAround() {
+    SettlingDetector detector(4, 0.001);
+    for (int i = 0; i < 40; ++i) {
+        detector.add(i);
+    }
+    QVERIFY(!detector.isSettled());
+
+    for (int i = 0; i < 4; ++i) {
+        detector.add(2.5);
+    }
+    QVERIFY(detector.isSettled());
+}
+
+QTEST_APPLESS_MAIN(SettlingDetectorTest)
+
+#include "SettlingDetectorTest.moc"
@@ -0,0 +1,101 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include <functional>
+#include "automation/SoftwareRegulator.h"
+
+class SoftwareRegulatorTest : public QObject {
+    Q_OBJECT
+private slots:
+    void constantPowerError();
+    void constantResistanceError();
+    void actualValue();
+    void constantPowerOnResistor();
+    void constantResistanceOnLed();
+    void constantResistanceOnResistorIsPinned();
+};
+
+static SoftwareRegulator::Options makeOptions(SoftwareRegulator::Mode mode, double target, double maxVoltage = 12) {
+    SoftwareRegulator::Options options;
+    options.mode = mode;
+    options.target = target;
+    options.maxVoltage = maxVoltage;
+    return options;
+}
+
+/**
+ * The loop against a load, which follows VSET at once: current(voltage) gives IOUT, the readings of a cycle are VOUT
+ * = VSET of the previous one. Returns the last VSET.
+ */
+static double simulate(const SoftwareRegulator::Options &options, const std::function<double(double)> &current,
+                       double startVoltage, int cycles = 200) {
+    PidController controller(options.gains, 0, options.maxVoltage);
+    controller.reset(startVoltage);
+    for (int i = 0; i < cycles; i++) {
+        double voltage = controller.output();
+        double error = SoftwareRegulator::voltageError(options, voltage, current(voltage));
+        controller.update(error, voltage, 0.1);
+    }
+    return controller.output();
+}
+
+void SoftwareRegulatorTest::constantPowerError() {
+    auto options = makeOptions(SoftwareRegulator::ConstantPower, 10);
+    // 10 W at 1 A need 10 V.
+    QCOMPARE(SoftwareRegulator::voltageError(options, 5, 1), 5.0);
+    QCOMPARE(SoftwareRegulator::voltageError(options, 5, 4), -2.5);
+    // no current yet: up to the maximum voltage.
+    QCOMPARE(SoftwareRegulator::voltageError(options, 5, 0), 7.0);
+}
+
+void SoftwareRegulatorTest::constantResistanceError() {
+    auto options = makeOptions(SoftwareRegulator::ConstantResistance, 10);
+    // 20 Ohm, above the target: VSET goes up, which lowers V / I of an LED or a battery.
+    QCOMPARE(SoftwareRegulator::voltageError(options, 4, 0.2), 2.0);
+    // 5 Ohm, below the target: VSET goes down.
+    QCOMPARE(SoftwareRegulator::voltageError(options, 4, 0.8), -4.0);
+    QCOMPARE(SoftwareRegulator::voltageError(options, 4, 0.4), 0.0);
+}
+
+void SoftwareRegulatorTest::actualValue() {
+    QCOMPARE(SoftwareRegulator::actualValue(SoftwareRegulator::ConstantPower, 5, 2), 10.0);
+    QCOMPARE(SoftwareRegulator::actualValue(SoftwareRegulator::ConstantResistance, 5, 2), 2.5);
+    QCOMPARE(SoftwareRegulator::actualValue(SoftwareRegulator::ConstantResistance, 5, 0), 0.0);
+}
+
+void SoftwareRegulatorTest::constantPowerOnResistor() {
+    auto options = makeOptions(SoftwareRegulator::ConstantPower, 5);
+    double voltage = simulate(options, [] (double v) { return v / 5; }, 1);
+    QVERIFY(qAbs(voltage - 5) < 0.01);
+}
+
+void SoftwareRegulatorTest::constantResistanceOnLed() {
+    // 2 V forward voltage, 5 Ohm series resistance: 10 Ohm at 4 V, 0.4 A.
+    auto options = makeOptions(SoftwareRegulator::ConstantResistance, 10);
+    auto led = [] (double v) { return qMax(0.0, (v - 2) / 5); };
+    QVERIFY(qAbs(simulate(options, led, 1) - 4) < 0.01);
+    QVERIFY(qAbs(simulate(options, led, 10) - 4) < 0.01);
+}
+
+void SoftwareRegulatorTest::constantResistanceOnResistorIsPinned() {
+    // V / I of a resistor doesn't depend on VSET: the loop ends at a limit, where the regulator stops it.
+    auto options = makeOptions(SoftwareRegulator::ConstantResistance, 10);
+    QCOMPARE(simulate(options, [] (double v) { return v / 20; }, 1), options.maxVoltage);
+    // down to where no current flows.
+    QVERIFY(simulate(options, [] (double v) { return v / 5; }, 1) / 5 < 0.001);
+}
+
+QTEST_APPLESS_MAIN(SoftwareRegulatorTest)
+
+#include "SoftwareRegulatorTest.moc"
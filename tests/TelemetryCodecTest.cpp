@@ -0,0 +1,177 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <QtTest>
+#include "telemetry/TelemetryCodec.h"
+
+class TelemetryCodecTest : public QObject {
+    Q_OBJECT
+private slots:
+    void roundTrip();
+    void damagedBlockIsSkipped();
+    void corruptedPayloadIsRejected();
+    void wrongHeader();
+};
+
+// readings at the device resolution, so they survive the fixed point encoding.
+static QVector<Telemetry::Record> makeRecords(int count) {
+    QVector<Telemetry::Record> records;
+    Telemetry::Record record;
+    record.Timestamp = 1700000000000;
+    record.Status.ModeCh1 = Global::ConstantVoltage;
+    record.Status.ModeCh2 = Global::ConstantVoltage;
+    record.Status.Tracking = Global::Independent;
+    record.Status.Protection = Global::OutputProtectionAllDisabled;
+    for (int i = 0; i < count; ++i) {
+        record.Timestamp += 250 + (i % 7) - 3;
+        record.Ch1.Voltage = 12.0 + (i % 50) / 100.0;
+        record.Ch1.Current = 0.5 + (i % 13) / 1000.0;
+        record.Ch2.Voltage = i % 100 < 50 ? 5.0 : 3.3;
+        record.Ch2.Current = (i / 10) / 1000.0;
+        // the ch1 readings arrive before the status reply, the ch2 ones are read every tenth cycle.
+        record.Ch1.VoltageTime = record.Timestamp - 40 - i % 3;
+        record.Ch1.CurrentTime = record.Timestamp - 20;
+        if (i % 10 == 0) {
+            record.Ch2.VoltageTime = record.Timestamp - 60;
+            record.Ch2.CurrentTime = record.Timestamp - 50;
+        }
+        record.Status.OutputSwitch = i % 300 < 250;
+        record.Status.ModeCh1 = i % 40 < 30 ? Global::ConstantVoltage : Global::ConstantCurrent;
+        records.append(record);
+    }
+    return records;
+}
+
+static bool isEqual(const Telemetry::Record &a, const Telemetry::Record &b) {
+    return a.Timestamp == b.Timestamp &&
+           qRound(a.Ch1.Voltage * 100) == qRound(b.Ch1.Voltage * 100) &&
+           qRound(a.Ch1.Current * 1000) == qRound(b.Ch1.Current * 1000) &&
+           qRound(a.Ch2.Voltage * 100) == qRound(b.Ch2.Voltage * 100) &&
+           qRound(a.Ch2.Current * 1000) == qRound(b.Ch2.Current * 1000) &&
+           a.Ch1.VoltageTime == b.Ch1.VoltageTime && a.Ch1.CurrentTime == b.Ch1.CurrentTime &&
+           a.Ch2.VoltageTime == b.Ch2.VoltageTime && a.Ch2.CurrentTime == b.Ch2.CurrentTime &&
+           Telemetry::statusToByte(a.Status) == Telemetry::statusToByte(b.Status);
+}
+
+static QVector<Telemetry::Record> decode(Telemetry::Decoder &decoder, const QByteArray &data, int chunkSize) {
+    QVector<Telemetry::Record> records;
+    Telemetry::Record record;
+    for (int offset = 0; offset < data.size(); offset += chunkSize) {
+        decoder.feed(data.mid(offset, chunkSize));
+        while (decoder.next(record)) {
+            records.append(record);
+        }
+    }
+    return records;
+}
+
+void TelemetryCodecTest::roundTrip() {
+    auto records = makeRecords(2500);
+    Telemetry::Encoder encoder(1000);
+    for (const auto &record : records) {
+        encoder.append(record);
+    }
+    encoder.flush();
+    QByteArray data = Telemetry::Encoder::streamHeader();
+    data.append(encoder.takeEncoded());
+    QCOMPARE(encoder.samplesCount(), qint64(records.size()));
+
+    for (int chunkSize : {7, 4096, data.size()}) {
+        Telemetry::Decoder decoder;
+        auto decoded = decode(decoder, data, chunkSize);
+        QVERIFY(!decoder.hasError());
+        QCOMPARE(decoded.size(), records.size());
+        for (int i = 0; i < records.size(); ++i) {
+            QVERIFY(isEqual(decoded.at(i), records.at(i)));
+        }
+    }
+}
+
+static QByteArray encodeBlocks(const QVector<Telemetry::Record> &records, int blockSize, QVector<int> &blockOffsets) {
+    Telemetry::Encoder encoder(blockSize);
+    QByteArray data = Telemetry::Encoder::streamHeader();
+    for (const auto &record : records) {
+        if (encoder.samplesCount() % blockSize == 0) {
+            blockOffsets.append(data.size());
+        }
+        encoder.append(record);
+        data.append(encoder.takeEncoded());
+    }
+    return data;
+}
+
+void TelemetryCodecTest::damagedBlockIsSkipped() {
+    const int blockSize = 100;
+    auto records = makeRecords(3 * blockSize);
+    QVector<int> blockOffsets;
+    QByteArray data = encodeBlocks(records, blockSize, blockOffsets);
+    QCOMPARE(blockOffsets.size(), 3);
+
+    // the second block claims a sample more than its payload holds.
+    QCOMPARE(data.at(blockOffsets.at(1)), 'B');
+    QCOMPARE(int(data.at(blockOffsets.at(1) + 1)), blockSize);
+    data[blockOffsets.at(1) + 1] = char(blockSize + 1);
+
+    Telemetry::Decoder decoder;
+    auto decoded = decode(decoder, data, 64);
+    QVERIFY(decoder.hasError());
+    QCOMPARE(decoder.badBlocksCount(), 1);
+    QCOMPARE(decoded.size(), 2 * blockSize);
+    for (int i = 0; i < blockSize; ++i) {
+        QVERIFY(isEqual(decoded.at(i), records.at(i)));
+        QVERIFY(isEqual(decoded.at(blockSize + i), records.at(2 * blockSize + i)));
+    }
+}
+
+void TelemetryCodecTest::corruptedPayloadIsRejected() {
+    const int blockSize = 100;
+    auto records = makeRecords(3 * blockSize);
+    QVector<int> blockOffsets;
+    const QByteArray data = encodeBlocks(records, blockSize, blockOffsets);
+    QCOMPARE(blockOffsets.size(), 3);
+    int payload = blockOffsets.at(1) + 12; // past the tag, the varints and the CRCs
+    int payloadEnd = blockOffsets.at(2);
+
+    // a changed value keeps the structure of the block, and damaged data full of block tags.
+    QByteArray flipped = data;
+    flipped[(payload + payloadEnd) / 2] = char(flipped.at((payload + payloadEnd) / 2) ^ 0x01);
+    QByteArray garbage = data;
+    quint32 seed = 12345;
+    for (int i = payload; i < payloadEnd; ++i) {
+        seed = seed * 1103515245 + 12345;
+        garbage[i] = i % 5 == 0 ? 'B' : char(seed >> 16);
+    }
+
+    for (const auto &corrupted : {flipped, garbage}) {
+        Telemetry::Decoder decoder;
+        auto decoded = decode(decoder, corrupted, 64);
+        QCOMPARE(decoder.badBlocksCount(), 1);
+        QCOMPARE(decoded.size(), 2 * blockSize);
+        for (int i = 0; i < blockSize; ++i) {
+            QVERIFY(isEqual(decoded.at(i), records.at(i)));
+            QVERIFY(isEqual(decoded.at(blockSize + i), records.at(2 * blockSize + i)));
+        }
+    }
+}
+
+void TelemetryCodecTest::wrongHeader() {
+    Telemetry::Decoder decoder;
+    decoder.feed(QByteArray("CSV,1,2,3\n"));
+    Telemetry::Record record;
+    QVERIFY(decoder.hasError());
+    QVERIFY(!decoder.next(record));
+}
+
+QTEST_APPLESS_MAIN(TelemetryCodecTest)
+
+#include "TelemetryCodecTest.moc"